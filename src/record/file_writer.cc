@@ -0,0 +1,223 @@
+#include "record/file_writer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef WEBRTC_WIN
+#include <malloc.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace rtc;
+
+namespace {
+
+uint8_t *AllocateAligned(size_t size) {
+#ifdef WEBRTC_WIN
+    return static_cast<uint8_t *>(::_aligned_malloc(size, SequentialFileWriter::kBlockSize));
+#else
+    void *p = nullptr;
+    if (0 != ::posix_memalign(&p, SequentialFileWriter::kBlockSize, size)) {
+        return nullptr;
+    }
+    return static_cast<uint8_t *>(p);
+#endif
+}
+
+void FreeAligned(uint8_t *p) {
+#ifdef WEBRTC_WIN
+    ::_aligned_free(p);
+#else
+    ::free(p);
+#endif
+}
+
+size_t RoundUpToBlock(size_t size) {
+    return (size + SequentialFileWriter::kBlockSize - 1)
+        / SequentialFileWriter::kBlockSize * SequentialFileWriter::kBlockSize;
+}
+}
+
+// static
+std::unique_ptr<SequentialFileWriter> SequentialFileWriter::Open(const std::string& path,
+                                                                 size_t buffer_size,
+                                                                 bool direct_io) {
+    std::unique_ptr<SequentialFileWriter> writer(
+        new SequentialFileWriter(buffer_size, direct_io));
+    if (!writer->buffer_ || !writer->OpenFile(path)) {
+        return nullptr;
+    }
+    return writer;
+}
+
+SequentialFileWriter::SequentialFileWriter(size_t buffer_size, bool direct_io)
+    : capacity_(RoundUpToBlock(buffer_size ? buffer_size : kBlockSize))
+    , direct_io_(direct_io) {
+    buffer_ = AllocateAligned(capacity_);
+}
+
+SequentialFileWriter::~SequentialFileWriter() {
+    Close();
+    FreeAligned(buffer_);
+}
+
+bool SequentialFileWriter::OpenFile(const std::string& path) {
+#ifdef WEBRTC_WIN
+    DWORD flags = FILE_FLAG_SEQUENTIAL_SCAN;
+    if (direct_io_) {
+        flags |= FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH;
+    }
+
+    HANDLE file = ::CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                                CREATE_ALWAYS, flags, nullptr);
+    if (INVALID_HANDLE_VALUE == file) {
+        return false;
+    }
+
+    file_ = file;
+    return true;
+#else
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+    if (direct_io_) {
+        flags |= O_DIRECT;
+    }
+#endif
+
+    fd_ = ::open(path.c_str(), flags, 0644);
+    if (fd_ < 0 && direct_io_) {
+        // e.g. tmpfs refuses O_DIRECT, large buffered writes are the next best
+        direct_io_ = false;
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+
+    return fd_ >= 0;
+#endif
+}
+
+bool SequentialFileWriter::Write(const void *data, size_t size) {
+    if (closed_) {
+        return false;
+    }
+
+    auto p = static_cast<const uint8_t *>(data);
+    while (size > 0) {
+        size_t n = std::min(size, capacity_ - used_);
+        ::memcpy(buffer_ + used_, p, n);
+        used_ += n;
+        p += n;
+        size -= n;
+
+        if (used_ == capacity_ && !Flush(false)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool SequentialFileWriter::WriteAt(uint64_t offset, const void *data, size_t size) {
+    if (closed_ || direct_io_ || !Flush(true)) {
+        return false;
+    }
+
+#ifdef WEBRTC_WIN
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+    DWORD written = 0;
+    return ::WriteFile(file_, data, static_cast<DWORD>(size), &written, &overlapped)
+        && written == size;
+#else
+    return ::pwrite(fd_, data, size, static_cast<off_t>(offset)) == static_cast<ssize_t>(size);
+#endif
+}
+
+bool SequentialFileWriter::Close() {
+    if (closed_) {
+        return true;
+    }
+
+    bool ok = Flush(true);
+    closed_ = true;
+
+#ifdef WEBRTC_WIN
+    ::CloseHandle(file_);
+    file_ = nullptr;
+#else
+    ok = (0 == ::close(fd_)) && ok;
+    fd_ = -1;
+#endif
+    return ok;
+}
+
+// Direct io only takes whole blocks, a final partial buffer is padded and
+// the file truncated back to its logical size.
+bool SequentialFileWriter::Flush(bool final) {
+    if (0 == used_) {
+        return true;
+    }
+
+    if (!direct_io_) {
+        if (!WriteFile(buffer_, used_)) {
+            return false;
+        }
+        flushed_ += used_;
+        used_ = 0;
+        return true;
+    }
+
+    if (!final) {
+        if (!WriteFile(buffer_, capacity_)) {
+            return false;
+        }
+        flushed_ += capacity_;
+        used_ = 0;
+        return true;
+    }
+
+    size_t padded = RoundUpToBlock(used_);
+    ::memset(buffer_ + used_, 0, padded - used_);
+    if (!WriteFile(buffer_, padded)) {
+        return false;
+    }
+
+    flushed_ += used_;
+    used_ = 0;
+    return Truncate(flushed_);
+}
+
+bool SequentialFileWriter::WriteFile(const uint8_t *data, size_t size) {
+    while (size > 0) {
+#ifdef WEBRTC_WIN
+        DWORD written = 0;
+        if (!::WriteFile(file_, data, static_cast<DWORD>(size), &written, nullptr)) {
+            return false;
+        }
+#else
+        auto written = ::write(fd_, data, size);
+        if (written < 0) {
+            return false;
+        }
+#endif
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool SequentialFileWriter::Truncate(uint64_t size) {
+#ifdef WEBRTC_WIN
+    LARGE_INTEGER pos;
+    pos.QuadPart = static_cast<LONGLONG>(size);
+    return ::SetFilePointerEx(file_, pos, nullptr, FILE_BEGIN) && ::SetEndOfFile(file_);
+#else
+    return 0 == ::ftruncate(fd_, static_cast<off_t>(size));
+#endif
+}
@@ -0,0 +1,56 @@
+#ifndef _RTC_FILE_WRITER_H_INCLUDED
+#define _RTC_FILE_WRITER_H_INCLUDED
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace rtc {
+
+// Append only file that gathers writes into one large aligned buffer and
+// hands it to the os in whole buffers. With direct io the page cache is
+// bypassed, the tail is padded to a block and truncated back on Close().
+class SequentialFileWriter {
+public:
+    static constexpr size_t kBlockSize = 4096;
+
+    static std::unique_ptr<SequentialFileWriter> Open(const std::string& path,
+                                                      size_t buffer_size,
+                                                      bool direct_io);
+    ~SequentialFileWriter();
+
+    bool Write(const void *data, size_t size);
+
+    // Overwrites bytes already written, e.g. a header patched on close.
+    // Not available with direct io.
+    bool WriteAt(uint64_t offset, const void *data, size_t size);
+
+    bool Close();
+
+    // bytes appended so far, buffered or not
+    uint64_t size() const { return flushed_ + used_; }
+private:
+    SequentialFileWriter(size_t buffer_size, bool direct_io);
+    SequentialFileWriter(const SequentialFileWriter&) = delete;
+    SequentialFileWriter& operator=(const SequentialFileWriter&) = delete;
+
+    bool OpenFile(const std::string& path);
+    bool Flush(bool final);
+    bool WriteFile(const uint8_t *data, size_t size);
+    bool Truncate(uint64_t size);
+
+#ifdef WEBRTC_WIN
+    void *file_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+    uint8_t *buffer_ = nullptr;
+    size_t capacity_;
+    size_t used_ = 0;
+    uint64_t flushed_ = 0;
+    bool direct_io_;
+    bool closed_ = false;
+};
+}
+
+#endif // !_RTC_FILE_WRITER_H_INCLUDED
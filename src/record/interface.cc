@@ -0,0 +1,10 @@
+#include "record/interface.h"
+#include "record/media_recorder.h"
+
+using namespace rtc;
+
+// static
+std::shared_ptr<MediaRecorderInterface>
+MediaRecorderInterface::Create(const MediaRecorderOptions& options) {
+    return MediaRecorder::Create(options);
+}
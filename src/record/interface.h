@@ -0,0 +1,52 @@
+#ifndef _RTC_MEDIA_RECORD_INTERFACE_H_INCLUDED
+#define _RTC_MEDIA_RECORD_INTERFACE_H_INCLUDED
+
+#include <memory>
+#include <string>
+
+#include "rtc_common_types.h"
+
+namespace rtc {
+
+struct MediaRecorderOptions {
+    // ".y4m" and ".wav" are appended for the video and audio files
+    std::string path;
+
+    // Frames waiting for the writer thread. Past this the sinks drop
+    // instead of blocking the decode and audio threads.
+    size_t max_queued_video_frames = 30;
+    size_t max_queued_audio_chunks = 100;
+
+    // bytes gathered before each write, rounded up to 4KB
+    size_t write_buffer_size = 4 << 20;
+
+    // bypass the page cache for the video file (O_DIRECT / FILE_FLAG_NO_BUFFERING)
+    bool direct_io = false;
+
+    // y4m has a frame rate in its header, sinks don't know it
+    int video_fps = 30;
+};
+
+struct MediaRecorderStats {
+    uint64_t video_frames_written = 0;
+    uint64_t video_frames_dropped = 0;
+    uint64_t audio_chunks_written = 0;
+    uint64_t audio_chunks_dropped = 0;
+    uint64_t bytes_written = 0;
+};
+
+// Records one video and one audio track. The sinks only copy into a bounded
+// queue, a writer thread per recorder does all disk io.
+class MediaRecorderInterface {
+protected:
+    virtual ~MediaRecorderInterface() = default;
+public:
+    static std::shared_ptr<MediaRecorderInterface> Create(const MediaRecorderOptions& options);
+
+    virtual std::unique_ptr<I420VideoSinkInterface> CreateVideoSink() = 0;
+    virtual std::unique_ptr<PcmAudioSinkInterface> CreateAudioSink() = 0;
+    virtual MediaRecorderStats stats() const = 0;
+};
+}
+
+#endif // !_RTC_MEDIA_RECORD_INTERFACE_H_INCLUDED
@@ -0,0 +1,332 @@
+#include "record/media_recorder.h"
+
+#include <cstring>
+
+using namespace rtc;
+
+namespace {
+
+class RecorderVideoSink : public I420VideoSinkInterface {
+public:
+    explicit RecorderVideoSink(std::shared_ptr<MediaRecorder> recorder)
+        : recorder_(recorder) {}
+private:
+    void OnFrame(const I420VideoFrame& video_frame) override {
+        recorder_->PushVideo(video_frame);
+    }
+
+    std::shared_ptr<MediaRecorder> recorder_;
+};
+
+class RecorderAudioSink : public PcmAudioSinkInterface {
+public:
+    explicit RecorderAudioSink(std::shared_ptr<MediaRecorder> recorder)
+        : recorder_(recorder) {}
+private:
+    void OnData(const int16_t *samples, int sample_rate, size_t channels, size_t frames) override {
+        recorder_->PushAudio(samples, sample_rate, channels, frames);
+    }
+
+    std::shared_ptr<MediaRecorder> recorder_;
+};
+
+void PackPlane(const uint8_t *src, int src_stride, int w, int h, uint8_t *dst) {
+    if (src_stride == w) {
+        ::memcpy(dst, src, static_cast<size_t>(w) * h);
+        return;
+    }
+
+    for (int y = 0; y < h; ++y) {
+        ::memcpy(dst, src, w);
+        src += src_stride;
+        dst += w;
+    }
+}
+
+void PutLE16(uint8_t *p, uint16_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+void PutLE32(uint8_t *p, uint32_t v) {
+    PutLE16(p, static_cast<uint16_t>(v));
+    PutLE16(p + 2, static_cast<uint16_t>(v >> 16));
+}
+
+const size_t kWavHeaderSize = 44;
+
+void MakeWavHeader(uint8_t *header, int sample_rate, size_t channels, uint32_t data_size) {
+    uint16_t block_align = static_cast<uint16_t>(channels * sizeof(int16_t));
+
+    ::memcpy(header, "RIFF", 4);
+    PutLE32(header + 4, static_cast<uint32_t>(kWavHeaderSize - 8 + data_size));
+    ::memcpy(header + 8, "WAVEfmt ", 8);
+    PutLE32(header + 16, 16);
+    PutLE16(header + 20, 1);
+    PutLE16(header + 22, static_cast<uint16_t>(channels));
+    PutLE32(header + 24, static_cast<uint32_t>(sample_rate));
+    PutLE32(header + 28, static_cast<uint32_t>(sample_rate) * block_align);
+    PutLE16(header + 32, block_align);
+    PutLE16(header + 34, 16);
+    ::memcpy(header + 36, "data", 4);
+    PutLE32(header + 40, data_size);
+}
+}
+
+// static
+std::shared_ptr<MediaRecorder> MediaRecorder::Create(const MediaRecorderOptions& options) {
+    std::shared_ptr<MediaRecorder> recorder(new MediaRecorder(options));
+    if (!recorder->Initialize()) {
+        return nullptr;
+    }
+    return recorder;
+}
+
+bool MediaRecorder::Initialize() {
+    if (options_.path.empty() || options_.video_fps <= 0) {
+        return false;
+    }
+
+    // open both files here so a bad path fails Create() rather than the writer thread
+    video_file_ = SequentialFileWriter::Open(options_.path + ".y4m",
+                                             options_.write_buffer_size,
+                                             options_.direct_io);
+    audio_file_ = SequentialFileWriter::Open(options_.path + ".wav",
+                                             options_.write_buffer_size,
+                                             false);
+    if (!video_file_ || !audio_file_) {
+        return false;
+    }
+
+    thread_ = std::thread([this]() { Run(); });
+    return true;
+}
+
+MediaRecorder::~MediaRecorder() {
+    {
+        std::lock_guard<std::mutex> guard(mu_);
+        stopping_ = true;
+    }
+    cond_.notify_one();
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+std::unique_ptr<I420VideoSinkInterface> MediaRecorder::CreateVideoSink() {
+    return std::make_unique<RecorderVideoSink>(shared_from_this());
+}
+
+std::unique_ptr<PcmAudioSinkInterface> MediaRecorder::CreateAudioSink() {
+    return std::make_unique<RecorderAudioSink>(shared_from_this());
+}
+
+MediaRecorderStats MediaRecorder::stats() const {
+    MediaRecorderStats stats;
+    stats.video_frames_written = video_frames_written_.load(std::memory_order_relaxed);
+    stats.video_frames_dropped = video_frames_dropped_.load(std::memory_order_relaxed);
+    stats.audio_chunks_written = audio_chunks_written_.load(std::memory_order_relaxed);
+    stats.audio_chunks_dropped = audio_chunks_dropped_.load(std::memory_order_relaxed);
+    stats.bytes_written = bytes_written_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void MediaRecorder::PushVideo(const I420VideoFrame& frame) {
+    std::unique_ptr<VideoItem> item;
+    {
+        std::lock_guard<std::mutex> guard(mu_);
+        if (stopping_ || video_queue_.size() >= options_.max_queued_video_frames) {
+            video_frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        if (!free_video_.empty()) {
+            item = std::move(free_video_.back());
+            free_video_.pop_back();
+        }
+    }
+
+    if (!item) {
+        item = std::make_unique<VideoItem>();
+    }
+
+    // the copy runs outside the lock, the frame is only valid during OnFrame()
+    int w = frame.width();
+    int h = frame.height();
+    int chroma_w = (w + 1) / 2;
+    int chroma_h = (h + 1) / 2;
+    size_t luma_size = static_cast<size_t>(w) * h;
+    size_t chroma_size = static_cast<size_t>(chroma_w) * chroma_h;
+
+    item->width = w;
+    item->height = h;
+    item->data.resize(luma_size + 2 * chroma_size);
+
+    auto dst = item->data.data();
+    PackPlane(frame.DataY(), frame.StrideY(), w, h, dst);
+    PackPlane(frame.DataU(), frame.StrideU(), chroma_w, chroma_h, dst + luma_size);
+    PackPlane(frame.DataV(), frame.StrideV(), chroma_w, chroma_h, dst + luma_size + chroma_size);
+
+    {
+        std::lock_guard<std::mutex> guard(mu_);
+        video_queue_.push_back(std::move(item));
+    }
+    cond_.notify_one();
+}
+
+void MediaRecorder::PushAudio(const int16_t *samples, int sample_rate,
+                              size_t channels, size_t frames) {
+    std::unique_ptr<AudioItem> item;
+    {
+        std::lock_guard<std::mutex> guard(mu_);
+        if (stopping_ || audio_queue_.size() >= options_.max_queued_audio_chunks) {
+            audio_chunks_dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        if (!free_audio_.empty()) {
+            item = std::move(free_audio_.back());
+            free_audio_.pop_back();
+        }
+    }
+
+    if (!item) {
+        item = std::make_unique<AudioItem>();
+    }
+
+    item->sample_rate = sample_rate;
+    item->channels = channels;
+    item->samples.assign(samples, samples + channels * frames);
+
+    {
+        std::lock_guard<std::mutex> guard(mu_);
+        audio_queue_.push_back(std::move(item));
+    }
+    cond_.notify_one();
+}
+
+// Drains the queues until stopped, whatever is still queued at that point
+// is written before the files are closed.
+void MediaRecorder::Run() {
+    std::deque<std::unique_ptr<VideoItem>> video_items;
+    std::deque<std::unique_ptr<AudioItem>> audio_items;
+
+    for (;;) {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(mu_);
+            cond_.wait(lock, [this]() {
+                return stopping_ || !video_queue_.empty() || !audio_queue_.empty();
+            });
+
+            video_items.swap(video_queue_);
+            audio_items.swap(audio_queue_);
+            stopping = stopping_;
+        }
+
+        for (auto& item : video_items) {
+            WriteVideo(*item);
+        }
+        for (auto& item : audio_items) {
+            WriteAudio(*item);
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(mu_);
+            for (auto& item : video_items) {
+                free_video_.push_back(std::move(item));
+            }
+            for (auto& item : audio_items) {
+                free_audio_.push_back(std::move(item));
+            }
+        }
+        video_items.clear();
+        audio_items.clear();
+
+        if (stopping) {
+            break;
+        }
+    }
+
+    CloseFiles();
+}
+
+void MediaRecorder::WriteVideo(const VideoItem& item) {
+    if (video_failed_) {
+        video_frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (0 == video_width_) {
+        video_width_ = item.width;
+        video_height_ = item.height;
+
+        std::string header = "YUV4MPEG2 W" + std::to_string(video_width_)
+            + " H" + std::to_string(video_height_)
+            + " F" + std::to_string(options_.video_fps) + ":1 Ip A1:1 C420jpeg\n";
+        video_failed_ = !video_file_->Write(header.data(), header.size());
+    }
+
+    // y4m can't change resolution midstream
+    if (video_failed_ || item.width != video_width_ || item.height != video_height_) {
+        video_frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    static const char kFrameHeader[] = "FRAME\n";
+    if (!video_file_->Write(kFrameHeader, sizeof(kFrameHeader) - 1)
+        || !video_file_->Write(item.data.data(), item.data.size())) {
+        video_failed_ = true;
+        video_frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    video_frames_written_.fetch_add(1, std::memory_order_relaxed);
+    bytes_written_.fetch_add(sizeof(kFrameHeader) - 1 + item.data.size(),
+                             std::memory_order_relaxed);
+}
+
+void MediaRecorder::WriteAudio(const AudioItem& item) {
+    if (audio_failed_) {
+        audio_chunks_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (0 == audio_sample_rate_) {
+        audio_sample_rate_ = item.sample_rate;
+        audio_channels_ = item.channels;
+
+        // sizes are patched in CloseFiles()
+        uint8_t header[kWavHeaderSize];
+        MakeWavHeader(header, audio_sample_rate_, audio_channels_, 0);
+        audio_failed_ = !audio_file_->Write(header, sizeof(header));
+    }
+
+    if (audio_failed_ || item.sample_rate != audio_sample_rate_ || item.channels != audio_channels_) {
+        audio_chunks_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    size_t size = item.samples.size() * sizeof(int16_t);
+    if (!audio_file_->Write(item.samples.data(), size)) {
+        audio_failed_ = true;
+        audio_chunks_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    audio_chunks_written_.fetch_add(1, std::memory_order_relaxed);
+    bytes_written_.fetch_add(size, std::memory_order_relaxed);
+}
+
+void MediaRecorder::CloseFiles() {
+    video_file_->Close();
+
+    if (audio_sample_rate_ > 0 && !audio_failed_) {
+        uint8_t header[kWavHeaderSize];
+        MakeWavHeader(header, audio_sample_rate_, audio_channels_,
+                      static_cast<uint32_t>(audio_file_->size() - kWavHeaderSize));
+        audio_file_->WriteAt(0, header, sizeof(header));
+    }
+    audio_file_->Close();
+}
@@ -0,0 +1,80 @@
+#ifndef _RTC_MEDIA_RECORDER_H_INCLUDED
+#define _RTC_MEDIA_RECORDER_H_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "record/interface.h"
+#include "record/file_writer.h"
+
+namespace rtc {
+
+class MediaRecorder : public MediaRecorderInterface
+                    , public std::enable_shared_from_this<MediaRecorder> {
+public:
+    static std::shared_ptr<MediaRecorder> Create(const MediaRecorderOptions& options);
+    ~MediaRecorder();
+
+    // called on the decode / audio threads, never block
+    void PushVideo(const I420VideoFrame& frame);
+    void PushAudio(const int16_t *samples, int sample_rate, size_t channels, size_t frames);
+private:
+    explicit MediaRecorder(const MediaRecorderOptions& options) : options_(options) {}
+    bool Initialize();
+
+    std::unique_ptr<I420VideoSinkInterface> CreateVideoSink() override;
+    std::unique_ptr<PcmAudioSinkInterface> CreateAudioSink() override;
+    MediaRecorderStats stats() const override;
+
+    struct VideoItem {
+        int width = 0;
+        int height = 0;
+        std::vector<uint8_t> data;
+    };
+
+    struct AudioItem {
+        int sample_rate = 0;
+        size_t channels = 0;
+        std::vector<int16_t> samples;
+    };
+
+    void Run();
+    void WriteVideo(const VideoItem& item);
+    void WriteAudio(const AudioItem& item);
+    void CloseFiles();
+
+    MediaRecorderOptions options_;
+
+    std::mutex mu_;
+    std::condition_variable cond_;
+    std::deque<std::unique_ptr<VideoItem>> video_queue_;
+    std::deque<std::unique_ptr<AudioItem>> audio_queue_;
+    // drained items go back here so steady state allocates nothing
+    std::vector<std::unique_ptr<VideoItem>> free_video_;
+    std::vector<std::unique_ptr<AudioItem>> free_audio_;
+    bool stopping_ = false;
+    std::thread thread_;
+
+    // writer thread only
+    std::unique_ptr<SequentialFileWriter> video_file_;
+    std::unique_ptr<SequentialFileWriter> audio_file_;
+    int video_width_ = 0;
+    int video_height_ = 0;
+    int audio_sample_rate_ = 0;
+    size_t audio_channels_ = 0;
+    bool video_failed_ = false;
+    bool audio_failed_ = false;
+
+    std::atomic<uint64_t> video_frames_written_{ 0 };
+    std::atomic<uint64_t> video_frames_dropped_{ 0 };
+    std::atomic<uint64_t> audio_chunks_written_{ 0 };
+    std::atomic<uint64_t> audio_chunks_dropped_{ 0 };
+    std::atomic<uint64_t> bytes_written_{ 0 };
+};
+}
+
+#endif // !_RTC_MEDIA_RECORDER_H_INCLUDED
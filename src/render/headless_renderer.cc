@@ -0,0 +1,159 @@
+#include "render/headless_renderer.h"
+
+#include <algorithm>
+
+#include "render/plane_copy.h"
+
+using namespace rtc;
+
+namespace {
+
+struct TileRect {
+    int x;
+    int y;
+    int w;
+    int h;
+};
+
+TileRect CalcTileRect(float x, float y, float w, float h, int out_w, int out_h) {
+    TileRect rect;
+    rect.x = std::min(static_cast<int>(x * out_w), out_w);
+    rect.y = std::min(static_cast<int>(y * out_h), out_h);
+    rect.w = std::min(static_cast<int>(w * out_w), out_w - rect.x);
+    rect.h = std::min(static_cast<int>(h * out_h), out_h - rect.y);
+    return rect;
+}
+
+I420VideoSinkWants CalcTileWants(const TileRect& rect) {
+    I420VideoSinkWants wants;
+    if (rect.w > 0 && rect.h > 0) {
+        wants.max_pixel_count = rect.w * rect.h;
+    }
+    return wants;
+}
+
+class NullVideoSink : public I420VideoSinkInterface {
+public:
+    NullVideoSink(std::shared_ptr<NullVideoRenderer> renderer, const TileRect& rect)
+        : renderer_(renderer)
+        , rect_(rect) {}
+private:
+    void OnFrame(const I420VideoFrame& video_frame) override {
+        renderer_->OnFrameRendered(video_frame);
+    }
+
+    I420VideoSinkWants wants() const override {
+        return CalcTileWants(rect_);
+    }
+
+    std::shared_ptr<NullVideoRenderer> renderer_;
+    TileRect rect_;
+};
+
+class OffscreenVideoSink : public I420VideoSinkInterface {
+public:
+    OffscreenVideoSink(std::shared_ptr<OffscreenVideoRenderer> renderer, const TileRect& rect)
+        : renderer_(renderer)
+        , rect_(rect)
+        , scaler_(renderer->scratch_pool()) {}
+private:
+    void OnFrame(const I420VideoFrame& video_frame) override {
+        renderer_->Composite(video_frame, rect_.x, rect_.y, rect_.w, rect_.h, scaler_);
+        renderer_->OnFrameRendered(video_frame);
+    }
+
+    I420VideoSinkWants wants() const override {
+        return CalcTileWants(rect_);
+    }
+
+    std::shared_ptr<OffscreenVideoRenderer> renderer_;
+    TileRect rect_;
+    I420Scaler scaler_;
+};
+}
+
+void HeadlessVideoRenderer::OnFrameRendered(const I420VideoFrame& frame) {
+    frames_.fetch_add(1, std::memory_order_relaxed);
+    RecordCaptureLatency(&latency_us_, frame);
+}
+
+// static
+std::shared_ptr<NullVideoRenderer> NullVideoRenderer::Create(int w, int h) {
+    if (w <= 0 || h <= 0) {
+        return nullptr;
+    }
+
+    return std::shared_ptr<NullVideoRenderer>(new NullVideoRenderer(w, h));
+}
+
+std::unique_ptr<I420VideoSinkInterface>
+NullVideoRenderer::CreateSink(float x, float y, float w, float h) {
+    return std::make_unique<NullVideoSink>(shared_from_this(),
+                                           CalcTileRect(x, y, w, h, w_, h_));
+}
+
+OffscreenVideoRenderer::OffscreenVideoRenderer(int w, int h)
+    : HeadlessVideoRenderer(w, h)
+    , scratch_pool_(ScratchBufferPool::Create()) {
+    size_t luma_size = static_cast<size_t>(w) * h;
+    size_t chroma_size = static_cast<size_t>((w + 1) / 2) * ((h + 1) / 2);
+
+    canvas_.resize(luma_size + 2 * chroma_size);
+    std::fill(canvas_.begin() + luma_size, canvas_.end(), 0x80);
+}
+
+// static
+std::shared_ptr<OffscreenVideoRenderer> OffscreenVideoRenderer::Create(int w, int h) {
+    if (w <= 0 || h <= 0) {
+        return nullptr;
+    }
+
+    return std::shared_ptr<OffscreenVideoRenderer>(new OffscreenVideoRenderer(w, h));
+}
+
+std::vector<uint8_t> OffscreenVideoRenderer::ReadCanvas() const {
+    std::lock_guard<std::mutex> guard(mu_);
+    return canvas_;
+}
+
+void OffscreenVideoRenderer::Composite(const I420VideoFrame& frame, int x, int y, int w, int h,
+                                       I420Scaler& scaler) {
+    if (w <= 0 || h <= 0) {
+        return;
+    }
+
+    // scale outside the lock, only the copy into the canvas is serialized
+    auto scaled_frame = scaler.Scale(frame, w, h, true);
+    const I420VideoFrame& src = scaled_frame ? *scaled_frame : frame;
+
+    w = std::min(w, src.width());
+    h = std::min(h, src.height());
+
+    int canvas_chroma_w = (w_ + 1) / 2;
+    int canvas_chroma_h = (h_ + 1) / 2;
+    int chroma_x = x / 2;
+    int chroma_y = y / 2;
+    int chroma_w = std::min((w + 1) / 2, canvas_chroma_w - chroma_x);
+    int chroma_h = std::min((h + 1) / 2, canvas_chroma_h - chroma_y);
+
+    std::lock_guard<std::mutex> guard(mu_);
+
+    auto canvas_y = canvas_.data();
+    auto canvas_u = canvas_y + w_ * h_;
+    auto canvas_v = canvas_u + canvas_chroma_w * canvas_chroma_h;
+
+    CopyPlane(src.DataY(), src.StrideY(),
+              canvas_y + y * w_ + x, w_, w, h);
+    CopyPlane(src.DataU(), src.StrideU(),
+              canvas_u + chroma_y * canvas_chroma_w + chroma_x, canvas_chroma_w,
+              chroma_w, chroma_h);
+    CopyPlane(src.DataV(), src.StrideV(),
+              canvas_v + chroma_y * canvas_chroma_w + chroma_x, canvas_chroma_w,
+              chroma_w, chroma_h);
+}
+
+std::unique_ptr<I420VideoSinkInterface>
+OffscreenVideoRenderer::CreateSink(float x, float y, float w, float h) {
+    return std::make_unique<OffscreenVideoSink>(shared_from_this(),
+                                                CalcTileRect(x, y, w, h, w_, h_));
+}
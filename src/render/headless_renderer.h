@@ -0,0 +1,70 @@
+#ifndef _RTC_HEADLESS_RENDERER_H_INCLUDED
+#define _RTC_HEADLESS_RENDERER_H_INCLUDED
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "utility/histogram.h"
+#include "render/interface.h"
+#include "render/i420_scaler.h"
+
+namespace rtc {
+
+// Renderers for hosts without a display. They keep the CreateSink(x, y, w, h)
+// contract against a virtual output of w x h pixels, so sinks report the
+// same wants as they would in a window of that size.
+class HeadlessVideoRenderer : public VideoRendererInterface {
+public:
+    int output_width() const { return w_; }
+    int output_height() const { return h_; }
+
+    uint64_t frames_rendered() const override { return frames_.load(std::memory_order_relaxed); }
+    util::Histogram::Snapshot GetLatencyHistogram() const override { return latency_us_.GetSnapshot(); }
+
+    // capture to render latency of all frames with a capture time, in microseconds
+    util::Histogram& latency_us() { return latency_us_; }
+
+    void OnFrameRendered(const I420VideoFrame& frame);
+protected:
+    HeadlessVideoRenderer(int w, int h) : w_(w), h_(h) {}
+
+    int w_;
+    int h_;
+    std::atomic<uint64_t> frames_{ 0 };
+    util::Histogram latency_us_;
+};
+
+class NullVideoRenderer : public HeadlessVideoRenderer
+                        , public std::enable_shared_from_this<NullVideoRenderer> {
+public:
+    static std::shared_ptr<NullVideoRenderer> Create(int w, int h);
+private:
+    using HeadlessVideoRenderer::HeadlessVideoRenderer;
+
+    std::unique_ptr<I420VideoSinkInterface> CreateSink(float x, float y, float w, float h) override;
+};
+
+class OffscreenVideoRenderer : public HeadlessVideoRenderer
+                             , public std::enable_shared_from_this<OffscreenVideoRenderer> {
+public:
+    static std::shared_ptr<OffscreenVideoRenderer> Create(int w, int h);
+
+    // Copies the canvas as packed I420 of output_width() x output_height().
+    std::vector<uint8_t> ReadCanvas() const;
+
+    // scaler is the calling sink's own
+    void Composite(const I420VideoFrame& frame, int x, int y, int w, int h, I420Scaler& scaler);
+    const std::shared_ptr<ScratchBufferPool>& scratch_pool() const { return scratch_pool_; }
+private:
+    OffscreenVideoRenderer(int w, int h);
+
+    std::unique_ptr<I420VideoSinkInterface> CreateSink(float x, float y, float w, float h) override;
+
+    mutable std::mutex mu_;
+    std::vector<uint8_t> canvas_;
+    std::shared_ptr<ScratchBufferPool> scratch_pool_;
+};
+}
+
+#endif // !_RTC_HEADLESS_RENDERER_H_INCLUDED
@@ -0,0 +1,232 @@
+#include "render/i420_scaler.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "SDL2/SDL_cpuinfo.h"
+
+#include "render/plane_copy.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define RTC_I420_SCALER_X86
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define RTC_TARGET_SSE2 __attribute__((target("sse2")))
+#else
+#define RTC_TARGET_SSE2
+#endif
+
+using namespace rtc;
+
+namespace {
+
+using HalveRowFn = void (*)(const uint8_t *src0, const uint8_t *src1,
+                            uint8_t *dst, int dst_w);
+
+void HalveRowC(const uint8_t *src0, const uint8_t *src1, uint8_t *dst, int dst_w) {
+    for (int x = 0; x < dst_w; ++x) {
+        dst[x] = static_cast<uint8_t>(
+            (src0[2 * x] + src0[2 * x + 1] + src1[2 * x] + src1[2 * x + 1] + 2) >> 2);
+    }
+}
+
+#ifdef RTC_I420_SCALER_X86
+// even plus odd bytes of v, in 16 bit lanes
+RTC_TARGET_SSE2
+inline __m128i PairSums(__m128i v, __m128i mask) {
+    return _mm_add_epi16(_mm_and_si128(v, mask), _mm_srli_epi16(v, 8));
+}
+
+// Sums each 2x2 block in 16 bit lanes and rounds once, so the output is
+// bit exact with HalveRowC; 16 output pixels per step.
+RTC_TARGET_SSE2
+void HalveRowSSE2(const uint8_t *src0, const uint8_t *src1, uint8_t *dst, int dst_w) {
+    const __m128i mask = _mm_set1_epi16(0x00ff);
+    const __m128i two = _mm_set1_epi16(2);
+
+    int x = 0;
+    for (; x + 16 <= dst_w; x += 16) {
+        auto a0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src0 + 2 * x));
+        auto a1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src0 + 2 * x + 16));
+        auto b0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src1 + 2 * x));
+        auto b1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src1 + 2 * x + 16));
+
+        auto s0 = _mm_add_epi16(_mm_add_epi16(PairSums(a0, mask), PairSums(b0, mask)), two);
+        auto s1 = _mm_add_epi16(_mm_add_epi16(PairSums(a1, mask), PairSums(b1, mask)), two);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x),
+                         _mm_packus_epi16(_mm_srli_epi16(s0, 2), _mm_srli_epi16(s1, 2)));
+    }
+
+    HalveRowC(src0 + 2 * x, src1 + 2 * x, dst + x, dst_w - x);
+}
+#endif
+
+HalveRowFn SelectHalveRow() {
+#ifdef RTC_I420_SCALER_X86
+    if (::SDL_HasSSE2()) {
+        return HalveRowSSE2;
+    }
+#endif
+    return HalveRowC;
+}
+
+void HalvePlane(const uint8_t *src, int src_stride,
+                uint8_t *dst, int dst_w, int dst_h) {
+    static const HalveRowFn halve_row = SelectHalveRow();
+    for (int y = 0; y < dst_h; ++y) {
+        halve_row(src, src + src_stride, dst, dst_w);
+        src += 2 * src_stride;
+        dst += dst_w;
+    }
+}
+
+// 8 bit fixed point weights, output is at most the tile size so this stays
+// cheap. xs and fxs are the caller's scratch, only grown, never shrunk.
+void BilinearPlane(const uint8_t *src, int src_stride, int src_w, int src_h,
+                   uint8_t *dst, int dst_w, int dst_h,
+                   std::vector<int>& xs, std::vector<int>& fxs) {
+    if (xs.size() < static_cast<size_t>(dst_w)) {
+        xs.resize(dst_w);
+        fxs.resize(dst_w);
+    }
+    for (int x = 0; x < dst_w; ++x) {
+        int pos = dst_w > 1 ? static_cast<int>(
+            static_cast<int64_t>(x) * (src_w - 1) * 256 / (dst_w - 1)) : 0;
+        xs[x] = std::min(pos >> 8, src_w - 1);
+        fxs[x] = pos & 0xff;
+    }
+
+    for (int y = 0; y < dst_h; ++y) {
+        int pos = dst_h > 1 ? static_cast<int>(
+            static_cast<int64_t>(y) * (src_h - 1) * 256 / (dst_h - 1)) : 0;
+        int y0 = std::min(pos >> 8, src_h - 1);
+        int y1 = std::min(y0 + 1, src_h - 1);
+        int fy = pos & 0xff;
+
+        const uint8_t *row0 = src + y0 * src_stride;
+        const uint8_t *row1 = src + y1 * src_stride;
+        for (int x = 0; x < dst_w; ++x) {
+            int x0 = xs[x];
+            int x1 = std::min(x0 + 1, src_w - 1);
+            int fx = fxs[x];
+
+            int top = row0[x0] * (256 - fx) + row0[x1] * fx;
+            int bottom = row1[x0] * (256 - fx) + row1[x1] * fx;
+            dst[x] = static_cast<uint8_t>((top * (256 - fy) + bottom * fy + 32768) >> 16);
+        }
+        dst += dst_w;
+    }
+}
+}
+
+ScratchBufferPool::Buffer ScratchBufferPool::Acquire(size_t size) {
+    std::unique_ptr<std::vector<uint8_t>> buffer;
+    {
+        std::lock_guard<std::mutex> guard(mu_);
+        if (!free_.empty()) {
+            buffer = std::move(free_.back());
+            free_.pop_back();
+        }
+    }
+
+    if (!buffer) {
+        buffer = std::make_unique<std::vector<uint8_t>>();
+    }
+    buffer->resize(size);
+
+    std::weak_ptr<ScratchBufferPool> wp = shared_from_this();
+    return {
+        buffer.release(),
+        [wp](std::vector<uint8_t> *p) {
+            auto sp = wp.lock();
+            if (sp) {
+                sp->Release(p);
+            } else {
+                delete p;
+            }
+        }
+    };
+}
+
+void ScratchBufferPool::Release(std::vector<uint8_t> *buffer) {
+    std::lock_guard<std::mutex> guard(mu_);
+    free_.emplace_back(buffer);
+}
+
+ScaledI420Frame::ScaledI420Frame(ScratchBufferPool::Buffer buffer, int w, int h)
+    : buffer_(std::move(buffer))
+    , w_(w)
+    , h_(h) {
+}
+
+std::unique_ptr<ScaledI420Frame> I420Scaler::Scale(const I420VideoFrame& frame, int w, int h,
+                                                   bool upscale) {
+    if (w <= 0 || h <= 0 || (frame.width() == w && frame.height() == h)) {
+        return nullptr;
+    }
+
+    if (!upscale) {
+        if (frame.width() <= w && frame.height() <= h) {
+            return nullptr;
+        }
+
+        w = std::min(w, frame.width());
+        h = std::min(h, frame.height());
+    }
+
+    auto scaled = std::make_unique<ScaledI420Frame>(
+        pool_->Acquire(ScaledI420Frame::BufferSize(w, h)), w, h);
+
+    int src_chroma_w = (frame.width() + 1) / 2;
+    int src_chroma_h = (frame.height() + 1) / 2;
+    int dst_chroma_w = (w + 1) / 2;
+    int dst_chroma_h = (h + 1) / 2;
+
+    ScalePlane(frame.DataY(), frame.StrideY(), frame.width(), frame.height(),
+               scaled->MutableDataY(), w, h);
+    ScalePlane(frame.DataU(), frame.StrideU(), src_chroma_w, src_chroma_h,
+               scaled->MutableDataU(), dst_chroma_w, dst_chroma_h);
+    ScalePlane(frame.DataV(), frame.StrideV(), src_chroma_w, src_chroma_h,
+               scaled->MutableDataV(), dst_chroma_w, dst_chroma_h);
+
+    return scaled;
+}
+
+void I420Scaler::ScalePlane(const uint8_t *src, int src_stride, int src_w, int src_h,
+                            uint8_t *dst, int dst_w, int dst_h) {
+    ScratchBufferPool::Buffer buffers[2];
+    int which = 0;
+
+    while (src_w / 2 >= dst_w && src_h / 2 >= dst_h) {
+        int half_w = src_w / 2;
+        int half_h = src_h / 2;
+
+        if (half_w == dst_w && half_h == dst_h) {
+            HalvePlane(src, src_stride, dst, dst_w, dst_h);
+            return;
+        }
+
+        auto& buffer = buffers[which];
+        if (!buffer) {
+            buffer = pool_->Acquire(static_cast<size_t>(half_w) * half_h);
+        }
+
+        HalvePlane(src, src_stride, buffer->data(), half_w, half_h);
+
+        src = buffer->data();
+        src_stride = half_w;
+        src_w = half_w;
+        src_h = half_h;
+        which ^= 1;
+    }
+
+    if (src_w == dst_w && src_h == dst_h) {
+        CopyPlane(src, src_stride, dst, dst_w, dst_w, dst_h);
+        return;
+    }
+
+    BilinearPlane(src, src_stride, src_w, src_h, dst, dst_w, dst_h, xs_, fxs_);
+}
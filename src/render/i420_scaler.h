@@ -0,0 +1,85 @@
+#ifndef _RTC_I420_SCALER_H_INCLUDED
+#define _RTC_I420_SCALER_H_INCLUDED
+
+#include <mutex>
+#include <memory>
+#include <vector>
+
+#include "utility/unique_ptr.h"
+#include "rtc_common_types.h"
+
+namespace rtc {
+
+// Byte buffers shared by all sinks of a renderer. Buffers only live for one
+// OnFrame, so a gallery needs about as many as it has decode threads.
+class ScratchBufferPool : public std::enable_shared_from_this<ScratchBufferPool> {
+public:
+    using Buffer = util::UniquePtr<std::vector<uint8_t>>;
+
+    static std::shared_ptr<ScratchBufferPool> Create() {
+        return std::shared_ptr<ScratchBufferPool>(new ScratchBufferPool);
+    }
+
+    Buffer Acquire(size_t size);
+private:
+    ScratchBufferPool() = default;
+    void Release(std::vector<uint8_t> *buffer);
+
+    std::mutex mu_;
+    std::vector<std::unique_ptr<std::vector<uint8_t>>> free_;
+};
+
+// I420 frame backed by a pooled buffer, planes are tightly packed.
+class ScaledI420Frame : public I420VideoFrame {
+public:
+    ScaledI420Frame(ScratchBufferPool::Buffer buffer, int w, int h);
+
+    int width() const override { return w_; }
+    int height() const override { return h_; }
+
+    const uint8_t* DataY() const override { return MutableDataY(); }
+    const uint8_t* DataU() const override { return MutableDataU(); }
+    const uint8_t* DataV() const override { return MutableDataV(); }
+
+    int StrideY() const override { return w_; }
+    int StrideU() const override { return (w_ + 1) / 2; }
+    int StrideV() const override { return (w_ + 1) / 2; }
+
+    uint8_t* MutableDataY() const { return buffer_->data(); }
+    uint8_t* MutableDataU() const { return MutableDataY() + w_ * h_; }
+    uint8_t* MutableDataV() const { return MutableDataU() + StrideU() * ((h_ + 1) / 2); }
+
+    static size_t BufferSize(int w, int h) {
+        return static_cast<size_t>(w) * h + 2 * static_cast<size_t>((w + 1) / 2) * ((h + 1) / 2);
+    }
+private:
+    ScratchBufferPool::Buffer buffer_;
+    int w_;
+    int h_;
+};
+
+// Downscales I420 frames to a target size before texture upload. Halves
+// with a SIMD 2x2 box filter while the frame is at least twice the target,
+// then finishes with a bilinear pass to the exact size, which also serves
+// for upscaling. Keeps scratch between frames, so one per sink.
+class I420Scaler {
+public:
+    explicit I420Scaler(std::shared_ptr<ScratchBufferPool> pool)
+        : pool_(std::move(pool)) {}
+
+    // Returns nullptr if the frame already has the target size, or, unless
+    // upscale is set, if it is not larger than the target.
+    std::unique_ptr<ScaledI420Frame> Scale(const I420VideoFrame& frame, int w, int h,
+                                           bool upscale = false);
+private:
+    void ScalePlane(const uint8_t *src, int src_stride, int src_w, int src_h,
+                    uint8_t *dst, int dst_w, int dst_h);
+
+    std::shared_ptr<ScratchBufferPool> pool_;
+    // bilinear column positions and weights, reused across frames
+    std::vector<int> xs_;
+    std::vector<int> fxs_;
+};
+}
+
+#endif // !_RTC_I420_SCALER_H_INCLUDED
@@ -1,5 +1,6 @@
 #include "render/interface.h"
 #include "render/sdl_renderer.h"
+#include "render/headless_renderer.h"
 
 using namespace rtc;
 
@@ -14,3 +15,18 @@ std::shared_ptr<VideoRendererInterface>
 VideoRendererInterface::Create(void *native_handle) {
     return SDLVideoRenderer::Create(native_handle);
 }
+
+// static 
+std::shared_ptr<VideoRendererInterface>
+VideoRendererInterface::Create(VideoRendererBackend backend, const char *title, int w, int h) {
+    switch (backend) {
+    case VideoRendererBackend::kSDL:
+        return SDLVideoRenderer::Create(title, w, h);
+    case VideoRendererBackend::kNull:
+        return NullVideoRenderer::Create(w, h);
+    case VideoRendererBackend::kOffscreen:
+        return OffscreenVideoRenderer::Create(w, h);
+    }
+
+    return nullptr;
+}
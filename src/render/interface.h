@@ -3,19 +3,54 @@
 
 #include <memory>
 
+#include "utility/histogram.h"
 #include "rtc_common_types.h"
 
 namespace rtc {
 
+enum class VideoRendererBackend {
+    // a window, needs a display
+    kSDL,
+    // counts frames and measures capture to render latency, draws nothing
+    kNull,
+    // composites all sinks into an I420 canvas in memory
+    kOffscreen
+};
+
 class VideoRendererInterface {
 protected:
     virtual ~VideoRendererInterface() = default;
 public:
     static std::shared_ptr<VideoRendererInterface> Create(const char *title, int w, int h);
     static std::shared_ptr<VideoRendererInterface> Create(void *native_handle);
+    static std::shared_ptr<VideoRendererInterface> Create(VideoRendererBackend backend,
+                                                          const char *title, int w, int h);
 
+    // x, y, w, h are fractions of the output size
     virtual std::unique_ptr<I420VideoSinkInterface> CreateSink(float x, float y, float w, float h) = 0;
+
+    // frames delivered to all sinks so far
+    virtual uint64_t frames_rendered() const = 0;
+
+    // glass-to-glass latency over all sinks, from each frame's capture time
+    // to it being on screen (or composited, for headless renderers), in
+    // microseconds; frames without a capture time are left out
+    virtual util::Histogram::Snapshot GetLatencyHistogram() const = 0;
 };
+
+// Adds the time since the frame's capture, for renderers to call once the
+// frame is shown.
+inline void RecordCaptureLatency(util::Histogram *latency_us, const I420VideoFrame& frame) {
+    auto capture_time_us = frame.capture_time_us();
+    if (capture_time_us <= 0) {
+        return;
+    }
+
+    auto elapsed_us = static_cast<int64_t>(util::MonotonicMicros()) - capture_time_us;
+    if (elapsed_us >= 0) {
+        latency_us->Add(static_cast<uint64_t>(elapsed_us));
+    }
+}
 }
 
 #endif // !_RTC_VIDEO_RENDER_INTERFACE_H_INCLUDED
@@ -0,0 +1,114 @@
+#include "render/plane_copy.h"
+
+#include <cstring>
+
+#include "SDL2/SDL_cpuinfo.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define RTC_PLANE_COPY_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define RTC_TARGET_AVX2 __attribute__((target("avx2")))
+#define RTC_TARGET_SSE2 __attribute__((target("sse2")))
+#else
+#define RTC_TARGET_AVX2
+#define RTC_TARGET_SSE2
+#endif
+
+namespace {
+
+using CopyRowFn = void (*)(const uint8_t *src, uint8_t *dst, int width);
+
+void CopyRowC(const uint8_t *src, uint8_t *dst, int width) {
+    ::memcpy(dst, src, width);
+}
+
+#ifdef RTC_PLANE_COPY_X86
+RTC_TARGET_SSE2
+void CopyRowSSE2(const uint8_t *src, uint8_t *dst, int width) {
+    int i = 0;
+    for (; i + 64 <= width; i += 64) {
+        auto a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        auto b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 16));
+        auto c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 32));
+        auto d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 48));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), a);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 16), b);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 32), c);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 48), d);
+    }
+
+    for (; i + 16 <= width; i += 16) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+    }
+
+    if (i < width) {
+        ::memcpy(dst + i, src + i, width - i);
+    }
+}
+
+RTC_TARGET_AVX2
+void CopyRowAVX2(const uint8_t *src, uint8_t *dst, int width) {
+    int i = 0;
+    for (; i + 128 <= width; i += 128) {
+        auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i + 32));
+        auto c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i + 64));
+        auto d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i + 96));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), a);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i + 32), b);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i + 64), c);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i + 96), d);
+    }
+
+    for (; i + 32 <= width; i += 32) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i)));
+    }
+
+    if (i < width) {
+        ::memcpy(dst + i, src + i, width - i);
+    }
+}
+#endif
+
+CopyRowFn SelectCopyRow() {
+#ifdef RTC_PLANE_COPY_X86
+    if (::SDL_HasAVX2()) {
+        return CopyRowAVX2;
+    }
+
+    if (::SDL_HasSSE2()) {
+        return CopyRowSSE2;
+    }
+#endif
+    return CopyRowC;
+}
+}
+
+namespace rtc {
+
+void CopyPlane(const uint8_t *src, int src_stride,
+               uint8_t *dst, int dst_stride,
+               int width, int height) {
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    if (src_stride == width && dst_stride == width) {
+        ::memcpy(dst, src, static_cast<size_t>(width) * height);
+        return;
+    }
+
+    static const CopyRowFn copy_row = SelectCopyRow();
+    for (int y = 0; y < height; ++y) {
+        copy_row(src, dst, width);
+        src += src_stride;
+        dst += dst_stride;
+    }
+}
+}
@@ -0,0 +1,16 @@
+#ifndef _RTC_PLANE_COPY_H_INCLUDED
+#define _RTC_PLANE_COPY_H_INCLUDED
+
+#include <cstdint>
+
+namespace rtc {
+
+// Copies a width x height byte plane between buffers with different strides.
+// Uses AVX2 or SSE2 row copies when the cpu supports them, and a single
+// memcpy when both planes are tightly packed.
+void CopyPlane(const uint8_t *src, int src_stride,
+               uint8_t *dst, int dst_stride,
+               int width, int height);
+}
+
+#endif // !_RTC_PLANE_COPY_H_INCLUDED
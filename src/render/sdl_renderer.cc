@@ -1,4 +1,6 @@
 #include "render/sdl_renderer.h"
+#include "render/plane_copy.h"
+#include "utility/probes.h"
 
 using namespace rtc;
 
@@ -8,6 +10,7 @@ class SDLVideoSink : public I420VideoSinkInterface {
 public:
     SDLVideoSink(std::shared_ptr<SDLVideoRenderer> renderer, float x, float y, float w, float h)
         : renderer_(renderer)
+        , scaler_(renderer->scratch_pool())
         , x_(x)
         , y_(y)
         , w_(w)
@@ -15,12 +18,20 @@ public:
 
 private:
     void OnFrame(const I420VideoFrame& video_frame) override {
-        UpdateYUVTexture(video_frame);
-
         SDL_Rect rect;
-        if (CalcTextureRect(&rect)) {
-            renderer_->RenderTexture(rect, texture_.get());
+        if (!CalcTextureRect(&rect)) {
+            UpdateYUVTexture(video_frame);
+            ++frames_dropped_;
+            return;
+        }
+
+        std::unique_ptr<ScaledI420Frame> scaled_frame;
+        if (renderer_->downscale_enabled()) {
+            scaled_frame = scaler_.Scale(video_frame, rect.w, rect.h);
         }
+
+        UpdateYUVTexture(scaled_frame ? *scaled_frame : video_frame);
+        renderer_->RenderTexture(rect, texture_.get(), video_frame);
     }
 
     void UpdateYUVTexture(const I420VideoFrame& frame) {
@@ -38,6 +49,12 @@ private:
             texture_ = renderer_->CreateTexture(frame.width(), frame.height());
         }
 
+        util::ScopedHistogramTimer timer(&renderer_->upload_time_us());
+        if (TextureUploadMode::kLock == renderer_->texture_upload_mode()
+            && LockAndCopyYUVTexture(frame)) {
+            return;
+        }
+
         ::SDL_UpdateYUVTexture(
             texture_.get(),
             nullptr,
@@ -50,7 +67,47 @@ private:
         );
     }
 
-    bool CalcTextureRect(SDL_Rect *rect) {
+    // IYUV streaming textures lock as three contiguous planes: Y with the
+    // returned pitch, then U and V with half the pitch and half the rows.
+    bool LockAndCopyYUVTexture(const I420VideoFrame& frame) {
+        void *pixels = nullptr;
+        int pitch = 0;
+        if (::SDL_LockTexture(texture_.get(), nullptr, &pixels, &pitch) < 0) {
+            return false;
+        }
+
+        int w = frame.width();
+        int h = frame.height();
+        int chroma_w = (w + 1) / 2;
+        int chroma_h = (h + 1) / 2;
+        int chroma_pitch = (pitch + 1) / 2;
+
+        auto dst_y = static_cast<uint8_t *>(pixels);
+        auto dst_u = dst_y + pitch * h;
+        auto dst_v = dst_u + chroma_pitch * chroma_h;
+
+        CopyPlane(frame.DataY(), frame.StrideY(), dst_y, pitch, w, h);
+        CopyPlane(frame.DataU(), frame.StrideU(), dst_u, chroma_pitch, chroma_w, chroma_h);
+        CopyPlane(frame.DataV(), frame.StrideV(), dst_v, chroma_pitch, chroma_w, chroma_h);
+
+        ::SDL_UnlockTexture(texture_.get());
+        return true;
+    }
+
+    I420VideoSinkWants wants() const override {
+        I420VideoSinkWants wants;
+
+        SDL_Rect rect;
+        if (CalcTextureRect(&rect) && rect.w > 0 && rect.h > 0) {
+            wants.max_pixel_count = rect.w * rect.h;
+        }
+
+        return wants;
+    }
+
+    uint64_t frames_dropped() const override { return frames_dropped_; }
+
+    bool CalcTextureRect(SDL_Rect *rect) const {
         int w;
         int h;
         if (!renderer_->GetOutputSize(&w, &h)) {
@@ -75,11 +132,14 @@ private:
 
     std::shared_ptr<SDLVideoRenderer> renderer_;
     util::UniquePtr<SDL_Texture> texture_;
+    I420Scaler scaler_;
 
     float x_;
     float y_;
     float w_;
     float h_;
+    // frame delivery thread only
+    uint64_t frames_dropped_ = 0;
 };
 }
 
@@ -138,7 +198,10 @@ util::UniquePtr<SDL_Texture> SDLVideoRenderer::CreateTexture(int w, int h) {
     };
 }
 
-void SDLVideoRenderer::RenderTexture(const SDL_Rect& rect, SDL_Texture *texture) {
+void SDLVideoRenderer::RenderTexture(const SDL_Rect& rect, SDL_Texture *texture,
+                                     const I420VideoFrame& frame) {
+    RTC_PROBE(sdl_render_begin, this);
+
     //::SDL_RenderClear(renderer_.get());
     ::SDL_LockMutex(mu_.get());
 
@@ -146,7 +209,11 @@ void SDLVideoRenderer::RenderTexture(const SDL_Rect& rect, SDL_Texture *texture)
     ::SDL_RenderPresent(renderer_.get());
 
     ::SDL_UnlockMutex(mu_.get());
+    ++frames_rendered_;
+    RecordCaptureLatency(&latency_us_, frame);
     //SDL_UpdateWindowSurfaceRects(window_.get(), &rect, 1);
+
+    RTC_PROBE(sdl_render_end, this);
 }
 
 bool SDLVideoRenderer::Init(SDL_Window *window) {
@@ -165,6 +232,7 @@ bool SDLVideoRenderer::Init(SDL_Window *window) {
     window_ = util::UniquePtr<SDL_Window>(window, ::SDL_DestroyWindow);
     renderer_ = std::move(renderer);
     mu_ = util::UniquePtr<SDL_mutex>{ ::SDL_CreateMutex(), ::SDL_DestroyMutex };
+    scratch_pool_ = ScratchBufferPool::Create();
 
     return true;
 }
@@ -1,13 +1,24 @@
 #ifndef _SDL_SDL_RENDERER_H_INCLUDED
 #define _SDL_SDL_RENDERER_H_INCLUDED
 
+#include <atomic>
+
 #include "SDL2/SDL.h"
 
 #include "utility/unique_ptr.h"
+#include "utility/histogram.h"
 #include "render/interface.h"
+#include "render/i420_scaler.h"
 
 namespace rtc {
 
+enum class TextureUploadMode {
+    // SDL_UpdateYUVTexture, goes through SDL's generic copy path
+    kUpdate,
+    // SDL_LockTexture and copy the planes straight into texture memory
+    kLock
+};
+
 class SDLVideoRenderer : public VideoRendererInterface
                        , public std::enable_shared_from_this<SDLVideoRenderer> {
 public:
@@ -16,16 +27,38 @@ public:
 
     bool GetOutputSize(int *w, int *h);
     util::UniquePtr<SDL_Texture> CreateTexture(int w, int h);
-    void RenderTexture(const SDL_Rect& rect, SDL_Texture *texture);
+    // presents the texture, then records the frame's glass-to-glass latency
+    void RenderTexture(const SDL_Rect& rect, SDL_Texture *texture, const I420VideoFrame& frame);
+
+    TextureUploadMode texture_upload_mode() const { return texture_upload_mode_.load(); }
+    void set_texture_upload_mode(TextureUploadMode mode) { texture_upload_mode_ = mode; }
+
+    // Downscale frames larger than their tile on the cpu before upload,
+    // instead of uploading full size planes and letting the gpu scale.
+    bool downscale_enabled() const { return downscale_enabled_.load(); }
+    void set_downscale_enabled(bool enabled) { downscale_enabled_ = enabled; }
+    const std::shared_ptr<ScratchBufferPool>& scratch_pool() const { return scratch_pool_; }
+
+    // per frame texture upload time of all sinks, in microseconds
+    util::Histogram& upload_time_us() { return upload_time_us_; }
 private:
     SDLVideoRenderer() = default;
     bool Init(SDL_Window *window);
 
     std::unique_ptr<I420VideoSinkInterface> CreateSink(float x, float y, float w, float h) override;
+    uint64_t frames_rendered() const override { return frames_rendered_.load(); }
+    util::Histogram::Snapshot GetLatencyHistogram() const override { return latency_us_.GetSnapshot(); }
 
     util::UniquePtr<SDL_Window> window_;
     util::UniquePtr<SDL_Renderer> renderer_;
     util::UniquePtr<SDL_mutex> mu_;
+
+    std::atomic<TextureUploadMode> texture_upload_mode_{ TextureUploadMode::kLock };
+    std::atomic<bool> downscale_enabled_{ false };
+    std::shared_ptr<ScratchBufferPool> scratch_pool_;
+    util::Histogram upload_time_us_;
+    util::Histogram latency_us_;
+    std::atomic<uint64_t> frames_rendered_{ 0 };
 };
 }
 #endif // !_SDL_SDL_RENDERER_H_INCLUDED
@@ -0,0 +1,34 @@
+#ifndef _RTC_AUDIO_SINK_H_INCLUDED
+#define _RTC_AUDIO_SINK_H_INCLUDED
+
+#include "api/mediastreaminterface.h"
+
+#include "rtc_common_types.h"
+
+namespace rtc {
+
+class AudioSinkAdapter : public webrtc::AudioTrackSinkInterface {
+public:
+    explicit AudioSinkAdapter(std::unique_ptr<PcmAudioSinkInterface> pcm_audio_sink)
+        : pcm_audio_sink_(std::move(pcm_audio_sink)) {}
+private:
+    void OnData(const void* audio_data,
+                int bits_per_sample,
+                int sample_rate,
+                size_t number_of_channels,
+                size_t number_of_frames) override {
+        if (16 != bits_per_sample) {
+            return;
+        }
+
+        pcm_audio_sink_->OnData(static_cast<const int16_t *>(audio_data),
+                                sample_rate,
+                                number_of_channels,
+                                number_of_frames);
+    }
+
+    std::unique_ptr<PcmAudioSinkInterface> pcm_audio_sink_;
+};
+}
+
+#endif // !_RTC_AUDIO_SINK_H_INCLUDED
@@ -1,11 +1,17 @@
 #include "rtc_call.h"
 
+#include <cstdlib>
+#include <vector>
+
 #include "json/json.h"
 #include "json/writer.h"
 #include "json/reader.h"
 
 #include "utility/scoped_guard.h"
+#include "utility/probes.h"
+#include "utility/tracer.h"
 #include "rtc_call_user.h"
+#include "rtc_call_engine.h"
 #include "rtc_video_capturer.h"
 
 using namespace rtc;
@@ -19,6 +25,61 @@ rtc_session::Contents MakeSdpContents(const Json::Value& body) {
     Json::FastWriter w;
     return { json_mime_type, w.write(body) };
 }
+
+// Carries the sender's capture time in NTP on the packets themselves, so a
+// receiver knows it without waiting for RTCP sender reports. A webrtc that
+// does not implement it leaves it out of the answer.
+const char kAbsCaptureTimeUri[] = "http://www.webrtc.org/experiments/rtp-hdrext/abs-capture-time";
+
+// Offers a header extension on every video section that lacks it, under
+// the lowest one-byte id (1-14) no section of the sdp uses yet.
+std::string AddVideoHeaderExtension(const std::string& sdp, const std::string& uri) {
+    std::vector<std::string> lines;
+    bool used_ids[15] = {};
+    for (size_t begin = 0; begin < sdp.size();) {
+        auto end = sdp.find("\r\n", begin);
+        if (std::string::npos == end) {
+            end = sdp.size();
+        }
+
+        lines.push_back(sdp.substr(begin, end - begin));
+        if (0 == lines.back().compare(0, 9, "a=extmap:")) {
+            auto id = std::atoi(lines.back().c_str() + 9);
+            if (id > 0 && id < 15) {
+                used_ids[id] = true;
+            }
+            if (std::string::npos != lines.back().find(uri)) {
+                return sdp;
+            }
+        }
+        begin = end + 2;
+    }
+
+    int id = 1;
+    while (id < 15 && used_ids[id]) {
+        ++id;
+    }
+    if (15 == id) {
+        return sdp;
+    }
+
+    std::string munged;
+    bool in_video = false;
+    auto extmap = "a=extmap:" + std::to_string(id) + " " + uri + "\r\n";
+    for (auto& line : lines) {
+        if (0 == line.compare(0, 2, "m=")) {
+            if (in_video) {
+                munged += extmap;
+            }
+            in_video = 0 == line.compare(0, 8, "m=video ");
+        }
+        munged += line + "\r\n";
+    }
+    if (in_video) {
+        munged += extmap;
+    }
+    return munged;
+}
 }
 
 //static 
@@ -44,9 +105,41 @@ std::shared_ptr<Call> Call::CreateCallee(CallUser& user,
     return call;
 }
 
+Call::~Call() {
+    // the adapters call back into this call from decode and capture threads
+    for (auto& sink : sinks_) {
+        sink.first->RemoveSink(sink.second.get());
+    }
+
+    if (handle_) {
+        user_.call_engine_->call_registry().Remove(handle_);
+    }
+
+    if (active_calls_) {
+        active_calls_->fetch_sub(1, std::memory_order_relaxed);
+    }
+    CountIceState(webrtc::PeerConnectionInterface::kIceConnectionMax);
+    if (pc_ && !pc_closed_.exchange(true)) {
+        user_.call_engine_->call_metrics().peer_connections.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    if (local_video_track_) {
+        local_video_track_->RemoveSink(&peer_wants_sink_);
+    }
+
+    for (auto& audio_sink : audio_sinks_) {
+        audio_sink.first->RemoveSink(audio_sink.second.get());
+    }
+}
+
 bool Call::InitCaller(std::unique_ptr<rtc_session::CallerInterface> caller,
                       CallObserver *observer) {
     SetObserver(observer);
+    handle_ = user_.call_engine_->call_registry().Add(shared_from_this());
+    trace_id_ = caller->trace_id();
+    trace_category_ = "caller";
+    active_calls_ = &user_.call_engine_->call_metrics().callers;
+    active_calls_->fetch_add(1, std::memory_order_relaxed);
 
     if (!CreatePeerConnectionAndStreams()) {
         return false;
@@ -60,6 +153,13 @@ bool Call::InitCaller(std::unique_ptr<rtc_session::CallerInterface> caller,
 }
 
 bool Call::InitCallee(std::unique_ptr<rtc_session::CalleeInterface> callee) {
+    auto& registry = user_.call_engine_->call_registry();
+    handle_ = registry.Add(shared_from_this());
+    registry.SetCallId(handle_, callee->call_id());
+    trace_id_ = callee->trace_id();
+    active_calls_ = &user_.call_engine_->call_metrics().callees;
+    active_calls_->fetch_add(1, std::memory_order_relaxed);
+
     callee->SetCallback(shared_from_this());
     callee_ = std::move(callee);
     return true;
@@ -78,9 +178,19 @@ bool Call::CreatePeerConnectionAndStreams() {
     }
 
     pc_ = pc_factory_->CreatePeerConnection(config, nullptr, nullptr, this);
+    if (!pc_) {
+        return false;
+    }
+    user_.call_engine_->call_metrics().peer_connections.fetch_add(1, std::memory_order_relaxed);
 
     auto stream = pc_factory_->CreateLocalMediaStream("stream1");
-    auto capture_device = OpenVideoCaptureDevice();
+    const auto& capture_options = user_.engine()->options().video_capture;
+    auto capture_device = OpenVideoCapturer(capture_options);
+    if (!capture_device
+        && CallEngineOptions::VideoCapture::Type::kDevice != capture_options.type) {
+        return false;
+    }
+
     if (!capture_device) {
         auto audio_track = pc_factory_->CreateAudioTrack("audio",
             pc_factory_->CreateAudioSource(nullptr));
@@ -95,6 +205,7 @@ bool Call::CreatePeerConnectionAndStreams() {
             return false;
         }
 
+        local_video_track_ = video_track;
         AddStream(stream->label(), video_track);
     }
 
@@ -117,16 +228,189 @@ rtc_session::CallInterface *Call::call() {
     return nullptr;
 }
 
+// The application makes the sink on its executor, which is then attached
+// back on the signaling thread.
 void Call::AddStream(const std::string& stream_label,
                      rtc::scoped_refptr<webrtc::VideoTrackInterface> track) {
+    bool remote = track->GetSource()->remote();
+    auto track_id = track->id();
+    NotifyObserver([this, track, remote, stream_label, track_id](CallObserver *observer) {
+        // shared, the functors below are copied
+        auto i420_sink = std::make_shared<std::unique_ptr<I420VideoSinkInterface>>(
+            observer->OnAddStream(remote, stream_label, track_id));
+        if (!*i420_sink) {
+            return;
+        }
+
+        OnSignalingThread([this, track, i420_sink] {
+            AttachVideoSink(track, std::move(*i420_sink));
+        });
+    });
+}
+
+void Call::AttachVideoSink(rtc::scoped_refptr<webrtc::VideoTrackInterface> track,
+                           std::unique_ptr<I420VideoSinkInterface> i420_sink) {
+    // removed while the application was making the sink
+    if (webrtc::MediaStreamTrackInterface::kEnded == track->state()) {
+        return;
+    }
+
+    bool remote = track->GetSource()->remote();
+    auto& sink_metrics = user_.call_engine_->call_metrics().sinks;
+
+    // The local preview shares the capturer with the encoder, and the
+    // broadcaster caps the capture to the smallest wants of all its sinks,
+    // so the preview takes whatever is captured for the peer.
+    if (!remote) {
+        auto sink = std::make_unique<VideoSinkAdapter>(std::move(i420_sink));
+        sink->AttachMetrics(&sink_metrics, trace_id_, remote);
+        auto inserted = sinks_.insert({ track.get(), std::move(sink) });
+        if (inserted.second) {
+            track->AddOrUpdateSink(inserted.first->second.get(), {});
+        }
+        return;
+    }
+
     auto sink = std::make_unique<VideoSinkAdapter>(
-        observer_->OnAddStream(
-        track->GetSource()->remote(),
-        stream_label,
-        track->id()));
+        std::move(i420_sink),
+        [this, track](VideoSinkAdapter *, const I420VideoSinkWants& wants) {
+            OnSinkWantsChanged(track, wants);
+        },
+        [this] {
+            MarkSetupStage(CallSetupStage::kFirstFrame);
+        });
+
+    sink->AttachMetrics(&sink_metrics, trace_id_, remote);
+    auto inserted = sinks_.insert({ track.get(), std::move(sink) });
+    if (!inserted.second) {
+        return;
+    }
+    auto adapter = inserted.first->second.get();
+    remote_sink_wants_ = adapter->wants();
+    track->AddOrUpdateSink(adapter, ToVideoSinkWants(adapter->wants()));
+
+    if (connected_) {
+        SendSinkWants(*remote_sink_wants_);
+    }
+}
+
+void Call::AddAudioStream(const std::string& stream_label,
+                          rtc::scoped_refptr<webrtc::AudioTrackInterface> track) {
+    auto track_id = track->id();
+    NotifyObserver([this, track, stream_label, track_id](CallObserver *observer) {
+        auto pcm_sink = std::make_shared<std::unique_ptr<PcmAudioSinkInterface>>(
+            observer->OnAddAudioStream(stream_label, track_id));
+        if (!*pcm_sink) {
+            return;
+        }
+
+        OnSignalingThread([this, track, pcm_sink] {
+            AttachAudioSink(track, std::move(*pcm_sink));
+        });
+    });
+}
+
+void Call::AttachAudioSink(rtc::scoped_refptr<webrtc::AudioTrackInterface> track,
+                           std::unique_ptr<PcmAudioSinkInterface> pcm_sink) {
+    auto sink = std::make_unique<AudioSinkAdapter>(std::move(pcm_sink));
+    track->AddSink(sink.get());
+    audio_sinks_.insert({ track.get(), std::move(sink) });
+}
+
+// fn runs only while the call is alive, and only once it has an observer
+void Call::NotifyObserver(std::function<void(CallObserver *)> fn) {
+    std::weak_ptr<Call> weak_call = weak_from_this();
+    user_.executor()->Post([weak_call, fn] {
+        auto call = weak_call.lock();
+        if (call && call->observer_) {
+            fn(call->observer_);
+        }
+    });
+}
+
+void Call::OnSignalingThread(std::function<void()> fn) {
+    auto signaling_thread = user_.call_engine_->signaling_thread();
+    if (signaling_thread->IsCurrent()) {
+        fn();
+        return;
+    }
+
+    invoker_.AsyncInvoke<void>(RTC_FROM_HERE, signaling_thread, std::move(fn));
+}
+
+// The adapter is looked up again on the signaling thread, it is gone if
+// the stream was removed in the meantime.
+void Call::OnSinkWantsChanged(rtc::scoped_refptr<webrtc::VideoTrackInterface> track,
+                              const I420VideoSinkWants& wants) {
+    invoker_.AsyncInvoke<void>(RTC_FROM_HERE,
+        user_.call_engine_->signaling_thread(),
+        [this, track, wants] {
+            auto it = sinks_.find(track.get());
+            if (sinks_.end() == it) {
+                return;
+            }
+            track->AddOrUpdateSink(it->second.get(), ToVideoSinkWants(wants));
+
+            remote_sink_wants_ = wants;
+            if (connected_) {
+                SendSinkWants(wants);
+            }
+        });
+}
+
+// The peer can't tell our tile size from the stream, so the wants of our
+// remote sink are sent as an in-dialog MESSAGE, the same way as candidates.
+void Call::SendSinkWants(const I420VideoSinkWants& wants) {
+    Json::Value body;
+    body["sink_wants"]["max_pixel_count"] = wants.max_pixel_count;
+    body["sink_wants"]["max_framerate_fps"] = wants.max_framerate_fps;
+
+    auto json_contents = MakeSdpContents(body);
+    if (call()) {
+        call()->Message(json_contents);
+    }
+}
+
+void Call::OnPeerSinkWants(const I420VideoSinkWants& wants) {
+    if (local_video_track_) {
+        local_video_track_->AddOrUpdateSink(&peer_wants_sink_, ToVideoSinkWants(wants));
+    }
+}
+
+void Call::MarkSetupStage(CallSetupStage stage) {
+    auto elapsed_us = setup_timeline_.Mark(stage);
+    if (elapsed_us >= 0) {
+        user_.call_engine_->RecordCallSetup(stage, elapsed_us);
+        util::TraceAsyncInstant(trace_category_, CallSetupStageName(stage), trace_id_);
+    }
+}
+
+// The next sample is scheduled once a report is delivered, so a slow
+// GetStats() delays sampling instead of piling requests up.
+void Call::ScheduleStatsSample() {
+    auto interval_ms = user_.call_engine_->options().stats_interval_ms;
+    if (0 == interval_ms) {
+        return;
+    }
 
-    track->AddOrUpdateSink(sink.get(), {});
-    sinks_.insert({ track.get(), std::move(sink) });
+    invoker_.AsyncInvokeDelayed<void>(RTC_FROM_HERE,
+        user_.call_engine_->signaling_thread(),
+        [this] {
+            if (pc_) {
+                pc_->GetStats(StatsCollectorCallback::Create(weak_from_this()));
+            }
+        },
+        interval_ms);
+}
+
+void Call::OnStatsDelivered(const rtc::scoped_refptr<const webrtc::RTCStatsReport>& report) {
+    auto stats = quality_sampler_.Reduce(*report);
+    user_.call_engine_->RecordCallQuality(stats);
+    NotifyObserver([stats](CallObserver *observer) {
+        observer->OnQualityStats(stats);
+    });
+
+    ScheduleStatsSample();
 }
 
 const CallUserInterface *Call::user() const {
@@ -145,15 +429,57 @@ const std::string& Call::peer() const {
     return empty_string;
 }
 
+CallSetupTimings Call::setup_timings() const {
+    return setup_timeline_.timings();
+}
+
+std::string Call::call_id() const {
+    if (caller_) {
+        return caller_->call_id();
+    }
+    return callee_ ? callee_->call_id() : std::string();
+}
+
+void Call::Hangup() {
+    if (auto session_call = call()) {
+        session_call->End();
+    }
+
+    // No dialog to end yet and so no terminal callback to wait for; an
+    // offer made after this is failed by the session, not sent.
+    if (caller_ && !invite_requested_.load()) {
+        user_.call_engine_->call_registry().SetEnded(handle_);
+    }
+}
+
+void Call::ClosePeerConnection() {
+    OnSignalingThread([this] {
+        if (pc_ && !pc_closed_.exchange(true)) {
+            pc_->Close();
+            user_.call_engine_->call_metrics().peer_connections.fetch_sub(1, std::memory_order_relaxed);
+        }
+    });
+}
+
 void Call::OnInit() {
 
 }
 
 void Call::OnFailure() {
+    user_.call_engine_->call_registry().SetEnded(handle_);
+    NotifyObserver([](CallObserver *observer) {
+        observer->OnError();
+    });
 
+    if (callee_) {
+        user_.OnCalleeQuit(handle_);
+    }
 }
 
 void Call::OnOffer(const std::string& offer) {
+    util::ScopedTrace trace(trace_category_, "Call::OnOffer", trace_id_);
+    MarkSetupStage(CallSetupStage::kOfferReceived);
+
     auto reject_response = util::MakeScopedGuard([&] {
         callee_->Reject();
     });
@@ -171,6 +497,7 @@ void Call::OnOffer(const std::string& offer) {
         return;
     }
 
+    util::TraceAsyncBegin(trace_category_, "SetRemoteDescription", trace_id_);
     pc_->SetRemoteDescription(SetSessionDescriptionObserver::Create(this, true), desc);
     pc_->CreateAnswer(CreateSessionDescriptionObserver::Create(this), nullptr);
 
@@ -178,6 +505,9 @@ void Call::OnOffer(const std::string& offer) {
 }
 
 void Call::OnAnswer(const std::string& answer) {
+    util::ScopedTrace trace(trace_category_, "Call::OnAnswer", trace_id_);
+    MarkSetupStage(CallSetupStage::kAnswerReceived);
+
     std::string offer;
     if (!caller_->GetLocalSdp(&offer)) {
         return;
@@ -201,12 +531,15 @@ void Call::OnAnswer(const std::string& answer) {
     if (!local_desc) {
         return;
     }
+    util::TraceAsyncBegin(trace_category_, "SetRemoteDescription", trace_id_);
     pc_->SetRemoteDescription(
         SetSessionDescriptionObserver::Create(this, true), 
         remote_desc);
 }
 
 void Call::OnMessage(const rtc_session::Contents& msg) {
+    RTC_PROBE(call_message, trace_id_, msg.body.size());
+
     auto reject_response = util::MakeScopedGuard([&] {
         call()->RejectNIT();
     });
@@ -226,6 +559,24 @@ void Call::OnMessage(const rtc_session::Contents& msg) {
         return;
     }
 
+    if (body.isMember("sink_wants")) {
+        const auto& wants_body = body["sink_wants"];
+        if (!wants_body.isObject()
+            || !wants_body["max_pixel_count"].isInt()
+            || !wants_body["max_framerate_fps"].isInt()) {
+            return;
+        }
+
+        I420VideoSinkWants wants;
+        wants.max_pixel_count = wants_body["max_pixel_count"].asInt();
+        wants.max_framerate_fps = wants_body["max_framerate_fps"].asInt();
+        OnPeerSinkWants(wants);
+
+        reject_response.depose();
+        call()->AcceptNIT();
+        return;
+    }
+
     if (!body.isMember("sdp_mid") || !body["sdp_mid"].isString()) {
         return;
     }
@@ -262,15 +613,45 @@ void Call::OnMessageResult(bool success) {
 }
 
 void Call::OnConnected() {
+    MarkSetupStage(CallSetupStage::kConnected);
+    NotifyObserver([](CallObserver *observer) {
+        observer->OnConnected();
+    });
 
+    invoker_.AsyncInvoke<void>(RTC_FROM_HERE,
+        user_.call_engine_->signaling_thread(),
+        [this] {
+            if (!connected_) {
+                ScheduleStatsSample();
+            }
+
+            connected_ = true;
+            if (remote_sink_wants_) {
+                SendSinkWants(*remote_sink_wants_);
+            }
+        });
 }
 
 void Call::OnTerminated() {
+    user_.call_engine_->call_registry().SetEnded(handle_);
+    NotifyObserver([](CallObserver *observer) {
+        observer->OnTerminated();
+    });
+
     if (callee_) {
-        user_.OnCalleeQuit(this);
+        user_.OnCalleeQuit(handle_);
     }
 }
 
+void Call::OnInviteSent() {
+    MarkSetupStage(CallSetupStage::kInviteSent);
+    user_.call_engine_->call_registry().SetCallId(handle_, caller_->call_id());
+}
+
+void Call::OnProvisional(int code) {
+    MarkSetupStage(CallSetupStage::kProvisional);
+}
+
 void Call::OnSignalingChange(
     webrtc::PeerConnectionInterface::SignalingState new_state)  {
 
@@ -281,13 +662,31 @@ void Call::OnAddStream(rtc::scoped_refptr<webrtc::MediaStreamInterface> stream)
     for (auto&& video_track : video_tracks) {
         AddStream(stream->label(), video_track);
     }
+
+    auto audio_tracks = stream->GetAudioTracks();
+    for (auto&& audio_track : audio_tracks) {
+        AddAudioStream(stream->label(), audio_track);
+    }
 }
 
 void Call::OnRemoveStream(
     rtc::scoped_refptr<webrtc::MediaStreamInterface> stream) {
     auto video_tracks = stream->GetVideoTracks();
     for (auto&& video_track : video_tracks) {
-        video_track->RemoveSink(sinks_[video_track].get());
+        auto it = sinks_.find(video_track.get());
+        if (sinks_.end() != it) {
+            video_track->RemoveSink(it->second.get());
+            sinks_.erase(it);
+        }
+    }
+
+    auto audio_tracks = stream->GetAudioTracks();
+    for (auto&& audio_track : audio_tracks) {
+        auto it = audio_sinks_.find(audio_track.get());
+        if (audio_sinks_.end() != it) {
+            audio_track->RemoveSink(it->second.get());
+            audio_sinks_.erase(it);
+        }
     }
 }
 
@@ -302,6 +701,26 @@ void Call::OnRenegotiationNeeded() {
 
 void Call::OnIceConnectionChange(
     webrtc::PeerConnectionInterface::IceConnectionState new_state) {
+    if (webrtc::PeerConnectionInterface::kIceConnectionConnected == new_state
+        || webrtc::PeerConnectionInterface::kIceConnectionCompleted == new_state) {
+        MarkSetupStage(CallSetupStage::kIceConnected);
+    }
+
+    CountIceState(new_state);
+}
+
+// Moves the call between the engine's ice state gauges, kIceConnectionMax
+// takes it out of all of them.
+void Call::CountIceState(webrtc::PeerConnectionInterface::IceConnectionState state) {
+    auto& ice_states = user_.call_engine_->call_metrics().ice_states;
+    if (ice_state_ < webrtc::PeerConnectionInterface::kIceConnectionMax) {
+        ice_states[ice_state_].fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    if (state < webrtc::PeerConnectionInterface::kIceConnectionMax) {
+        ice_states[state].fetch_add(1, std::memory_order_relaxed);
+    }
+    ice_state_ = state;
 }
 
 void Call::OnIceGatheringChange(
@@ -309,6 +728,9 @@ void Call::OnIceGatheringChange(
 }
 
 void Call::OnIceCandidate(const webrtc::IceCandidateInterface* candidate) {
+    RTC_PROBE(call_ice_candidate, trace_id_, candidate->sdp_mline_index());
+    MarkSetupStage(CallSetupStage::kFirstCandidate);
+
     std::string sdp;
     candidate->ToString(&sdp);
 
@@ -344,10 +766,15 @@ void Call::OnRemoveTrack(rtc::scoped_refptr<webrtc::RtpReceiverInterface> receiv
 
 void Call::OnCreateSessionDescriptionSuccess(
     webrtc::SessionDescriptionInterface* desc) {
+    MarkSetupStage(CallSetupStage::kLocalSdpCreated);
+
     std::string sdp;
     desc->ToString(&sdp);
 
+    // the offer is only applied in OnAnswer(), from the text sent here
     if (caller_) {
+        sdp = AddVideoHeaderExtension(sdp, kAbsCaptureTimeUri);
+        invite_requested_ = true;
         caller_->Invite(&sdp);
     } 
 
@@ -364,9 +791,15 @@ void Call::OnCreateSessionDescriptionFailure(const std::string& error) {
 }
 
 void Call::OnSetSessionDescriptionSuccess(bool remote) {
-
+    if (remote) {
+        util::TraceAsyncEnd(trace_category_, "SetRemoteDescription", trace_id_);
+        MarkSetupStage(CallSetupStage::kRemoteDescriptionSet);
+    }
 }
 
 void Call::OnSetSessionDescriptionFailure(bool remote, const std::string& e) {
+    if (remote) {
+        util::TraceAsyncEnd(trace_category_, "SetRemoteDescription", trace_id_);
+    }
 
 }
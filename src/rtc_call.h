@@ -1,12 +1,19 @@
 #ifndef _RTC_CALL_H_INCLUDED
 #define _RTC_CALL_H_INCLUDED
 
+#include <atomic>
+#include <functional>
 #include <map>
 
 #include "api/peerconnectioninterface.h"
+#include "rtc_base/asyncinvoker.h"
 
+#include "utility/optional.h"
 #include "rtc_call_interface.h"
 #include "rtc_video_sink.h"
+#include "rtc_audio_sink.h"
+#include "rtc_call_setup.h"
+#include "rtc_call_quality.h"
 #include "session/interface.h"
 
 namespace rtc {
@@ -27,7 +34,17 @@ public:
         const rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface>& pc_factory,
         std::unique_ptr<rtc_session::CalleeInterface> callee);
 
+    ~Call();
+
+    // on the user's executor, before any of the call's events reach it
     void SetObserver(CallObserver *observer) { observer_ = observer; }
+
+    uint64_t handle() const override { return handle_; }
+    std::string call_id() const override;
+    void Hangup() override;
+    // Closes the peer connection on the signaling thread now rather than
+    // when the call is released, at most once.
+    void ClosePeerConnection();
 private:
     Call(CallUser& user,
         const rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface>& pc_factory)
@@ -39,9 +56,26 @@ private:
     bool CreatePeerConnectionAndStreams();
     rtc_session::CallInterface *call();
     void AddStream(const std::string& stream_label, rtc::scoped_refptr<webrtc::VideoTrackInterface> track);
+    void AddAudioStream(const std::string& stream_label,
+                        rtc::scoped_refptr<webrtc::AudioTrackInterface> track);
+    void AttachVideoSink(rtc::scoped_refptr<webrtc::VideoTrackInterface> track,
+                         std::unique_ptr<I420VideoSinkInterface> i420_sink);
+    void AttachAudioSink(rtc::scoped_refptr<webrtc::AudioTrackInterface> track,
+                         std::unique_ptr<PcmAudioSinkInterface> pcm_sink);
+    void NotifyObserver(std::function<void(CallObserver *)> fn);
+    void OnSignalingThread(std::function<void()> fn);
+    void OnSinkWantsChanged(rtc::scoped_refptr<webrtc::VideoTrackInterface> track,
+                            const I420VideoSinkWants& wants);
+    void SendSinkWants(const I420VideoSinkWants& wants);
+    void OnPeerSinkWants(const I420VideoSinkWants& wants);
+    void MarkSetupStage(CallSetupStage stage);
+    void ScheduleStatsSample();
+    void OnStatsDelivered(const rtc::scoped_refptr<const webrtc::RTCStatsReport>& report);
+    void CountIceState(webrtc::PeerConnectionInterface::IceConnectionState state);
 
     const CallUserInterface *user() const override;
     const std::string& peer() const override;
+    CallSetupTimings setup_timings() const override;
 
     void OnInit() override;
     void OnFailure() override;
@@ -51,6 +85,8 @@ private:
     void OnMessageResult(bool success) override;
     void OnConnected() override;
     void OnTerminated() override;
+    void OnInviteSent() override;
+    void OnProvisional(int code) override;
 
     // Triggered when the SignalingState changed.
     void OnSignalingChange(
@@ -178,17 +214,68 @@ private:
         bool remote_;
     };
 
+    // holds the call weakly, a report may arrive after it is gone
+    class StatsCollectorCallback : public webrtc::RTCStatsCollectorCallback {
+    public:
+        static StatsCollectorCallback *Create(std::weak_ptr<Call> call) {
+            return new rtc::RefCountedObject<StatsCollectorCallback>{ std::move(call) };
+        }
+
+        explicit StatsCollectorCallback(std::weak_ptr<Call> call) : call_(std::move(call)) {}
+    private:
+        void OnStatsDelivered(const rtc::scoped_refptr<const webrtc::RTCStatsReport>& report) override {
+            if (auto call = call_.lock()) {
+                call->OnStatsDelivered(report);
+            }
+        }
+
+        std::weak_ptr<Call> call_;
+    };
+
     CallUser &user_;
     rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> pc_factory_;
 
     std::unique_ptr<rtc_session::CallerInterface> caller_;
     std::unique_ptr<rtc_session::CalleeInterface> callee_;
+    // the caller's offer went to the session, which ends the dialog itself
+    // from then on
+    std::atomic<bool> invite_requested_{ false };
 
     rtc::scoped_refptr<webrtc::PeerConnectionInterface> pc_;
+    // taken out of the engine's peer connection gauge
+    std::atomic<bool> pc_closed_{ false };
 
+    // read on the user's executor only
     CallObserver *observer_ = nullptr;
 
+    CallSetupTimeline setup_timeline_;
+    // signaling thread only
+    CallQualitySampler quality_sampler_;
+    // in the engine's CallRegistry, 0 until the call is initialized
+    uint64_t handle_ = 0;
+    // the session call's, so sip and webrtc events share a track
+    uint64_t trace_id_ = 0;
+    const char *trace_category_ = "callee";
+
+    // the engine's caller or callee gauge, and the ice state counted in it
+    std::atomic<int64_t> *active_calls_ = nullptr;
+    webrtc::PeerConnectionInterface::IceConnectionState ice_state_ =
+        webrtc::PeerConnectionInterface::kIceConnectionMax;
+
+    // signaling thread only
     std::map<webrtc::VideoTrackInterface *, std::unique_ptr<VideoSinkAdapter>> sinks_;
+    std::map<webrtc::AudioTrackInterface *, std::unique_ptr<AudioSinkAdapter>> audio_sinks_;
+
+    // the peer's remote tile size, applied to our capturer
+    rtc::scoped_refptr<webrtc::VideoTrackInterface> local_video_track_;
+    WantsOnlyVideoSink peer_wants_sink_;
+
+    // signaling thread only
+    util::Optional<I420VideoSinkWants> remote_sink_wants_;
+    bool connected_ = false;
+
+    // last so pending wants updates are cancelled before anything else goes
+    rtc::AsyncInvoker invoker_;
 };
 }
 
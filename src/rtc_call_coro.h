@@ -0,0 +1,180 @@
+#ifndef _RTC_CALL_CORO_H_INCLUDED
+#define _RTC_CALL_CORO_H_INCLUDED
+
+#include "utility/coro.h"
+
+#ifdef RTC_HAS_COROUTINES
+
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+
+#include "rtc_call_interface.h"
+
+namespace rtc {
+
+// Makes the video sinks of a CoroUser's calls, see CallObserver::OnAddStream().
+using CoroSinkFactory = std::function<std::unique_ptr<I420VideoSinkInterface>(
+    bool remote, const std::string& stream_label, const std::string& track_id)>;
+
+// The CallObserver behind a CoroCall. Its events arrive on the user's
+// executor and resume the awaiting coroutines right there.
+class CoroCallObserver : public CallObserver {
+public:
+    explicit CoroCallObserver(CoroSinkFactory sinks) : sinks_(std::move(sinks)) {}
+
+    util::AsyncResult<bool> connected() const { return connected_; }
+    util::AsyncResult<bool> terminated() const { return terminated_; }
+private:
+    friend class CoroUser;
+
+    void OnError() override {
+        connected_.Set(false);
+        terminated_.Set(true);
+    }
+
+    void OnConnected() override {
+        connected_.Set(true);
+    }
+
+    void OnTerminated() override {
+        connected_.Set(false);
+        terminated_.Set(true);
+    }
+
+    std::unique_ptr<I420VideoSinkInterface> OnAddStream(
+        bool remote, const std::string& stream_label, const std::string& track_id) override {
+        return sinks_ ? sinks_(remote, stream_label, track_id) : nullptr;
+    }
+
+    CoroSinkFactory sinks_;
+    util::AsyncResult<bool> connected_;
+    util::AsyncResult<bool> terminated_;
+
+    // under the CoroUser's lock
+    std::weak_ptr<CallInterface> call_;
+    bool attached_ = false;
+};
+
+// Dropping it releases the call, which hangs up.
+class CoroCall {
+public:
+    CoroCall(std::shared_ptr<CallInterface> call, std::shared_ptr<CoroCallObserver> observer)
+        : call_(std::move(call))
+        , observer_(std::move(observer)) {}
+
+    const std::shared_ptr<CallInterface>& call() const { return call_; }
+
+    // true once the dialog is established, false if it failed or ended first
+    util::AsyncResult<bool> Connected() const { return observer_->connected(); }
+    util::AsyncResult<bool> Terminated() const { return observer_->terminated(); }
+private:
+    std::shared_ptr<CallInterface> call_;
+    std::shared_ptr<CoroCallObserver> observer_;
+};
+
+// A user driven by coroutines instead of observers:
+//
+//     auto user = CoroUser::Create(engine, options);
+//     if (co_await user->Login()) {
+//         auto call = co_await user->MakeCall("peer");
+//     }
+//
+// Coroutines resume on the user's executor, see CallUserOptions::executor,
+// so a ThreadExecutor or PollableExecutor keeps them off the engine threads.
+class CoroUser : public CallUserObserver {
+public:
+    static std::unique_ptr<CoroUser> Create(const std::shared_ptr<CallEngineInterface>& engine,
+                                            const CallUserOptions& options,
+                                            CoroSinkFactory sinks = nullptr) {
+        std::unique_ptr<CoroUser> user(new CoroUser(std::move(sinks)));
+        user->user_ = engine->CreateUser(options, user.get());
+        if (!user->user_) {
+            return nullptr;
+        }
+        return user;
+    }
+
+    ~CoroUser() override {
+        user_.reset();
+    }
+
+    const std::shared_ptr<CallUserInterface>& user() const { return user_; }
+
+    // the first login result, the engine logs in on creation
+    util::AsyncResult<bool> Login() const { return login_; }
+
+    // resumes once the call is established, with nullptr if it is not
+    util::Task<std::shared_ptr<CoroCall>> MakeCall(std::string peer) {
+        auto observer = NewObserver();
+        auto call = user_->MakeCall(peer, observer.get());
+        if (!Attach(observer, call)) {
+            co_return nullptr;
+        }
+
+        auto coro_call = std::make_shared<CoroCall>(std::move(call), std::move(observer));
+        if (!co_await coro_call->Connected()) {
+            co_return nullptr;
+        }
+        co_return coro_call;
+    }
+
+    // the next incoming call, answered by the engine already
+    auto NextCallee() { return callees_.Pop(); }
+private:
+    explicit CoroUser(CoroSinkFactory sinks) : sinks_(std::move(sinks)) {}
+
+    void OnLogin(bool ok) override {
+        login_.Set(ok);
+    }
+
+    CallObserver *OnCallee(std::shared_ptr<CallInterface> callee) override {
+        auto observer = NewObserver();
+        Attach(observer, callee);
+        callees_.Push(std::make_shared<CoroCall>(std::move(callee), observer));
+        return observer.get();
+    }
+
+    // Observers outlive their CoroCall, as a Call may still raise events
+    // after the application has let go of it, and are dropped once the
+    // Call itself is gone.
+    std::shared_ptr<CoroCallObserver> NewObserver() {
+        auto observer = std::make_shared<CoroCallObserver>(sinks_);
+
+        std::lock_guard<std::mutex> guard(mu_);
+        observers_.remove_if([](const std::shared_ptr<CoroCallObserver>& o) {
+            return o->attached_ && o->call_.expired();
+        });
+        observers_.push_back(observer);
+        return observer;
+    }
+
+    bool Attach(const std::shared_ptr<CoroCallObserver>& observer,
+                const std::shared_ptr<CallInterface>& call) {
+        std::lock_guard<std::mutex> guard(mu_);
+        if (!call) {
+            observers_.remove(observer);
+            return false;
+        }
+
+        observer->call_ = call;
+        observer->attached_ = true;
+        return true;
+    }
+
+    CoroSinkFactory sinks_;
+    util::AsyncResult<bool> login_;
+    util::AsyncQueue<std::shared_ptr<CoroCall>> callees_;
+
+    std::mutex mu_;
+    std::list<std::shared_ptr<CoroCallObserver>> observers_;
+
+    // last, so the user and its calls go first
+    std::shared_ptr<CallUserInterface> user_;
+};
+}
+
+#endif
+
+#endif // !_RTC_CALL_CORO_H_INCLUDED
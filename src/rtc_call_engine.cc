@@ -1,8 +1,15 @@
 #include "rtc_call_engine.h"
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
 #include "api/audio_codecs/builtin_audio_decoder_factory.h"
 #include "api/audio_codecs/builtin_audio_encoder_factory.h"
+#include "rtc_base/nullsocketserver.h"
 
+#include "utility/prometheus.h"
+#include "rtc_call.h"
 #include "rtc_call_user.h"
 
 namespace rtc {
@@ -11,6 +18,54 @@ std::shared_ptr<CallEngineInterface>
 CreateCallEngine(const CallEngineOptions& options) {
     return CallEngine::Create(options);
 }
+
+namespace {
+
+std::unique_ptr<InstrumentedThread> StartThread(std::unique_ptr<rtc::SocketServer> ss,
+                                                const std::string& name,
+                                                const std::string& name_prefix,
+                                                uint64_t affinity) {
+    auto thread = std::make_unique<InstrumentedThread>(std::move(ss), name, affinity);
+    if (!name_prefix.empty()) {
+        thread->SetName(name_prefix + name, nullptr);
+    }
+
+    if (!thread->Start()) {
+        return nullptr;
+    }
+    return thread;
+}
+}
+
+const char *CallSetupStageName(CallSetupStage stage) {
+    switch (stage) {
+    case CallSetupStage::kLocalSdpCreated: return "local_sdp_created";
+    case CallSetupStage::kInviteSent: return "invite_sent";
+    case CallSetupStage::kOfferReceived: return "offer_received";
+    case CallSetupStage::kProvisional: return "provisional";
+    case CallSetupStage::kAnswerReceived: return "answer_received";
+    case CallSetupStage::kConnected: return "connected";
+    case CallSetupStage::kRemoteDescriptionSet: return "remote_description_set";
+    case CallSetupStage::kFirstCandidate: return "first_candidate";
+    case CallSetupStage::kIceConnected: return "ice_connected";
+    case CallSetupStage::kFirstFrame: return "first_frame";
+    default: return "unknown";
+    }
+}
+
+const char *CallQualityMetricName(CallQualityMetric metric) {
+    switch (metric) {
+    case CallQualityMetric::kRtt: return "rtt_ms";
+    case CallQualityMetric::kJitter: return "jitter_ms";
+    case CallQualityMetric::kLoss: return "loss_percent";
+    case CallQualityMetric::kSendBitrate: return "send_kbps";
+    case CallQualityMetric::kRecvBitrate: return "recv_kbps";
+    case CallQualityMetric::kFramerate: return "framerate";
+    case CallQualityMetric::kDecodeTime: return "decode_ms";
+    case CallQualityMetric::kJitterBufferDelay: return "jitter_buffer_ms";
+    default: return "unknown";
+    }
+}
 }
 
 using namespace rtc;
@@ -67,26 +122,41 @@ bool CallEngine::Initialize() {
     }
 
     options.compression = options_.session.compression;
+    options.thread_name_prefix = options_.threads.name_prefix;
+    options.thread_affinity = options_.threads.sip_affinity;
     session_stack_ = rtc_session::CreateStack(options);
     if (!session_stack_) {
         return false;
     }
 
-    network_thread_ = rtc::Thread::CreateWithSocketServer();
-    if (!network_thread_->Start()) {
+    auto& threads = options_.threads;
+    network_thread_ = StartThread(rtc::SocketServer::CreateDefault(), "network",
+                                  threads.name_prefix, threads.network_affinity);
+    if (!network_thread_) {
         return false;
     }
 
-    worker_thread_ = rtc::Thread::Create();
-    if (!worker_thread_->Start()) {
+    worker_thread_ = StartThread(std::make_unique<rtc::NullSocketServer>(), "worker",
+                                 threads.name_prefix, threads.worker_affinity);
+    if (!worker_thread_) {
         return false;
     }
 
-    signaling_thread_ = rtc::Thread::Create();
-    if (!signaling_thread_->Start()) {
+    signaling_thread_ = StartThread(std::make_unique<rtc::NullSocketServer>(), "signaling",
+                                    threads.name_prefix, threads.signaling_affinity);
+    if (!signaling_thread_) {
         return false;
     }
 
+    if (0 != options_.metrics.port) {
+        metrics_server_ = MetricsServer::Create(options_.metrics.port, [this] {
+            return GetMetricsText();
+        });
+        if (!metrics_server_) {
+            return false;
+        }
+    }
+
     return true;
 }
 
@@ -94,3 +164,281 @@ std::shared_ptr<CallUserInterface>
 CallEngine::CreateUser(const CallUserOptions& options, CallUserObserver *observer) {
     return CallUser::Create(options, observer, shared_from_this());
 }
+
+std::shared_ptr<CallInterface> CallEngine::FindCall(uint64_t handle) const {
+    return call_registry_.Find(handle);
+}
+
+std::shared_ptr<CallInterface> CallEngine::FindCallById(const std::string& call_id) const {
+    return call_registry_.FindByCallId(call_id);
+}
+
+// Each hangup goes to its user's dum thread, so a batch spreads over all
+// of them; the window refills as dialogs end rather than batch by batch.
+TerminateReport CallEngine::TerminateAllCalls(const TerminateOptions& options) {
+    auto start = CallRegistry::Clock::now();
+    auto deadline = start + std::chrono::milliseconds(options.deadline_ms);
+    auto batch_size = std::max<size_t>(options.batch_size, 1);
+
+    auto calls = call_registry_.Live();
+    TerminateReport report;
+    report.calls = calls.size();
+
+    size_t sent = 0;
+    for (; sent < calls.size(); ++sent) {
+        if (!call_registry_.WaitEnding(batch_size, deadline)) {
+            break;
+        }
+
+        if (call_registry_.SetEnding(calls[sent]->handle())) {
+            calls[sent]->Hangup();
+        }
+    }
+    call_registry_.WaitEnding(1, deadline);
+
+    report.not_sent = calls.size() - sent;
+    report.ended = std::count_if(calls.begin(), calls.end(), [this](const std::shared_ptr<Call>& call) {
+        return call_registry_.Ended(call->handle());
+    });
+    report.elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        CallRegistry::Clock::now() - start).count();
+    return report;
+}
+
+ShutdownReport CallEngine::Shutdown(const ShutdownOptions& options) {
+    auto start = CallRegistry::Clock::now();
+    auto deadline = start + std::chrono::milliseconds(options.deadline_ms);
+    auto remaining_ms = [&deadline] {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - CallRegistry::Clock::now()).count();
+        return static_cast<uint32_t>(std::max<int64_t>(left, 0));
+    };
+
+    ShutdownReport report;
+    TerminateOptions terminate;
+    terminate.batch_size = options.call_batch_size;
+    terminate.deadline_ms = remaining_ms();
+    report.calls = TerminateAllCalls(terminate);
+
+    auto logout = session_stack_->LogoutAll(options.logout_batch_size, remaining_ms());
+    report.users = logout.users;
+    report.logged_out = logout.logged_out;
+
+    // queued on the signaling thread together, not one per released call
+    for (auto& call : call_registry_.All()) {
+        call->ClosePeerConnection();
+    }
+
+    auto& peer_connections = call_metrics_.peer_connections;
+    while (peer_connections.load(std::memory_order_relaxed) > 0
+        && CallRegistry::Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    report.peer_connections = static_cast<size_t>(
+        std::max<int64_t>(peer_connections.load(std::memory_order_relaxed), 0));
+    report.elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        CallRegistry::Clock::now() - start).count();
+    return report;
+}
+
+util::Histogram::Snapshot CallEngine::GetCallSetupHistogram(CallSetupStage stage) const {
+    if (stage >= CallSetupStage::kCount) {
+        return {};
+    }
+    return call_setup_us_[static_cast<size_t>(stage)].GetSnapshot();
+}
+
+void CallEngine::RecordCallQuality(const CallQualityStats& stats) {
+    // negative (or NaN) would make the cast undefined; 0 is a real sample,
+    // a call without loss
+    auto add = [this](CallQualityMetric metric, double value) {
+        if (!(value >= 0)) {
+            return;
+        }
+        call_quality_[static_cast<size_t>(metric)].Add(static_cast<uint64_t>(value * 1000));
+    };
+
+    if (stats.rtt_ms > 0) {
+        add(CallQualityMetric::kRtt, stats.rtt_ms);
+    }
+
+    if (stats.jitter_ms > 0) {
+        add(CallQualityMetric::kJitter, stats.jitter_ms);
+    }
+
+    if (0 == stats.interval_ms) {
+        return;
+    }
+
+    add(CallQualityMetric::kLoss, stats.loss_percent);
+    add(CallQualityMetric::kSendBitrate, stats.send_kbps);
+    add(CallQualityMetric::kRecvBitrate, stats.recv_kbps);
+
+    if (stats.framerate > 0) {
+        add(CallQualityMetric::kFramerate, stats.framerate);
+        add(CallQualityMetric::kDecodeTime, stats.decode_ms);
+    }
+
+    if (stats.jitter_buffer_ms > 0) {
+        add(CallQualityMetric::kJitterBufferDelay, stats.jitter_buffer_ms);
+    }
+}
+
+rtc_session::Admission CallEngine::AdmitCallee() {
+    auto& limits = options_.admission;
+    auto load = [](const std::atomic<int64_t>& gauge) {
+        auto value = gauge.load(std::memory_order_relaxed);
+        return value > 0 ? static_cast<uint64_t>(value) : 0;
+    };
+    auto over = [](uint64_t value, uint32_t limit) {
+        return 0 != limit && value >= limit;
+    };
+
+    // the slot is taken before looking, so INVITEs admitted on several dum
+    // threads at once cannot all see the same free one
+    auto admitting = call_metrics_.admitting.fetch_add(1, std::memory_order_relaxed);
+    auto calls = load(call_metrics_.callers) + load(call_metrics_.callees)
+        + static_cast<uint64_t>(std::max<int64_t>(admitting, 0));
+
+    // cheapest first, the cpu sample is a syscall once a second
+    auto reason = AdmissionReason::kCount;
+    if (over(calls, limits.max_calls)) {
+        reason = AdmissionReason::kCalls;
+    } else if (over(load(call_metrics_.peer_connections), limits.max_peer_connections)) {
+        reason = AdmissionReason::kPeerConnections;
+    } else if (over(session_stack_->GetMetrics().stack_queue_depth, limits.max_stack_queue_depth)) {
+        reason = AdmissionReason::kStackQueue;
+    } else if (0 != limits.max_cpu_percent && cpu_load_.percent() >= limits.max_cpu_percent) {
+        reason = AdmissionReason::kCpu;
+    }
+
+    rtc_session::Admission admission;
+    if (AdmissionReason::kCount == reason) {
+        call_metrics_.admitted.fetch_add(1, std::memory_order_relaxed);
+        return admission;
+    }
+
+    ReleaseAdmission();
+    call_metrics_.rejected[static_cast<size_t>(reason)].fetch_add(1, std::memory_order_relaxed);
+    admission.accept = false;
+    admission.retry_after_sec = limits.retry_after_sec;
+    return admission;
+}
+
+util::Histogram::Snapshot CallEngine::GetCallQualityHistogram(CallQualityMetric metric) const {
+    if (metric >= CallQualityMetric::kCount) {
+        return {};
+    }
+    return call_quality_[static_cast<size_t>(metric)].GetSnapshot();
+}
+
+std::vector<util::ThreadSnapshot> CallEngine::GetThreadStats() const {
+    auto stats = session_stack_->GetThreadStats();
+    for (auto thread : { network_thread_.get(), worker_thread_.get(), signaling_thread_.get() }) {
+        if (thread) {
+            stats.push_back(thread->GetThreadStats());
+        }
+    }
+    return stats;
+}
+
+std::string CallEngine::GetMetricsText() const {
+    util::PrometheusWriter out;
+
+    auto stack = session_stack_->GetMetrics();
+    out.Family("rtc_sip_users", "gauge", "Users per registration state.");
+    for (size_t i = 0; i < static_cast<size_t>(rtc_session::UserState::kCount); ++i) {
+        out.Sample("rtc_sip_users", stack.users[i],
+                   { { "state", rtc_session::UserStateName(static_cast<rtc_session::UserState>(i)) } });
+    }
+
+    out.Family("rtc_sip_transactions", "gauge",
+               "SIP transactions in flight, as of the stack's last statistics report.");
+    out.Sample("rtc_sip_transactions", stack.client_transactions, { { "role", "client" } });
+    out.Sample("rtc_sip_transactions", stack.server_transactions, { { "role", "server" } });
+
+    out.Family("rtc_sip_messages_total", "counter", "In-dialog MESSAGE requests.");
+    out.Sample("rtc_sip_messages_total", stack.messages_sent, { { "direction", "sent" } });
+    out.Sample("rtc_sip_messages_total", stack.messages_received, { { "direction", "received" } });
+
+    out.Family("rtc_calls", "gauge", "Live calls.");
+    out.Sample("rtc_calls", call_metrics_.callers.load(std::memory_order_relaxed), { { "role", "caller" } });
+    out.Sample("rtc_calls", call_metrics_.callees.load(std::memory_order_relaxed), { { "role", "callee" } });
+
+    out.Family("rtc_peer_connections", "gauge", "Live PeerConnections.");
+    out.Sample("rtc_peer_connections", call_metrics_.peer_connections.load(std::memory_order_relaxed));
+
+    out.Family("rtc_call_admissions_total", "counter",
+               "Incoming calls admitted, and rejected with a 503 per limit reached.");
+    out.Sample("rtc_call_admissions_total", call_metrics_.admitted.load(std::memory_order_relaxed),
+               { { "result", "admitted" }, { "reason", "" } });
+    for (size_t i = 0; i < CallMetrics::kAdmissionReasons; ++i) {
+        out.Sample("rtc_call_admissions_total", call_metrics_.rejected[i].load(std::memory_order_relaxed),
+                   { { "result", "rejected" },
+                     { "reason", AdmissionReasonName(static_cast<AdmissionReason>(i)) } });
+    }
+
+    out.Family("rtc_call_quality", "summary",
+               "The stats samples of all calls, see CallQualityStats.");
+    for (size_t i = 0; i < static_cast<size_t>(CallQualityMetric::kCount); ++i) {
+        auto snapshot = call_quality_[i].GetSnapshot();
+        auto name = CallQualityMetricName(static_cast<CallQualityMetric>(i));
+        for (auto& quantile : { std::make_pair(50.0, "0.5"), std::make_pair(95.0, "0.95") }) {
+            out.Sample("rtc_call_quality", snapshot.Percentile(quantile.first) / 1000.0,
+                       { { "metric", name }, { "quantile", quantile.second } });
+        }
+        out.Sample("rtc_call_quality_sum", snapshot.sum / 1000.0, { { "metric", name } });
+        out.Sample("rtc_call_quality_count", snapshot.count, { { "metric", name } });
+    }
+
+    out.Family("rtc_ice_connections", "gauge", "Calls per ICE connection state.");
+    for (size_t i = 0; i < CallMetrics::kIceStates; ++i) {
+        auto state = static_cast<webrtc::PeerConnectionInterface::IceConnectionState>(i);
+        out.Sample("rtc_ice_connections", call_metrics_.ice_states[i].load(std::memory_order_relaxed),
+                   { { "state", IceConnectionStateName(state) } });
+    }
+
+    // by source only, per call series would grow with every call made
+    auto& sinks = call_metrics_.sinks;
+    size_t live_sinks[2] = {};
+    sinks.ForEach([&](size_t index, const SinkMetricsTable::Slot& slot) {
+        ++live_sinks[slot.remote.load(std::memory_order_relaxed) ? 1 : 0];
+    });
+
+    out.Family("rtc_video_sinks", "gauge", "Live video sinks with a metrics slot.");
+    for (bool remote : { false, true }) {
+        out.Sample("rtc_video_sinks", live_sinks[remote ? 1 : 0],
+                   { { "source", remote ? "remote" : "local" } });
+    }
+
+    // frames and dropped are read apart, so rendered is clamped at 0
+    out.Family("rtc_video_sink_frames_rendered_total", "counter", "Frames shown by video sinks.");
+    for (bool remote : { false, true }) {
+        auto frames = sinks.totals(remote).frames.load(std::memory_order_relaxed);
+        auto dropped = sinks.totals(remote).dropped.load(std::memory_order_relaxed);
+        out.Sample("rtc_video_sink_frames_rendered_total", frames > dropped ? frames - dropped : 0,
+                   { { "source", remote ? "remote" : "local" } });
+    }
+
+    out.Family("rtc_video_sink_frames_dropped_total", "counter",
+               "Frames video sinks took but did not show.");
+    for (bool remote : { false, true }) {
+        out.Sample("rtc_video_sink_frames_dropped_total",
+                   sinks.totals(remote).dropped.load(std::memory_order_relaxed),
+                   { { "source", remote ? "remote" : "local" } });
+    }
+
+    out.Family("rtc_thread_queue_depth", "gauge",
+               "Tasks waiting for an engine thread, sampled by the thread as it runs.");
+    out.Sample("rtc_thread_queue_depth", stack.stack_queue_depth, { { "thread", "sip_stack" } });
+    out.Sample("rtc_thread_queue_depth", stack.dum_queue_depth, { { "thread", "dum" } });
+    for (auto thread : { network_thread_.get(), worker_thread_.get(), signaling_thread_.get() }) {
+        if (thread) {
+            out.Sample("rtc_thread_queue_depth", thread->published_queue_depth(),
+                       { { "thread", thread->stats_name() } });
+        }
+    }
+
+    return out.str();
+}
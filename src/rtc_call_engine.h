@@ -6,8 +6,14 @@
 #include "rtc_base/thread.h"
 #include "api/peerconnectioninterface.h"
 
+#include "utility/cpu_load.h"
+#include "utility/histogram.h"
 #include "session/interface.h"
 #include "rtc_call_interface.h"
+#include "rtc_call_registry.h"
+#include "rtc_instrumented_thread.h"
+#include "rtc_metrics.h"
+#include "rtc_metrics_server.h"
 
 namespace rtc {
 
@@ -22,18 +28,53 @@ public:
     std::unique_ptr<rtc_session::UserInterface> CreateSessionUser(
         const rtc_session::UserOptions& options,  std::shared_ptr<rtc_session::UserCallback> callback);
 
+    rtc::Thread *signaling_thread() const { return signaling_thread_.get(); }
+    CallMetrics& call_metrics() { return call_metrics_; }
+    CallRegistry& call_registry() { return call_registry_; }
+
+    void RecordCallSetup(CallSetupStage stage, int64_t elapsed_us) {
+        call_setup_us_[static_cast<size_t>(stage)].Add(static_cast<uint64_t>(elapsed_us));
+    }
+    void RecordCallQuality(const CallQualityStats& stats);
+
+    // whether the engine has room for another incoming call, from any dum
+    // thread; counted in call_metrics(). An accepted call holds a slot
+    // until ReleaseAdmission(), to be called once its Call exists or once
+    // it is known it never will.
+    rtc_session::Admission AdmitCallee();
+    void ReleaseAdmission() {
+        call_metrics_.admitting.fetch_sub(1, std::memory_order_relaxed);
+    }
+
     const CallEngineOptions& options() const override { return options_; }
     std::shared_ptr<CallUserInterface> CreateUser(const CallUserOptions& options,
                                                   CallUserObserver *observer) override;
+    std::shared_ptr<CallInterface> FindCall(uint64_t handle) const override;
+    std::shared_ptr<CallInterface> FindCallById(const std::string& call_id) const override;
+    TerminateReport TerminateAllCalls(const TerminateOptions& options) override;
+    ShutdownReport Shutdown(const ShutdownOptions& options) override;
+    util::Histogram::Snapshot GetCallSetupHistogram(CallSetupStage stage) const override;
+    util::Histogram::Snapshot GetCallQualityHistogram(CallQualityMetric metric) const override;
+    std::vector<util::ThreadSnapshot> GetThreadStats() const override;
+    std::string GetMetricsText() const override;
 private:
     explicit CallEngine(const CallEngineOptions& options) : options_(options) {};
     bool Initialize();
 
     CallEngineOptions options_;
     std::unique_ptr<rtc_session::StackInterface> session_stack_;
-    std::unique_ptr<rtc::Thread> network_thread_;
-    std::unique_ptr<rtc::Thread> worker_thread_;
-    std::unique_ptr<rtc::Thread> signaling_thread_;
+    std::unique_ptr<InstrumentedThread> network_thread_;
+    std::unique_ptr<InstrumentedThread> worker_thread_;
+    std::unique_ptr<InstrumentedThread> signaling_thread_;
+
+    util::Histogram call_setup_us_[static_cast<size_t>(CallSetupStage::kCount)];
+    util::Histogram call_quality_[static_cast<size_t>(CallQualityMetric::kCount)];
+    CallMetrics call_metrics_;
+    CallRegistry call_registry_;
+    util::ProcessCpuLoad cpu_load_;
+
+    // last, its thread reads everything above
+    std::unique_ptr<MetricsServer> metrics_server_;
 };
 }
 
@@ -6,6 +6,9 @@
 #include <string>
 #include <cstdint>
 
+#include "utility/executor.h"
+#include "utility/histogram.h"
+#include "utility/thread_stats.h"
 #include "rtc_common_types.h"
 
 namespace rtc {
@@ -14,13 +17,104 @@ class CallInterface;
 class CallUserInterface;
 class CallEngineInterface;
 
+// One GetStats() sample of a call, reduced over its streams. Rates and
+// averages cover the time since the previous sample and are 0 in the
+// first one; members this webrtc does not report stay 0 as well.
+struct CallQualityStats {
+    // since the previous sample, 0 for the first
+    uint32_t interval_ms = 0;
+    // current round trip time of the nominated candidate pair
+    double rtt_ms = 0;
+    // worst interarrival jitter over received streams
+    double jitter_ms = 0;
+    // received packets lost, percent of those expected
+    double loss_percent = 0;
+    double send_kbps = 0;
+    double recv_kbps = 0;
+    // frames decoded per second over received video
+    double framerate = 0;
+    // average per decoded frame
+    double decode_ms = 0;
+    // average per sample emitted from the jitter buffers
+    double jitter_buffer_ms = 0;
+};
+
+// Called on the executor of the call's user, see CallUserOptions::executor.
+// A sink returned by OnAddStream() or OnAddAudioStream() is attached once
+// the callback returns, media before that is not delivered to it.
 class CallObserver {
 protected:
     virtual ~CallObserver() = default;
 public:
+    // the INVITE failed, the call ends without connecting
     virtual void OnError() = 0;
+
+    // the dialog is established, media may still be setting up
+    virtual void OnConnected() {}
+    // the dialog has ended, by either side; no events follow
+    virtual void OnTerminated() {}
+
     virtual std::unique_ptr<I420VideoSinkInterface> OnAddStream(
         bool remote, const std::string&stream_label, const std::string&track_id) = 0;
+
+    // remote audio tracks only, return nullptr to not receive pcm
+    virtual std::unique_ptr<PcmAudioSinkInterface> OnAddAudioStream(
+        const std::string& stream_label, const std::string& track_id) { return nullptr; }
+
+    // every CallEngineOptions::stats_interval_ms once connected
+    virtual void OnQualityStats(const CallQualityStats& stats) {}
+};
+
+// CallQualityStats members aggregated over an engine's calls.
+enum class CallQualityMetric {
+    kRtt,
+    kJitter,
+    kLoss,
+    kSendBitrate,
+    kRecvBitrate,
+    kFramerate,
+    kDecodeTime,
+    kJitterBufferDelay,
+    kCount
+};
+
+// the CallQualityStats member name, e.g. "rtt_ms"
+const char *CallQualityMetricName(CallQualityMetric metric);
+
+// Call setup milestones, roughly in the order a call passes them. Stages
+// marked caller or callee are only reached by that side.
+enum class CallSetupStage {
+    // offer (caller) or answer (callee) created by the peer connection
+    kLocalSdpCreated,
+    // caller
+    kInviteSent,
+    // callee
+    kOfferReceived,
+    // caller, first 18x
+    kProvisional,
+    // caller
+    kAnswerReceived,
+    // 200 received (caller) or ACK received (callee)
+    kConnected,
+    kRemoteDescriptionSet,
+    // first local candidate gathered
+    kFirstCandidate,
+    kIceConnected,
+    // first remote video frame decoded
+    kFirstFrame,
+    kCount
+};
+
+const char *CallSetupStageName(CallSetupStage stage);
+
+struct CallSetupTimings {
+    // microseconds from the call being created (MakeCall() or the incoming
+    // INVITE) to each stage, -1 if not reached
+    int64_t stage_us[static_cast<size_t>(CallSetupStage::kCount)];
+
+    int64_t operator[](CallSetupStage stage) const {
+        return stage_us[static_cast<size_t>(stage)];
+    }
 };
 
 class CallInterface {
@@ -29,8 +123,19 @@ protected:
 public:
     virtual const CallUserInterface *user() const = 0;
     virtual const std::string& peer() const = 0;
+    virtual CallSetupTimings setup_timings() const = 0;
+
+    // unique within the engine, see CallEngineInterface::FindCall()
+    virtual uint64_t handle() const = 0;
+    // SIP Call-ID, empty for a caller until its INVITE has been built
+    virtual std::string call_id() const = 0;
+    // Ends the dialog now rather than when the call is released. Its
+    // observer still sees OnTerminated(), or OnError() before connecting.
+    virtual void Hangup() = 0;
 };
 
+// Called on CallUserOptions::executor. The callee's events start after
+// OnCallee() has returned its observer.
 class CallUserObserver {
 protected:
     virtual ~CallUserObserver() = default;
@@ -44,6 +149,11 @@ struct CallUserOptions {
     std::string name;
     std::string password;
     uint16_t login_server_port = 0;
+
+    // Runs the callbacks of this user's CallUserObserver and of its calls'
+    // CallObservers, in the order they are raised. Null takes the engine's,
+    // see CallEngineOptions::executor.
+    std::shared_ptr<util::Executor> executor;
 };
 
 class CallUserInterface {
@@ -71,7 +181,115 @@ struct CallEngineOptions {
         bool login_using_sip_rport = true;
     } session;
 
+    // Where each call's local video comes from. kFile and kSynthetic need
+    // no camera, so headless hosts still carry encoder and network load.
+    struct VideoCapture {
+        enum class Type {
+            // first camera, audio only if there is none
+            kDevice,
+            // Y4M or raw I420 file, memory mapped and looped
+            kFile,
+            // generated moving pattern
+            kSynthetic
+        } type = Type::kDevice;
+
+        // for kFile, a .y4m carries its own size and frame rate
+        std::string file;
+
+        // for kSynthetic and raw I420 files
+        int width = 640;
+        int height = 480;
+        int fps = 30;
+    } video_capture;
+
     std::vector<IceServer> ice_servers;
+
+    // Default CallUserOptions::executor of the engine's users. Null runs
+    // their callbacks inline on the engine threads raising them, the dum
+    // thread or the signaling thread, which then wait for the application.
+    // A util::PollableExecutor brings every event to one fd the
+    // application polls and drains on its own thread.
+    std::shared_ptr<util::Executor> executor;
+
+    // Incoming calls above any of these limits are turned away with a 503
+    // before a Call or PeerConnection is built for them; 0 turns a limit off.
+    struct Admission {
+        // live calls, both directions
+        uint32_t max_calls = 0;
+        uint32_t max_peer_connections = 0;
+        // process cpu over all cores, sampled at most once a second
+        uint32_t max_cpu_percent = 0;
+        // tasks waiting for the sip stack thread, see StackMetrics
+        uint32_t max_stack_queue_depth = 0;
+        // sent back with the 503, 0 leaves Retry-After out
+        uint32_t retry_after_sec = 5;
+    } admission;
+
+    // Period of each call's stats sample once connected, see
+    // CallObserver::OnQualityStats(); 0 turns sampling off.
+    uint32_t stats_interval_ms = 0;
+
+    // Engine threads: the sip stack, one dum thread per user and the
+    // webrtc network, worker and signaling threads.
+    struct Threads {
+        // prepended to the os thread names, empty keeps the defaults
+        std::string name_prefix;
+        // cpu masks, bit n allows cpu n and 0 means no affinity; sip
+        // covers the stack and all dum threads
+        uint64_t sip_affinity = 0;
+        uint64_t network_affinity = 0;
+        uint64_t worker_affinity = 0;
+        uint64_t signaling_affinity = 0;
+    } threads;
+
+    // Prometheus text format at http://127.0.0.1:<port>/metrics, served
+    // from a thread of its own; 0 leaves the endpoint off.
+    struct Metrics {
+        uint16_t port = 0;
+    } metrics;
+};
+
+// See CallEngineInterface::TerminateAllCalls().
+struct TerminateOptions {
+    // hangups in flight at once; the next go out as earlier ones end
+    size_t batch_size = 200;
+    // for the whole teardown, counted from the call
+    uint32_t deadline_ms = 10000;
+};
+
+struct TerminateReport {
+    // live when the teardown started
+    size_t calls = 0;
+    // whose dialog ended before the deadline
+    size_t ended = 0;
+    // not even hung up by the deadline
+    size_t not_sent = 0;
+    uint64_t elapsed_us = 0;
+
+    bool complete() const { return ended == calls; }
+};
+
+struct ShutdownOptions {
+    // for the whole shutdown, counted from the call
+    uint32_t deadline_ms = 15000;
+    // hangups and de-registrations in flight at once
+    size_t call_batch_size = 200;
+    size_t logout_batch_size = 200;
+};
+
+struct ShutdownReport {
+    TerminateReport calls;
+    // users not logged out when the shutdown started, and of those the
+    // ones deregistered by the deadline
+    size_t users = 0;
+    size_t logged_out = 0;
+    // still open at the deadline
+    size_t peer_connections = 0;
+    uint64_t elapsed_us = 0;
+
+    bool complete() const {
+        return calls.complete() && logged_out == users && 0 == peer_connections;
+    }
 };
 
 class CallEngineInterface {
@@ -81,6 +299,38 @@ public:
     virtual const CallEngineOptions& options() const = 0;
     virtual std::shared_ptr<CallUserInterface> CreateUser(const CallUserOptions& options,
                                                           CallUserObserver *observer) = 0;
+
+    // a call of any of the engine's users, nullptr once it is gone
+    virtual std::shared_ptr<CallInterface> FindCall(uint64_t handle) const = 0;
+    virtual std::shared_ptr<CallInterface> FindCallById(const std::string& call_id) const = 0;
+
+    // Hangs up every live call, at most options.batch_size at a time, and
+    // blocks until their dialogs have ended or the deadline has passed.
+    // Calls stay with their owners, only their dialogs end.
+    virtual TerminateReport TerminateAllCalls(const TerminateOptions& options) = 0;
+
+    // Readies the engine for exit within one deadline: hangs up every call
+    // as TerminateAllCalls() does, logs out every user in batches, then
+    // closes every peer connection at once. Users and calls stay with
+    // their owners, who can then release them without waiting on the
+    // network; the report says what did not finish in time.
+    virtual ShutdownReport Shutdown(const ShutdownOptions& options) = 0;
+
+    // time to reach the stage over all calls of this engine, in microseconds
+    virtual util::Histogram::Snapshot GetCallSetupHistogram(CallSetupStage stage) const = 0;
+
+    // every stats sample of every call, in thousandths of the metric's unit
+    // (so microseconds for rtt); rates and averages only once a call has an
+    // interval, rtt and jitter only when reported
+    virtual util::Histogram::Snapshot GetCallQualityHistogram(CallQualityMetric metric) const = 0;
+
+    // busy time, queue depth and longest task of every engine thread, see
+    // CallEngineOptions::Threads for which threads there are
+    virtual std::vector<util::ThreadSnapshot> GetThreadStats() const = 0;
+
+    // the metrics endpoint's body, built from atomics only so it never
+    // waits on the engine threads; available with the endpoint off too
+    virtual std::string GetMetricsText() const = 0;
 };
 
 std::shared_ptr<CallEngineInterface> CreateCallEngine(const CallEngineOptions& options);
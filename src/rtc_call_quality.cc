@@ -0,0 +1,127 @@
+#include "rtc_call_quality.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace rtc;
+
+namespace {
+
+const webrtc::RTCStatsMemberInterface *FindMember(const webrtc::RTCStats& stats, const char *name) {
+    for (auto member : stats.Members()) {
+        if (member->is_defined() && 0 == std::strcmp(member->name(), name)) {
+            return member;
+        }
+    }
+    return nullptr;
+}
+
+double NumberMember(const webrtc::RTCStats& stats, const char *name) {
+    auto member = FindMember(stats, name);
+    if (!member) {
+        return 0;
+    }
+
+    switch (member->type()) {
+    case webrtc::RTCStatsMemberInterface::kInt32:
+        return *member->cast_to<webrtc::RTCStatsMember<int32_t>>();
+    case webrtc::RTCStatsMemberInterface::kUint32:
+        return *member->cast_to<webrtc::RTCStatsMember<uint32_t>>();
+    case webrtc::RTCStatsMemberInterface::kInt64:
+        return static_cast<double>(*member->cast_to<webrtc::RTCStatsMember<int64_t>>());
+    case webrtc::RTCStatsMemberInterface::kUint64:
+        return static_cast<double>(*member->cast_to<webrtc::RTCStatsMember<uint64_t>>());
+    case webrtc::RTCStatsMemberInterface::kDouble:
+        return *member->cast_to<webrtc::RTCStatsMember<double>>();
+    default:
+        return 0;
+    }
+}
+
+bool BoolMember(const webrtc::RTCStats& stats, const char *name) {
+    auto member = FindMember(stats, name);
+    return member && webrtc::RTCStatsMemberInterface::kBool == member->type()
+        && *member->cast_to<webrtc::RTCStatsMember<bool>>();
+}
+
+bool StringMemberIs(const webrtc::RTCStats& stats, const char *name, const char *value) {
+    auto member = FindMember(stats, name);
+    return member && webrtc::RTCStatsMemberInterface::kString == member->type()
+        && *member->cast_to<webrtc::RTCStatsMember<std::string>>() == value;
+}
+
+bool TypeIs(const webrtc::RTCStats& stats, const char *type) {
+    return 0 == std::strcmp(stats.type(), type);
+}
+}
+
+CallQualityStats CallQualitySampler::Reduce(const webrtc::RTCStatsReport& report) {
+    CallQualityStats stats;
+    Totals totals;
+    totals.timestamp_us = report.timestamp_us();
+
+    for (auto& s : report) {
+        if (TypeIs(s, "candidate-pair")) {
+            if (BoolMember(s, "nominated") && StringMemberIs(s, "state", "succeeded")) {
+                stats.rtt_ms = std::max(stats.rtt_ms, NumberMember(s, "currentRoundTripTime") * 1000);
+            }
+        } else if (TypeIs(s, "inbound-rtp")) {
+            if (BoolMember(s, "isRemote")) {
+                continue;
+            }
+            totals.bytes_received += NumberMember(s, "bytesReceived");
+            totals.packets_received += NumberMember(s, "packetsReceived");
+            totals.packets_lost += NumberMember(s, "packetsLost");
+            totals.frames_decoded += NumberMember(s, "framesDecoded");
+            totals.decode_time_s += NumberMember(s, "totalDecodeTime");
+            stats.jitter_ms = std::max(stats.jitter_ms, NumberMember(s, "jitter") * 1000);
+        } else if (TypeIs(s, "outbound-rtp")) {
+            if (BoolMember(s, "isRemote")) {
+                continue;
+            }
+            totals.bytes_sent += NumberMember(s, "bytesSent");
+        } else if (TypeIs(s, "track")) {
+            if (!BoolMember(s, "remoteSource")) {
+                continue;
+            }
+            totals.jitter_buffer_delay_s += NumberMember(s, "jitterBufferDelay");
+            totals.jitter_buffer_emitted += NumberMember(s, "jitterBufferEmittedCount");
+        }
+    }
+
+    if (has_last_ && totals.timestamp_us > last_.timestamp_us) {
+        auto interval_us = totals.timestamp_us - last_.timestamp_us;
+        stats.interval_ms = static_cast<uint32_t>(interval_us / 1000);
+
+        // a stream that leaves the report takes its totals with it, so a
+        // sum can shrink; that interval then counts as nothing
+        auto delta = [](double now, double before) { return std::max(now - before, 0.0); };
+
+        // bits per millisecond are kbps
+        auto interval_ms = interval_us / 1000.0;
+        stats.send_kbps = delta(totals.bytes_sent, last_.bytes_sent) * 8 / interval_ms;
+        stats.recv_kbps = delta(totals.bytes_received, last_.bytes_received) * 8 / interval_ms;
+
+        auto lost = delta(totals.packets_lost, last_.packets_lost);
+        auto expected = lost + delta(totals.packets_received, last_.packets_received);
+        if (expected > 0 && lost > 0) {
+            stats.loss_percent = 100 * lost / expected;
+        }
+
+        auto frames = delta(totals.frames_decoded, last_.frames_decoded);
+        if (frames > 0) {
+            stats.framerate = frames * 1000 / interval_ms;
+            stats.decode_ms = delta(totals.decode_time_s, last_.decode_time_s) * 1000 / frames;
+        }
+
+        auto emitted = delta(totals.jitter_buffer_emitted, last_.jitter_buffer_emitted);
+        if (emitted > 0) {
+            stats.jitter_buffer_ms =
+                delta(totals.jitter_buffer_delay_s, last_.jitter_buffer_delay_s) * 1000 / emitted;
+        }
+    }
+
+    last_ = totals;
+    has_last_ = true;
+    return stats;
+}
@@ -0,0 +1,37 @@
+#ifndef _RTC_CALL_QUALITY_H_INCLUDED
+#define _RTC_CALL_QUALITY_H_INCLUDED
+
+#include <cstdint>
+
+#include "api/stats/rtcstatsreport.h"
+
+#include "rtc_call_interface.h"
+
+namespace rtc {
+
+// Reduces the RTCStatsReports of one call into CallQualityStats, keeping
+// the previous sample's totals for rates. Members are looked up by their
+// spec name, so ones this webrtc does not report leave their value at 0.
+class CallQualitySampler {
+public:
+    CallQualityStats Reduce(const webrtc::RTCStatsReport& report);
+private:
+    // cumulative over the call, summed over streams
+    struct Totals {
+        int64_t timestamp_us = 0;
+        double bytes_sent = 0;
+        double bytes_received = 0;
+        double packets_received = 0;
+        double packets_lost = 0;
+        double frames_decoded = 0;
+        double decode_time_s = 0;
+        double jitter_buffer_delay_s = 0;
+        double jitter_buffer_emitted = 0;
+    };
+
+    Totals last_;
+    bool has_last_ = false;
+};
+}
+
+#endif // !_RTC_CALL_QUALITY_H_INCLUDED
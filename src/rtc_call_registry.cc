@@ -0,0 +1,134 @@
+#include "rtc_call_registry.h"
+
+using namespace rtc;
+
+uint64_t CallRegistry::Add(const std::shared_ptr<Call>& call) {
+    std::lock_guard<std::mutex> guard(mu_);
+    auto handle = next_handle_++;
+    calls_[handle].call = call;
+    return handle;
+}
+
+void CallRegistry::Remove(uint64_t handle) {
+    std::lock_guard<std::mutex> guard(mu_);
+    auto it = calls_.find(handle);
+    if (it == calls_.end()) {
+        return;
+    }
+
+    StopEnding(it->second);
+    if (!it->second.call_id.empty()) {
+        by_call_id_.erase(it->second.call_id);
+    }
+    calls_.erase(it);
+}
+
+void CallRegistry::SetCallId(uint64_t handle, const std::string& call_id) {
+    std::lock_guard<std::mutex> guard(mu_);
+    auto it = calls_.find(handle);
+    if (it == calls_.end() || call_id.empty()) {
+        return;
+    }
+
+    if (!it->second.call_id.empty()) {
+        by_call_id_.erase(it->second.call_id);
+    }
+    it->second.call_id = call_id;
+    by_call_id_[call_id] = handle;
+}
+
+std::shared_ptr<Call> CallRegistry::Find(uint64_t handle) const {
+    std::lock_guard<std::mutex> guard(mu_);
+    auto it = calls_.find(handle);
+    return it != calls_.end() ? it->second.call.lock() : nullptr;
+}
+
+std::shared_ptr<Call> CallRegistry::FindByCallId(const std::string& call_id) const {
+    std::lock_guard<std::mutex> guard(mu_);
+    auto it = by_call_id_.find(call_id);
+    if (it == by_call_id_.end()) {
+        return nullptr;
+    }
+
+    auto call = calls_.find(it->second);
+    return call != calls_.end() ? call->second.call.lock() : nullptr;
+}
+
+size_t CallRegistry::size() const {
+    std::lock_guard<std::mutex> guard(mu_);
+    return calls_.size();
+}
+
+std::vector<std::shared_ptr<Call>> CallRegistry::Live() const {
+    std::vector<std::shared_ptr<Call>> live;
+    std::lock_guard<std::mutex> guard(mu_);
+    live.reserve(calls_.size());
+    for (auto& entry : calls_) {
+        if (entry.second.ended) {
+            continue;
+        }
+
+        if (auto call = entry.second.call.lock()) {
+            live.push_back(std::move(call));
+        }
+    }
+    return live;
+}
+
+std::vector<std::shared_ptr<Call>> CallRegistry::All() const {
+    std::vector<std::shared_ptr<Call>> all;
+    std::lock_guard<std::mutex> guard(mu_);
+    all.reserve(calls_.size());
+    for (auto& entry : calls_) {
+        if (auto call = entry.second.call.lock()) {
+            all.push_back(std::move(call));
+        }
+    }
+    return all;
+}
+
+bool CallRegistry::SetEnding(uint64_t handle) {
+    std::lock_guard<std::mutex> guard(mu_);
+    auto it = calls_.find(handle);
+    if (it == calls_.end() || it->second.ended) {
+        return false;
+    }
+
+    if (!it->second.ending) {
+        it->second.ending = true;
+        ++ending_;
+    }
+    return true;
+}
+
+void CallRegistry::SetEnded(uint64_t handle) {
+    std::lock_guard<std::mutex> guard(mu_);
+    auto it = calls_.find(handle);
+    if (it == calls_.end()) {
+        return;
+    }
+
+    StopEnding(it->second);
+    it->second.ended = true;
+}
+
+bool CallRegistry::Ended(uint64_t handle) const {
+    std::lock_guard<std::mutex> guard(mu_);
+    auto it = calls_.find(handle);
+    return it == calls_.end() || it->second.ended;
+}
+
+bool CallRegistry::WaitEnding(size_t limit, Clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(mu_);
+    return ending_cond_.wait_until(lock, deadline, [&] { return ending_ < limit; });
+}
+
+void CallRegistry::StopEnding(Entry& entry) {
+    if (!entry.ending) {
+        return;
+    }
+
+    entry.ending = false;
+    --ending_;
+    ending_cond_.notify_all();
+}
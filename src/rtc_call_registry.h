@@ -0,0 +1,67 @@
+#ifndef _RTC_CALL_REGISTRY_H_INCLUDED
+#define _RTC_CALL_REGISTRY_H_INCLUDED
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace rtc {
+
+class Call;
+
+// Every Call of an engine, both directions, by handle and by SIP Call-ID.
+// A Call adds itself when it is created and removes itself when it is
+// destroyed; the registry only holds it weakly. Lookups, inserts and
+// erases are O(1) on average, from any thread.
+class CallRegistry {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // the call's handle, never 0
+    uint64_t Add(const std::shared_ptr<Call>& call);
+    void Remove(uint64_t handle);
+    // a caller learns its Call-ID once the INVITE is built
+    void SetCallId(uint64_t handle, const std::string& call_id);
+
+    std::shared_ptr<Call> Find(uint64_t handle) const;
+    std::shared_ptr<Call> FindByCallId(const std::string& call_id) const;
+    size_t size() const;
+
+    // calls whose dialog has not ended
+    std::vector<std::shared_ptr<Call>> Live() const;
+    std::vector<std::shared_ptr<Call>> All() const;
+
+    // Teardown accounting: a call is ending from Hangup() until its dialog
+    // has ended or it is destroyed. False if the call had ended already.
+    bool SetEnding(uint64_t handle);
+    void SetEnded(uint64_t handle);
+    // true once the dialog has ended or the call is gone
+    bool Ended(uint64_t handle) const;
+    // until fewer than limit calls are ending, false at the deadline
+    bool WaitEnding(size_t limit, Clock::time_point deadline);
+private:
+    struct Entry {
+        std::weak_ptr<Call> call;
+        std::string call_id;
+        bool ending = false;
+        bool ended = false;
+    };
+
+    // under mu_
+    void StopEnding(Entry& entry);
+
+    mutable std::mutex mu_;
+    std::condition_variable ending_cond_;
+    uint64_t next_handle_ = 1;
+    std::unordered_map<uint64_t, Entry> calls_;
+    std::unordered_map<std::string, uint64_t> by_call_id_;
+    size_t ending_ = 0;
+};
+}
+
+#endif // !_RTC_CALL_REGISTRY_H_INCLUDED
@@ -0,0 +1,48 @@
+#ifndef _RTC_CALL_SETUP_H_INCLUDED
+#define _RTC_CALL_SETUP_H_INCLUDED
+
+#include <atomic>
+
+#include "utility/histogram.h"
+#include "rtc_call_interface.h"
+
+namespace rtc {
+
+// Stage timestamps of one call. Stages are reached from the dum, signaling
+// and decode threads, so each slot is set once with a compare and swap.
+class CallSetupTimeline {
+public:
+    static constexpr size_t kStages = static_cast<size_t>(CallSetupStage::kCount);
+
+    CallSetupTimeline() : start_us_(util::MonotonicMicros()) {
+        for (auto& stage_us : stage_us_) {
+            stage_us.store(-1, std::memory_order_relaxed);
+        }
+    }
+
+    // Returns the time since the start the first time a stage is reached,
+    // -1 on later calls.
+    int64_t Mark(CallSetupStage stage) {
+        auto elapsed_us = static_cast<int64_t>(util::MonotonicMicros() - start_us_);
+        int64_t expected = -1;
+        if (!stage_us_[static_cast<size_t>(stage)].compare_exchange_strong(
+            expected, elapsed_us, std::memory_order_relaxed)) {
+            return -1;
+        }
+        return elapsed_us;
+    }
+
+    CallSetupTimings timings() const {
+        CallSetupTimings timings;
+        for (size_t i = 0; i < kStages; ++i) {
+            timings.stage_us[i] = stage_us_[i].load(std::memory_order_relaxed);
+        }
+        return timings;
+    }
+private:
+    uint64_t start_us_;
+    std::atomic<int64_t> stage_us_[kStages];
+};
+}
+
+#endif // !_RTC_CALL_SETUP_H_INCLUDED
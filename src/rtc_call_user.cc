@@ -16,7 +16,18 @@ CallUser::Create(const CallUserOptions& options,
     return user;
 }
 
+CallUser::~CallUser() {
+    if (admission_held_.exchange(false)) {
+        call_engine_->ReleaseAdmission();
+    }
+}
+
 bool CallUser::Initialize() {
+    executor_ = options_.executor ? options_.executor : call_engine_->options().executor;
+    if (!executor_) {
+        executor_ = std::make_shared<util::InlineExecutor>();
+    }
+
     rtc_session::UserOptions options;
     options.name = options_.name;
     options.realm = options_.domain;
@@ -56,17 +67,49 @@ CallUser::MakeCall(const std::string& peer, CallObserver *observer) {
 }
 
 void CallUser::OnLoginResult(bool success) {
-    observer_->OnLogin(success);
+    std::weak_ptr<CallUser> weak_user = shared_from_this();
+    executor_->Post([weak_user, success] {
+        if (auto user = weak_user.lock()) {
+            user->observer_->OnLogin(success);
+        }
+    });
 }
 
+// The callee's own events go through the same executor after this, so they
+// find its observer set.
 void CallUser::OnCallee(std::unique_ptr<rtc_session::CalleeInterface> callee) {
     auto call_callee = Call::CreateCallee(*this, pc_factory_, std::move(callee));
-    callees_.push_back(call_callee);
-    call_callee->SetObserver(observer_->OnCallee(call_callee));
-}
+    // counted as a callee now, or not at all
+    if (admission_held_.exchange(false)) {
+        call_engine_->ReleaseAdmission();
+    }
+    if (!call_callee) {
+        return;
+    }
+    callees_.emplace(call_callee->handle(), call_callee);
 
-void CallUser::OnCalleeQuit(Call *callee) {
-    callees_.remove_if([&] (auto &i) {
-        return i.get() == callee;
+    std::weak_ptr<CallUser> weak_user = shared_from_this();
+    std::weak_ptr<Call> weak_call = call_callee;
+    executor_->Post([weak_user, weak_call] {
+        auto user = weak_user.lock();
+        auto call = weak_call.lock();
+        if (user && call) {
+            call->SetObserver(user->observer_->OnCallee(call));
+        }
     });
 }
+
+// A slot still held here belongs to an INVITE dum went on to refuse, as
+// this one comes on the same dum thread after it.
+rtc_session::Admission CallUser::OnAdmitCallee(const rtc_session::UserId& peer) {
+    if (admission_held_.exchange(false)) {
+        call_engine_->ReleaseAdmission();
+    }
+    auto admission = call_engine_->AdmitCallee();
+    admission_held_ = admission.accept;
+    return admission;
+}
+
+void CallUser::OnCalleeQuit(uint64_t handle) {
+    callees_.erase(handle);
+}
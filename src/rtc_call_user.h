@@ -1,7 +1,8 @@
 #ifndef _RTC_CALL_USER_H_INCLUDED
 #define _RTC_CALL_USER_H_INCLUDED
 
-#include <list>
+#include <atomic>
+#include <unordered_map>
 
 #include "api/peerconnectioninterface.h"
 
@@ -19,6 +20,7 @@ public:
     static std::shared_ptr<CallUser> Create(const CallUserOptions& config,
                                             CallUserObserver *observer,
                                             const std::shared_ptr<CallEngine> call_engine);
+    ~CallUser() override;
 
     const CallUserOptions& options() const override { return options_; }
     const CallEngineInterface *engine() const override;
@@ -36,14 +38,22 @@ private:
     friend class Call;
     void OnLoginResult(bool success) override;
     void OnCallee(std::unique_ptr<rtc_session::CalleeInterface> callee) override;
-    void OnCalleeQuit(Call *callee);
+    rtc_session::Admission OnAdmitCallee(const rtc_session::UserId& peer) override;
+    void OnCalleeQuit(uint64_t handle);
+    util::Executor *executor() const { return executor_.get(); }
 
     CallUserOptions options_;
     CallUserObserver *observer_ = nullptr;
     std::shared_ptr<CallEngine> call_engine_;
+    // options_.executor, the engine's or an inline one
+    std::shared_ptr<util::Executor> executor_;
     std::shared_ptr<rtc_session::UserInterface> session_user_;
     rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> pc_factory_;
-    std::list<std::shared_ptr<Call>> callees_;
+    // dum thread only, by Call::handle()
+    std::unordered_map<uint64_t, std::shared_ptr<Call>> callees_;
+    // the engine slot of the last admitted INVITE, until its Call exists;
+    // dum may still refuse the INVITE itself, and then OnCallee() never comes
+    std::atomic<bool> admission_held_{ false };
 };
 }
 
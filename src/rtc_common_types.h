@@ -1,6 +1,10 @@
 #ifndef _RTC_COMMON_TYPES_H_INCLUDED
 #define _RTC_COMMON_TYPES_H_INCLUDED
 
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
 namespace rtc {
 
 class I420VideoFrame {
@@ -20,12 +24,60 @@ public:
     virtual int StrideY() const = 0;
     virtual int StrideU() const = 0;
     virtual int StrideV() const = 0;
+
+    // Capture time on the util::MonotonicMicros() clock, 0 if unknown.
+    // Subtracting it from util::MonotonicMicros() once the frame is on
+    // screen gives the glass-to-glass latency.
+    virtual int64_t capture_time_us() const { return 0; }
+
+    // The raw timestamps capture_time_us() is derived from. RTP timestamp
+    // of a received frame, 90kHz, 0 for local frames.
+    virtual uint32_t rtp_timestamp() const { return 0; }
+    // sender's capture time in NTP milliseconds, 0 until the receiver has
+    // an RTCP sender report to map the RTP timestamp with
+    virtual int64_t ntp_time_ms() const { return 0; }
+    // on the rtc::TimeMicros() clock: capture time of local frames, the
+    // render time the jitter buffer aimed for on received ones
+    virtual int64_t timestamp_us() const { return 0; }
+};
+
+// What a sink can make use of. Frames larger or faster than this are wasted
+// work for the decoder, the converter and the texture upload.
+struct I420VideoSinkWants {
+    int max_pixel_count = std::numeric_limits<int>::max();
+    int max_framerate_fps = std::numeric_limits<int>::max();
+
+    bool operator==(const I420VideoSinkWants& other) const {
+        return max_pixel_count == other.max_pixel_count
+            && max_framerate_fps == other.max_framerate_fps;
+    }
+
+    bool operator!=(const I420VideoSinkWants& other) const {
+        return !(*this == other);
+    }
 };
 
 class I420VideoSinkInterface {
 public:
     virtual ~I420VideoSinkInterface() = default;
     virtual void OnFrame(const I420VideoFrame& video_frame) = 0;
+
+    // Polled once per frame, a change is propagated to the source.
+    virtual I420VideoSinkWants wants() const { return {}; }
+
+    // Frames taken by OnFrame() but not shown, e.g. while the window is
+    // hidden. Polled on the frame delivery thread after each frame.
+    virtual uint64_t frames_dropped() const { return 0; }
+};
+
+// Interleaved 16 bit pcm, called on the audio thread every 10ms.
+class PcmAudioSinkInterface {
+public:
+    virtual ~PcmAudioSinkInterface() = default;
+    virtual void OnData(const int16_t *samples,
+                        int sample_rate,
+                        size_t channels,
+                        size_t frames) = 0;
 };
 }
 
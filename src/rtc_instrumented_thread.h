@@ -0,0 +1,55 @@
+#ifndef _RTC_INSTRUMENTED_THREAD_H_INCLUDED
+#define _RTC_INSTRUMENTED_THREAD_H_INCLUDED
+
+#include <memory>
+#include <string>
+
+#include "rtc_base/thread.h"
+
+#include "utility/thread_stats.h"
+#include "utility/tracer.h"
+
+namespace rtc {
+
+// rtc::Thread keeping ThreadStats. Posted messages go through Dispatch()
+// and are timed as tasks; synchronous Invoke()s are run outside of it, so
+// they only show up in the thread's cpu time.
+class InstrumentedThread : public rtc::Thread {
+public:
+    InstrumentedThread(std::unique_ptr<rtc::SocketServer> ss,
+                       const std::string& name,
+                       uint64_t affinity)
+        : rtc::Thread(std::move(ss))
+        , stats_(name)
+        , affinity_(affinity) {}
+
+    ~InstrumentedThread() override {
+        Stop();
+    }
+
+    util::ThreadSnapshot GetThreadStats() const { return stats_.GetSnapshot(size()); }
+    // as of the last dispatched message, without locking the queue
+    size_t published_queue_depth() const { return stats_.published_queue_depth(); }
+    const std::string& stats_name() const { return stats_.name(); }
+private:
+    void Run() override {
+        util::SetCurrentThreadAffinity(affinity_);
+        util::Tracer::Instance().SetCurrentThreadName(stats_.name());
+
+        stats_.Attach();
+        rtc::Thread::Run();
+        stats_.Detach();
+    }
+
+    void Dispatch(rtc::Message *pmsg) override {
+        stats_.PublishQueueDepth(size());
+        util::ScopedTaskTimer timer(&stats_);
+        rtc::Thread::Dispatch(pmsg);
+    }
+
+    util::ThreadStats stats_;
+    uint64_t affinity_;
+};
+}
+
+#endif // !_RTC_INSTRUMENTED_THREAD_H_INCLUDED
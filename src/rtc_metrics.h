@@ -0,0 +1,134 @@
+#ifndef _RTC_METRICS_H_INCLUDED
+#define _RTC_METRICS_H_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+
+#include "api/peerconnectioninterface.h"
+
+namespace rtc {
+
+// Frame counters of every live VideoSinkAdapter, in a fixed table so a
+// scrape walks it without locking. A sink that finds the table full goes
+// uncounted there, but still adds to the totals of its source, which
+// outlive the sinks and are what the metrics endpoint exports, so its
+// series do not grow with the number of calls.
+class SinkMetricsTable {
+public:
+    static constexpr size_t kMaxSinks = 256;
+
+    struct Totals {
+        std::atomic<uint64_t> frames{ 0 };
+        std::atomic<uint64_t> dropped{ 0 };
+    };
+
+    Totals& totals(bool remote) { return totals_[remote ? 1 : 0]; }
+    const Totals& totals(bool remote) const { return totals_[remote ? 1 : 0]; }
+
+    // a slot is claimed by Acquire(), which then writes the labels and
+    // resets the counters and only then publishes it as ready
+    enum State : int { kFree, kClaimed, kReady };
+
+    struct Slot {
+        std::atomic<int> state{ kFree };
+        // labels
+        std::atomic<uint64_t> call_id{ 0 };
+        std::atomic<bool> remote{ false };
+        // delivered to the sink, and dropped by it without being shown
+        std::atomic<uint64_t> frames{ 0 };
+        std::atomic<uint64_t> dropped{ 0 };
+    };
+
+    Slot *Acquire(uint64_t call_id, bool remote) {
+        for (auto& slot : slots_) {
+            int state = kFree;
+            if (kFree != slot.state.load(std::memory_order_relaxed)
+                || !slot.state.compare_exchange_strong(state, kClaimed, std::memory_order_acquire)) {
+                continue;
+            }
+
+            slot.call_id.store(call_id, std::memory_order_relaxed);
+            slot.remote.store(remote, std::memory_order_relaxed);
+            slot.frames.store(0, std::memory_order_relaxed);
+            slot.dropped.store(0, std::memory_order_relaxed);
+            slot.state.store(kReady, std::memory_order_release);
+            return &slot;
+        }
+        return nullptr;
+    }
+
+    void Release(Slot *slot) {
+        if (slot) {
+            slot->state.store(kFree, std::memory_order_release);
+        }
+    }
+
+    // fn(index, const Slot&) for each ready slot; a slot released and
+    // reused during the walk may mix both sinks' values
+    template<typename Fn>
+    void ForEach(Fn&& fn) const {
+        for (size_t i = 0; i < kMaxSinks; ++i) {
+            if (kReady == slots_[i].state.load(std::memory_order_acquire)) {
+                fn(i, slots_[i]);
+            }
+        }
+    }
+private:
+    Slot slots_[kMaxSinks];
+    // local, remote
+    Totals totals_[2];
+};
+
+// Why an incoming call was turned away, see CallEngineOptions::Admission.
+enum class AdmissionReason {
+    kCalls,
+    kPeerConnections,
+    kCpu,
+    kStackQueue,
+    kCount
+};
+
+inline const char *AdmissionReasonName(AdmissionReason reason) {
+    switch (reason) {
+    case AdmissionReason::kCalls: return "calls";
+    case AdmissionReason::kPeerConnections: return "peer_connections";
+    case AdmissionReason::kCpu: return "cpu";
+    case AdmissionReason::kStackQueue: return "stack_queue";
+    default: return "unknown";
+    }
+}
+
+// Engine wide call gauges, updated by the calls as they change.
+struct CallMetrics {
+    static constexpr size_t kIceStates = webrtc::PeerConnectionInterface::kIceConnectionMax;
+    static constexpr size_t kAdmissionReasons = static_cast<size_t>(AdmissionReason::kCount);
+
+    std::atomic<int64_t> callers{ 0 };
+    std::atomic<int64_t> callees{ 0 };
+    // incoming calls admitted whose Call is not created yet, counted
+    // against max_calls with the two above
+    std::atomic<int64_t> admitting{ 0 };
+    std::atomic<int64_t> peer_connections{ 0 };
+    // incoming calls admitted, and rejected per reason
+    std::atomic<uint64_t> admitted{ 0 };
+    std::atomic<uint64_t> rejected[kAdmissionReasons] = {};
+    // calls per ice connection state, from the first state change on
+    std::atomic<int64_t> ice_states[kIceStates] = {};
+    SinkMetricsTable sinks;
+};
+
+inline const char *IceConnectionStateName(webrtc::PeerConnectionInterface::IceConnectionState state) {
+    switch (state) {
+    case webrtc::PeerConnectionInterface::kIceConnectionNew: return "new";
+    case webrtc::PeerConnectionInterface::kIceConnectionChecking: return "checking";
+    case webrtc::PeerConnectionInterface::kIceConnectionConnected: return "connected";
+    case webrtc::PeerConnectionInterface::kIceConnectionCompleted: return "completed";
+    case webrtc::PeerConnectionInterface::kIceConnectionFailed: return "failed";
+    case webrtc::PeerConnectionInterface::kIceConnectionDisconnected: return "disconnected";
+    case webrtc::PeerConnectionInterface::kIceConnectionClosed: return "closed";
+    default: return "unknown";
+    }
+}
+}
+
+#endif // !_RTC_METRICS_H_INCLUDED
@@ -0,0 +1,188 @@
+#include "rtc_metrics_server.h"
+
+#include <cstring>
+
+#ifdef WEBRTC_WIN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+using namespace rtc;
+
+namespace {
+
+// how long Run() waits for a connection before checking stop_
+constexpr int kPollIntervalMs = 200;
+// a scraper sends a few hundred bytes of headers, anything slower is dropped
+constexpr int kRequestTimeoutMs = 2000;
+constexpr size_t kMaxRequestSize = 8192;
+
+#ifdef WEBRTC_WIN
+using Socket = SOCKET;
+
+constexpr int kSendFlags = 0;
+
+void CloseSocket(Socket s) {
+    ::closesocket(s);
+}
+
+void SetRecvTimeout(Socket s, int ms) {
+    DWORD timeout = ms;
+    ::setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char *>(&timeout), sizeof(timeout));
+}
+
+void SetNoSigPipe(Socket s) {}
+#else
+using Socket = int;
+
+// a scraper that hangs up mid-response must not raise SIGPIPE, which
+// would take the whole process down; where there is no MSG_NOSIGNAL the
+// accepted socket gets SO_NOSIGPIPE instead
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+void CloseSocket(Socket s) {
+    ::close(s);
+}
+
+void SetRecvTimeout(Socket s, int ms) {
+    struct timeval timeout = { ms / 1000, (ms % 1000) * 1000 };
+    ::setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+}
+
+void SetNoSigPipe(Socket s) {
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    ::setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+}
+#endif
+
+bool SendAll(Socket s, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        auto n = ::send(s, data.data() + sent, static_cast<int>(data.size() - sent), kSendFlags);
+        if (n <= 0) {
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+std::string MakeResponse(const char *status, const char *content_type, const std::string& body) {
+    return std::string("HTTP/1.0 ") + status + "\r\n"
+        + "Content-Type: " + content_type + "\r\n"
+        + "Content-Length: " + std::to_string(body.size()) + "\r\n"
+        + "Connection: close\r\n\r\n"
+        + body;
+}
+}
+
+//static
+std::unique_ptr<MetricsServer> MetricsServer::Create(uint16_t port, Collector collector) {
+    std::unique_ptr<MetricsServer> server(new MetricsServer(std::move(collector)));
+    if (!server->Initialize(port)) {
+        return nullptr;
+    }
+    return server;
+}
+
+MetricsServer::~MetricsServer() {
+    stop_ = true;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    if (-1 != listener_) {
+        CloseSocket(static_cast<Socket>(listener_));
+    }
+}
+
+bool MetricsServer::Initialize(uint16_t port) {
+    auto s = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (static_cast<intptr_t>(s) < 0) {
+        return false;
+    }
+    listener_ = static_cast<intptr_t>(s);
+
+    int reuse = 1;
+    ::setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&reuse), sizeof(reuse));
+
+    // loopback only, the metrics carry user names and call ids
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (0 != ::bind(s, reinterpret_cast<sockaddr *>(&addr), sizeof(addr))
+        || 0 != ::listen(s, 8)) {
+        return false;
+    }
+
+    socklen_t addr_len = sizeof(addr);
+    if (0 != ::getsockname(s, reinterpret_cast<sockaddr *>(&addr), &addr_len)) {
+        return false;
+    }
+    port_ = ntohs(addr.sin_port);
+
+    thread_ = std::thread([this] { Run(); });
+    return true;
+}
+
+void MetricsServer::Run() {
+    auto listener = static_cast<Socket>(listener_);
+    while (!stop_) {
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(listener, &readable);
+
+        struct timeval timeout = { 0, kPollIntervalMs * 1000 };
+        if (::select(static_cast<int>(listener + 1), &readable, nullptr, nullptr, &timeout) <= 0) {
+            continue;
+        }
+
+        auto client = ::accept(listener, nullptr, nullptr);
+        if (static_cast<intptr_t>(client) < 0) {
+            continue;
+        }
+
+        Serve(static_cast<intptr_t>(client));
+        CloseSocket(client);
+    }
+}
+
+void MetricsServer::Serve(intptr_t client_handle) {
+    auto client = static_cast<Socket>(client_handle);
+    SetRecvTimeout(client, kRequestTimeoutMs);
+    SetNoSigPipe(client);
+
+    // only the request line matters, the headers are read and ignored
+    std::string request;
+    char buffer[1024];
+    while (std::string::npos == request.find("\r\n\r\n") && request.size() < kMaxRequestSize) {
+        auto n = ::recv(client, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            return;
+        }
+        request.append(buffer, n);
+    }
+
+    if (0 == request.compare(0, 13, "GET /metrics ") || 0 == request.compare(0, 13, "GET /metrics?")) {
+        SendAll(client, MakeResponse("200 OK", "text/plain; version=0.0.4", collector_()));
+    } else if (0 == request.compare(0, 4, "GET ")) {
+        SendAll(client, MakeResponse("404 Not Found", "text/plain", "not found\n"));
+    } else {
+        SendAll(client, MakeResponse("405 Method Not Allowed", "text/plain", "method not allowed\n"));
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef _RTC_METRICS_SERVER_H_INCLUDED
+#define _RTC_METRICS_SERVER_H_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace rtc {
+
+// Serves GET /metrics over HTTP/1.0 on 127.0.0.1, from a thread of its
+// own, one connection at a time. The body is collected on that thread for
+// every scrape, so the collector must not block on the engine's threads.
+class MetricsServer {
+public:
+    using Collector = std::function<std::string()>;
+
+    // port 0 picks a free one, see port()
+    static std::unique_ptr<MetricsServer> Create(uint16_t port, Collector collector);
+    ~MetricsServer();
+
+    uint16_t port() const { return port_; }
+private:
+    explicit MetricsServer(Collector collector) : collector_(std::move(collector)) {}
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    bool Initialize(uint16_t port);
+    void Run();
+    void Serve(intptr_t client);
+
+    Collector collector_;
+    intptr_t listener_ = -1;
+    uint16_t port_ = 0;
+    std::atomic<bool> stop_{ false };
+    std::thread thread_;
+};
+}
+
+#endif // !_RTC_METRICS_SERVER_H_INCLUDED
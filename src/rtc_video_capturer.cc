@@ -1,5 +1,456 @@
 #include "rtc_video_capturer.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#ifdef WEBRTC_WIN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "api/video/i420_buffer.h"
+#include "common_video/include/i420_buffer_pool.h"
+#include "common_video/include/video_frame_buffer.h"
+#include "rtc_base/timeutils.h"
+
+namespace {
+
+// Read only mapping of a whole file.
+class MappedFile {
+public:
+    static std::shared_ptr<MappedFile> Open(const std::string& path) {
+        std::shared_ptr<MappedFile> file(new MappedFile);
+        if (!file->Map(path)) {
+            return nullptr;
+        }
+        return file;
+    }
+
+    ~MappedFile() {
+#ifdef WEBRTC_WIN
+        if (data_) {
+            ::UnmapViewOfFile(data_);
+        }
+
+        if (mapping_) {
+            ::CloseHandle(mapping_);
+        }
+
+        if (INVALID_HANDLE_VALUE != file_) {
+            ::CloseHandle(file_);
+        }
+#else
+        if (data_) {
+            ::munmap(const_cast<uint8_t *>(data_), size_);
+        }
+#endif
+    }
+
+    const uint8_t *data() const { return data_; }
+    size_t size() const { return size_; }
+private:
+    MappedFile() = default;
+
+    bool Map(const std::string& path) {
+#ifdef WEBRTC_WIN
+        file_ = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (INVALID_HANDLE_VALUE == file_) {
+            return false;
+        }
+
+        LARGE_INTEGER size;
+        if (!::GetFileSizeEx(file_, &size) || 0 == size.QuadPart) {
+            return false;
+        }
+        size_ = static_cast<size_t>(size.QuadPart);
+
+        mapping_ = ::CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_) {
+            return false;
+        }
+
+        data_ = static_cast<const uint8_t *>(::MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        return nullptr != data_;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat st;
+        if (::fstat(fd, &st) < 0 || 0 == st.st_size) {
+            ::close(fd);
+            return false;
+        }
+        size_ = static_cast<size_t>(st.st_size);
+
+        void *data = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (MAP_FAILED == data) {
+            return false;
+        }
+
+        data_ = static_cast<const uint8_t *>(data);
+        return true;
+#endif
+    }
+
+#ifdef WEBRTC_WIN
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#endif
+    const uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// A loop of frames, shared by all capturers playing the same thing.
+class FrameSource {
+public:
+    virtual ~FrameSource() = default;
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    // exact, a Y4M rate such as 30000:1001 is not rounded to whole frames
+    int64_t interval_ns() const { return interval_ns_; }
+
+    virtual size_t frame_count() const = 0;
+    virtual rtc::scoped_refptr<webrtc::VideoFrameBuffer> frame(size_t index) const = 0;
+protected:
+    int width_ = 0;
+    int height_ = 0;
+    int64_t interval_ns_ = 0;
+};
+
+// One second of a moving gradient with a sliding box, rendered up front so
+// that playback costs no pixel work.
+class SyntheticFrameSource : public FrameSource {
+public:
+    SyntheticFrameSource(int width, int height, int fps) {
+        width_ = width;
+        height_ = height;
+        interval_ns_ = rtc::kNumNanosecsPerSec / fps;
+
+        for (int i = 0; i < fps; ++i) {
+            frames_.push_back(Render(i, fps));
+        }
+    }
+
+    size_t frame_count() const override { return frames_.size(); }
+
+    rtc::scoped_refptr<webrtc::VideoFrameBuffer> frame(size_t index) const override {
+        return frames_[index];
+    }
+private:
+    rtc::scoped_refptr<webrtc::I420Buffer> Render(int index, int count) {
+        auto buffer = webrtc::I420Buffer::Create(width_, height_);
+
+        int box = std::max(height_ / 8, 2);
+        int box_x = (width_ - box) * index / count;
+        int box_y = (height_ - box) / 2;
+
+        for (int y = 0; y < height_; ++y) {
+            uint8_t *row = buffer->MutableDataY() + y * buffer->StrideY();
+            for (int x = 0; x < width_; ++x) {
+                bool in_box = x >= box_x && x < box_x + box && y >= box_y && y < box_y + box;
+                row[x] = in_box ? 235 : static_cast<uint8_t>((x + y) / 2 + index * 8);
+            }
+        }
+
+        for (int y = 0; y < buffer->ChromaHeight(); ++y) {
+            uint8_t *u = buffer->MutableDataU() + y * buffer->StrideU();
+            uint8_t *v = buffer->MutableDataV() + y * buffer->StrideV();
+            for (int x = 0; x < buffer->ChromaWidth(); ++x) {
+                u[x] = static_cast<uint8_t>(x + index * 4);
+                v[x] = static_cast<uint8_t>(y + index * 4);
+            }
+        }
+
+        return buffer;
+    }
+
+    std::vector<rtc::scoped_refptr<webrtc::I420Buffer>> frames_;
+};
+
+// Y4M or raw I420 frames wrapped in place in a memory mapped file.
+class FileFrameSource : public FrameSource {
+public:
+    static std::shared_ptr<FileFrameSource> Open(const std::string& path,
+                                                 int width, int height, int fps) {
+        auto file = MappedFile::Open(path);
+        if (!file) {
+            return nullptr;
+        }
+
+        std::shared_ptr<FileFrameSource> source(new FileFrameSource(file));
+        bool y4m = path.size() > 4 && 0 == path.compare(path.size() - 4, 4, ".y4m");
+        if (!(y4m ? source->IndexY4M() : source->IndexRaw(width, height, fps))) {
+            return nullptr;
+        }
+
+        return source;
+    }
+
+    size_t frame_count() const override { return offsets_.size(); }
+
+    rtc::scoped_refptr<webrtc::VideoFrameBuffer> frame(size_t index) const override {
+        const uint8_t *y = file_->data() + offsets_[index];
+        int chroma_width = (width_ + 1) / 2;
+        const uint8_t *u = y + width_ * height_;
+        const uint8_t *v = u + chroma_width * ((height_ + 1) / 2);
+
+        auto file = file_;
+        return webrtc::WrapI420Buffer(width_, height_,
+                                      y, width_,
+                                      u, chroma_width,
+                                      v, chroma_width,
+                                      rtc::Callback0<void>([file] {}));
+    }
+private:
+    explicit FileFrameSource(std::shared_ptr<MappedFile> file) : file_(file) {}
+
+    size_t frame_size() const {
+        return static_cast<size_t>(width_) * height_
+            + 2 * static_cast<size_t>((width_ + 1) / 2) * ((height_ + 1) / 2);
+    }
+
+    bool IndexRaw(int width, int height, int fps) {
+        width_ = width;
+        height_ = height;
+
+        if (width_ <= 0 || height_ <= 0 || fps <= 0) {
+            return false;
+        }
+        interval_ns_ = rtc::kNumNanosecsPerSec / fps;
+
+        for (size_t offset = 0; offset + frame_size() <= file_->size(); offset += frame_size()) {
+            offsets_.push_back(offset);
+        }
+
+        return !offsets_.empty();
+    }
+
+    // YUV4MPEG2 W<w> H<h> F<num>:<den> [C420*] ... \n then FRAME[ params]\n<planes>
+    // Only 8 bit 4:2:0 is taken, the chroma siting variants look the same.
+    bool IndexY4M() {
+        static const char *const kColorspaces[] = { "C420", "C420jpeg", "C420mpeg2", "C420paldv" };
+
+        auto begin = reinterpret_cast<const char *>(file_->data());
+        auto end = begin + file_->size();
+
+        auto eol = std::find(begin, end, '\n');
+        std::string header(begin, eol);
+        if (eol == end || 0 != header.compare(0, 9, "YUV4MPEG2")) {
+            return false;
+        }
+
+        int fps_num = 30;
+        int fps_den = 1;
+        size_t pos = 9;
+        while (pos < header.size()) {
+            auto next = header.find(' ', pos + 1);
+            auto token = header.substr(pos + 1, next - pos - 1);
+            pos = next;
+
+            if (token.empty()) {
+                continue;
+            }
+
+            switch (token[0]) {
+            case 'W':
+                width_ = std::atoi(token.c_str() + 1);
+                break;
+            case 'H':
+                height_ = std::atoi(token.c_str() + 1);
+                break;
+            case 'F':
+                if (2 != std::sscanf(token.c_str() + 1, "%d:%d", &fps_num, &fps_den)) {
+                    return false;
+                }
+                break;
+            case 'C':
+                if (std::none_of(std::begin(kColorspaces), std::end(kColorspaces),
+                                 [&token](const char *colorspace) { return token == colorspace; })) {
+                    return false;
+                }
+                break;
+            }
+        }
+
+        if (width_ <= 0 || height_ <= 0 || fps_num <= 0 || fps_den <= 0) {
+            return false;
+        }
+        interval_ns_ = rtc::kNumNanosecsPerSec * fps_den / fps_num;
+        if (interval_ns_ <= 0) {
+            return false;
+        }
+
+        auto p = eol + 1;
+        while (end - p > 5 && 0 == std::memcmp(p, "FRAME", 5)) {
+            auto frame_eol = std::find(p, end, '\n');
+            if (frame_eol == end
+                || static_cast<size_t>(end - frame_eol - 1) < frame_size()) {
+                break;
+            }
+
+            offsets_.push_back(frame_eol + 1 - begin);
+            p = frame_eol + 1 + frame_size();
+        }
+
+        return !offsets_.empty();
+    }
+
+    std::shared_ptr<MappedFile> file_;
+    std::vector<size_t> offsets_;
+};
+
+// Hundreds of calls on one host share one copy of each source.
+std::shared_ptr<FrameSource> GetFrameSource(const rtc::CallEngineOptions::VideoCapture& options) {
+    using Key = std::tuple<int, std::string, int, int, int>;
+
+    static std::mutex mu;
+    static std::map<Key, std::weak_ptr<FrameSource>> sources;
+
+    Key key(static_cast<int>(options.type), options.file,
+            options.width, options.height, options.fps);
+
+    std::lock_guard<std::mutex> guard(mu);
+    auto source = sources[key].lock();
+    if (source) {
+        return source;
+    }
+
+    if (rtc::CallEngineOptions::VideoCapture::Type::kFile == options.type) {
+        source = FileFrameSource::Open(options.file, options.width, options.height, options.fps);
+    } else if (options.width > 0 && options.height > 0 && options.fps > 0) {
+        source = std::make_shared<SyntheticFrameSource>(options.width, options.height, options.fps);
+    }
+
+    if (source) {
+        sources[key] = source;
+    }
+    return source;
+}
+
+// Plays a frame source in a loop at its frame rate. Frames are delivered
+// without copies unless the sinks' wants make the adapter scale them, and
+// scaled frames come from a buffer pool.
+class LoopVideoCapturer : public cricket::VideoCapturer {
+public:
+    explicit LoopVideoCapturer(std::shared_ptr<FrameSource> source)
+        : source_(source) {
+        SetSupportedFormats({ cricket::VideoFormat(
+            source_->width(),
+            source_->height(),
+            source_->interval_ns(),
+            cricket::FOURCC_I420) });
+    }
+
+    ~LoopVideoCapturer() override {
+        Stop();
+    }
+private:
+    cricket::CaptureState Start(const cricket::VideoFormat& format) override {
+        if (running_) {
+            return cricket::CS_FAILED;
+        }
+
+        SetCaptureFormat(&format);
+        running_ = true;
+        thread_ = std::thread([this] { Run(); });
+
+        SetCaptureState(cricket::CS_RUNNING);
+        return cricket::CS_RUNNING;
+    }
+
+    void Stop() override {
+        if (!running_) {
+            return;
+        }
+
+        running_ = false;
+        thread_.join();
+
+        SetCaptureFormat(nullptr);
+        SetCaptureState(cricket::CS_STOPPED);
+    }
+
+    bool IsRunning() override { return running_; }
+    bool IsScreencast() const override { return false; }
+
+    bool GetPreferredFourccs(std::vector<uint32_t>* fourccs) override {
+        fourccs->push_back(cricket::FOURCC_I420);
+        return true;
+    }
+
+    void Run() {
+        auto interval = std::chrono::nanoseconds(source_->interval_ns());
+        auto next = std::chrono::steady_clock::now();
+
+        for (size_t index = 0; running_; ++index) {
+            DeliverFrame(source_->frame(index % source_->frame_count()));
+
+            // after a stall of more than a frame, carry on from now rather
+            // than catching up with a burst of frames
+            next += interval;
+            auto now = std::chrono::steady_clock::now();
+            if (now - next > interval) {
+                next = now;
+            }
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+    void DeliverFrame(rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer) {
+        int width = buffer->width();
+        int height = buffer->height();
+        int64_t now_us = rtc::TimeMicros();
+
+        int out_width = 0;
+        int out_height = 0;
+        int crop_width = 0;
+        int crop_height = 0;
+        int crop_x = 0;
+        int crop_y = 0;
+        int64_t translated_time_us = 0;
+        if (!AdaptFrame(width, height, now_us, now_us,
+                        &out_width, &out_height,
+                        &crop_width, &crop_height,
+                        &crop_x, &crop_y,
+                        &translated_time_us)) {
+            return;
+        }
+
+        if (out_width != width || out_height != height) {
+            auto scaled = pool_.CreateBuffer(out_width, out_height);
+            scaled->CropAndScaleFrom(*buffer->ToI420(), crop_x, crop_y, crop_width, crop_height);
+            buffer = scaled;
+        }
+
+        OnFrame(webrtc::VideoFrame(buffer, webrtc::kVideoRotation_0, translated_time_us),
+                width, height);
+    }
+
+    std::shared_ptr<FrameSource> source_;
+    webrtc::I420BufferPool pool_;
+    std::atomic<bool> running_{ false };
+    std::thread thread_;
+};
+}
+
 namespace rtc {
 
 std::unique_ptr<cricket::VideoCapturer> OpenVideoCaptureDevice() {
@@ -31,4 +482,18 @@ std::unique_ptr<cricket::VideoCapturer> OpenVideoCaptureDevice() {
     }
     return capturer;
 }
+
+std::unique_ptr<cricket::VideoCapturer> OpenVideoCapturer(
+    const CallEngineOptions::VideoCapture& options) {
+    if (CallEngineOptions::VideoCapture::Type::kDevice == options.type) {
+        return OpenVideoCaptureDevice();
+    }
+
+    auto source = GetFrameSource(options);
+    if (!source) {
+        return nullptr;
+    }
+
+    return std::make_unique<LoopVideoCapturer>(source);
+}
 }
@@ -5,9 +5,15 @@
 #include "modules/video_capture/video_capture_factory.h"
 #include "media/engine/webrtcvideocapturerfactory.h"
 
+#include "rtc_call_interface.h"
+
 namespace rtc {
 
 std::unique_ptr<cricket::VideoCapturer> OpenVideoCaptureDevice();
+
+// Opens the capturer selected by options, nullptr if it can't be opened.
+std::unique_ptr<cricket::VideoCapturer> OpenVideoCapturer(
+    const CallEngineOptions::VideoCapture& options);
 }
 
 #endif // !_RTC_VIDEO_CAPTURER_H_INCLUDED
@@ -1,18 +1,27 @@
 #ifndef _RTC_CALL_SINK_VIDEO_H_INCLUDED
 #define _RTC_CALL_SINK_VIDEO_H_INCLUDED
 
+#include <functional>
 
 #include "api/mediastreaminterface.h"
+#include "rtc_base/timeutils.h"
+#include "system_wrappers/include/clock.h"
+
+#include "utility/histogram.h"
+#include "utility/probes.h"
 
 #include "rtc_common_types.h"
+#include "rtc_metrics.h"
 
 namespace rtc {
 
+// Planes are fetched lazily: an I420 buffer from the decoder is handed out
+// as is, so a sink that copies into texture memory touches the pixels once.
+// Only non I420 buffers pay for the ToI420() conversion.
 class VideoFrameAdapter : public I420VideoFrame {
 public:
     VideoFrameAdapter(const webrtc::VideoFrame& webrtc_frame)
-        : webrtc_frame_(webrtc_frame)
-        , i420_buffer_(webrtc_frame.video_frame_buffer()->ToI420()) {}
+        : webrtc_frame_(webrtc_frame) {}
 
 private:
     int width() const override {
@@ -24,44 +33,164 @@ private:
     }
 
     const uint8_t* DataY() const override {
-        return i420_buffer_->DataY();
+        return i420_buffer()->DataY();
     }
 
     const uint8_t* DataU() const  override {
-        return i420_buffer_->DataU();
+        return i420_buffer()->DataU();
     }
 
     const uint8_t* DataV() const  override {
-        return i420_buffer_->DataV();
+        return i420_buffer()->DataV();
     }
 
     int StrideY() const  override {
-        return i420_buffer_->StrideY();
+        return i420_buffer()->StrideY();
     }
 
     int StrideU() const override {
-        return i420_buffer_->StrideU();
+        return i420_buffer()->StrideU();
     }
 
     int StrideV() const  override {
-        return i420_buffer_->StrideV();
+        return i420_buffer()->StrideV();
+    }
+
+    // Remote frames carry the sender's capture time in NTP, estimated from
+    // RTCP sender reports. Local frames carry it on the rtc::TimeMicros()
+    // clock. Both are rebased onto util::MonotonicMicros(). A remote frame's
+    // timestamp_us() is its render target, so before the first sender
+    // report its capture time is unknown rather than that.
+    int64_t capture_time_us() const override {
+        if (webrtc_frame_.ntp_time_ms() > 0) {
+            auto now_ntp_ms = webrtc::Clock::GetRealTimeClock()->CurrentNtpInMilliseconds();
+            return static_cast<int64_t>(util::MonotonicMicros())
+                - (now_ntp_ms - webrtc_frame_.ntp_time_ms()) * 1000;
+        }
+
+        if (0 == webrtc_frame_.timestamp() && webrtc_frame_.timestamp_us() > 0) {
+            return static_cast<int64_t>(util::MonotonicMicros())
+                - (rtc::TimeMicros() - webrtc_frame_.timestamp_us());
+        }
+
+        return 0;
+    }
+
+    uint32_t rtp_timestamp() const override {
+        return webrtc_frame_.timestamp();
+    }
+
+    int64_t ntp_time_ms() const override {
+        return webrtc_frame_.ntp_time_ms() > 0 ? webrtc_frame_.ntp_time_ms() : 0;
+    }
+
+    int64_t timestamp_us() const override {
+        return webrtc_frame_.timestamp_us();
+    }
+
+    const webrtc::I420BufferInterface *i420_buffer() const {
+        if (!i420_buffer_) {
+            auto buffer = webrtc_frame_.video_frame_buffer();
+            if (webrtc::VideoFrameBuffer::Type::kI420 == buffer->type()) {
+                i420_buffer_ = buffer->GetI420();
+            } else {
+                i420_buffer_ = buffer->ToI420();
+            }
+        }
+        return i420_buffer_.get();
     }
 
     const webrtc::VideoFrame& webrtc_frame_;
-    rtc::scoped_refptr<webrtc::I420BufferInterface> i420_buffer_;
+    mutable rtc::scoped_refptr<webrtc::I420BufferInterface> i420_buffer_;
 };
 
+inline webrtc::VideoSinkWants ToVideoSinkWants(const I420VideoSinkWants& wants) {
+    webrtc::VideoSinkWants video_sink_wants;
+    video_sink_wants.max_pixel_count = wants.max_pixel_count;
+    video_sink_wants.max_framerate_fps = wants.max_framerate_fps;
+    return video_sink_wants;
+}
+
 class VideoSinkAdapter : public rtc::VideoSinkInterface<webrtc::VideoFrame> {
 public:
-    VideoSinkAdapter(std::unique_ptr<I420VideoSinkInterface> i420_video_sink)
-        : i420_video_sink_(std::move(i420_video_sink)) {}
+    // called on the frame delivery thread
+    using WantsCallback = std::function<void(VideoSinkAdapter *, const I420VideoSinkWants&)>;
+    using FirstFrameCallback = std::function<void()>;
+
+    VideoSinkAdapter(std::unique_ptr<I420VideoSinkInterface> i420_video_sink,
+                     WantsCallback on_wants_changed = nullptr,
+                     FirstFrameCallback on_first_frame = nullptr)
+        : i420_video_sink_(std::move(i420_video_sink))
+        , on_wants_changed_(std::move(on_wants_changed))
+        , on_first_frame_(std::move(on_first_frame))
+        , wants_(i420_video_sink_->wants()) {}
+
+    ~VideoSinkAdapter() override {
+        if (metrics_table_) {
+            metrics_table_->Release(metrics_);
+        }
+    }
+
+    // counts frames into a slot of table and its source's totals, before
+    // the sink is added to a track
+    void AttachMetrics(SinkMetricsTable *table, uint64_t call_id, bool remote) {
+        metrics_table_ = table;
+        metrics_ = table->Acquire(call_id, remote);
+        totals_ = &table->totals(remote);
+    }
+
+    const I420VideoSinkWants& wants() const { return wants_; }
 private:
     void OnFrame(const webrtc::VideoFrame& frame) override {
+        RTC_PROBE(video_sink_frame, this, frame.width(), frame.height(), frame.timestamp_us());
+
+        if (on_first_frame_) {
+            on_first_frame_();
+            on_first_frame_ = nullptr;
+        }
+
         VideoFrameAdapter i420_video_frame(frame);
         i420_video_sink_->OnFrame(i420_video_frame);
+
+        if (totals_) {
+            auto dropped = i420_video_sink_->frames_dropped();
+            totals_->frames.fetch_add(1, std::memory_order_relaxed);
+            if (dropped > dropped_) {
+                totals_->dropped.fetch_add(dropped - dropped_, std::memory_order_relaxed);
+                dropped_ = dropped;
+            }
+
+            if (metrics_) {
+                metrics_->frames.fetch_add(1, std::memory_order_relaxed);
+                metrics_->dropped.store(dropped, std::memory_order_relaxed);
+            }
+        }
+
+        if (on_wants_changed_) {
+            auto wants = i420_video_sink_->wants();
+            if (wants != wants_) {
+                wants_ = wants;
+                on_wants_changed_(this, wants_);
+            }
+        }
     }
 
     std::unique_ptr<I420VideoSinkInterface> i420_video_sink_;
+    WantsCallback on_wants_changed_;
+    FirstFrameCallback on_first_frame_;
+    I420VideoSinkWants wants_;
+    SinkMetricsTable *metrics_table_ = nullptr;
+    SinkMetricsTable::Slot *metrics_ = nullptr;
+    SinkMetricsTable::Totals *totals_ = nullptr;
+    // frames_dropped() as last added to totals_
+    uint64_t dropped_ = 0;
+};
+
+// Does nothing with the frames, only carries wants into a source's
+// VideoBroadcaster so the capturer adapts to them.
+class WantsOnlyVideoSink : public rtc::VideoSinkInterface<webrtc::VideoFrame> {
+private:
+    void OnFrame(const webrtc::VideoFrame& frame) override {}
 };
 }
 
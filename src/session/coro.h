@@ -0,0 +1,134 @@
+#ifndef _RTC_SESSION_CORO_H_INCLUDED
+#define _RTC_SESSION_CORO_H_INCLUDED
+
+#include "utility/coro.h"
+
+#ifdef RTC_HAS_COROUTINES
+
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include "session/interface.h"
+
+namespace rtc_session {
+
+// A CallCallback whose events are awaited instead of overridden, set with
+// SetCallback() before the call is used. Coroutines resume on executor, or
+// on the dum thread raising the event when it is null.
+class CoroCallCallback : public CallCallback {
+public:
+    explicit CoroCallCallback(util::Executor *executor = nullptr)
+        : executor_(executor)
+        , offer_(executor)
+        , answer_(executor)
+        , connected_(executor)
+        , terminated_(executor)
+        , messages_(executor) {}
+
+    // Sends the INVITE; resumes with the answer, or empty once the INVITE
+    // has failed or the call ended without one.
+    util::AsyncResult<std::optional<std::string>> Invite(CallerInterface& caller,
+                                                         const std::string *offer) {
+        caller.Invite(offer);
+        return answer_;
+    }
+
+    // Resumes with whether the peer accepted the MESSAGE. The dialog sends
+    // them one at a time, so results arrive in the order they were sent.
+    util::AsyncResult<bool> Message(CallInterface& call, const Contents& msg) {
+        util::AsyncResult<bool> result(executor_);
+        {
+            std::lock_guard<std::mutex> guard(mu_);
+            if (ended_) {
+                result.Set(false);
+                return result;
+            }
+            pending_messages_.push_back(result);
+        }
+        call.Message(msg);
+        return result;
+    }
+
+    // callee: the INVITE's offer, answer it with CalleeInterface::Accept()
+    util::AsyncResult<std::string> Offer() const { return offer_; }
+
+    // true once the dialog is established, false if it ended first
+    util::AsyncResult<bool> Connected() const { return connected_; }
+    util::AsyncResult<bool> Terminated() const { return terminated_; }
+
+    // MESSAGEs from the peer, answer each with AcceptNIT() or RejectNIT()
+    auto NextMessage() { return messages_.Pop(); }
+private:
+    void OnInit() override {}
+
+    void OnFailure() override {
+        End();
+    }
+
+    void OnOffer(const std::string& offer) override {
+        offer_.Set(offer);
+    }
+
+    void OnAnswer(const std::string& answer) override {
+        answer_.Set(answer);
+    }
+
+    void OnMessage(const Contents& msg) override {
+        messages_.Push(msg);
+    }
+
+    void OnMessageResult(bool success) override {
+        std::unique_lock<std::mutex> lock(mu_);
+        if (pending_messages_.empty()) {
+            return;
+        }
+        auto result = pending_messages_.front();
+        pending_messages_.pop_front();
+        lock.unlock();
+
+        result.Set(success);
+    }
+
+    void OnConnected() override {
+        connected_.Set(true);
+    }
+
+    void OnTerminated() override {
+        End();
+    }
+
+    // whatever is still awaited fails
+    void End() {
+        std::deque<util::AsyncResult<bool>> pending;
+        {
+            std::lock_guard<std::mutex> guard(mu_);
+            ended_ = true;
+            pending.swap(pending_messages_);
+        }
+
+        answer_.Set(std::nullopt);
+        connected_.Set(false);
+        terminated_.Set(true);
+        for (auto& result : pending) {
+            result.Set(false);
+        }
+    }
+
+    util::Executor *executor_;
+    util::AsyncResult<std::string> offer_;
+    util::AsyncResult<std::optional<std::string>> answer_;
+    util::AsyncResult<bool> connected_;
+    util::AsyncResult<bool> terminated_;
+    util::AsyncQueue<Contents> messages_;
+
+    std::mutex mu_;
+    std::deque<util::AsyncResult<bool>> pending_messages_;
+    bool ended_ = false;
+};
+}
+
+#endif
+
+#endif // !_RTC_SESSION_CORO_H_INCLUDED
@@ -3,9 +3,21 @@
 #include "rutil/Logger.hxx"
 
 #include "session/sip_stack.h"
+#include "session/sip_registrar.h"
 
 namespace rtc_session {
 
+const char *UserStateName(UserState state) {
+    switch (state) {
+    case UserState::kDeregistered: return "deregistered";
+    case UserState::kRegistering: return "registering";
+    case UserState::kRegistered: return "registered";
+    case UserState::kDeregistering: return "deregistering";
+    case UserState::kUpdating: return "updating";
+    default: return "unknown";
+    }
+}
+
 std::unique_ptr<StackInterface> CreateStack(const StackOptions& options) {
     auto stack = std::make_unique<SipStack>(options);
     if (!stack->Initialize()) {
@@ -15,6 +27,15 @@ std::unique_ptr<StackInterface> CreateStack(const StackOptions& options) {
     return stack;
 }
 
+std::unique_ptr<RegistrarInterface> CreateRegistrar(const RegistrarOptions& options) {
+    auto registrar = std::make_unique<SipRegistrar>(options);
+    if (!registrar->Initialize()) {
+        return nullptr;
+    }
+
+    return registrar;
+}
+
 void SetLogger(const char *cat, const char *level, const char *filename) {
     resip::Log::initialize(cat, level, "sip_session", filename);
 }
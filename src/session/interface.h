@@ -3,8 +3,10 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "utility/optional.h"
+#include "utility/thread_stats.h"
 
 namespace rtc_session {
 
@@ -36,17 +38,28 @@ public:
     virtual void OnMessageResult(bool success) = 0;
     virtual void OnConnected() = 0;
     virtual void OnTerminated() = 0;
+
+    // caller only, for call setup timing
+    virtual void OnInviteSent() {}
+    virtual void OnProvisional(int code) {}
 };
 
 class CallInterface {
 public:
     virtual ~CallInterface() = default;
     virtual const UserId& peer() const = 0;
+    // id of the call's util::Tracer events, unique within the process
+    virtual uint64_t trace_id() const = 0;
+    // SIP Call-ID, empty for a caller until its INVITE has been built
+    virtual std::string call_id() const = 0;
     virtual bool GetLocalSdp(std::string *out) = 0;
     virtual void Message(const Contents& msg) = 0;
     virtual void AcceptNIT(int code = 200, const Contents *msg = nullptr) = 0;
     virtual void RejectNIT(int code = 488) = 0;
     virtual void SetCallback(std::shared_ptr<CallCallback> callback) = 0;
+    // CANCEL, BYE or reject, whatever the dialog is at; releasing the
+    // interface does the same if it has not been called
+    virtual void End() = 0;
 };
 
 class CalleeInterface : public CallInterface {
@@ -62,6 +75,14 @@ public:
     virtual void Invite(const std::string *offer) = 0;
 };
 
+// Whether an incoming INVITE is taken, decided before anything is built
+// for it. A rejected one is answered 503.
+struct Admission {
+    bool accept = true;
+    // Retry-After of the 503, 0 leaves the header out
+    uint32_t retry_after_sec = 0;
+};
+
 struct UserOptions : UserId {
     util::Optional<std::string> password;
     uint16_t login_server_port = 0;
@@ -76,6 +97,10 @@ protected:
 public:
     virtual void OnLoginResult(bool success) = 0;
     virtual void OnCallee(std::unique_ptr<CalleeInterface> callee) = 0;
+
+    // Asked on the dum thread for each new INVITE ahead of OnCallee(), and
+    // holds up the user's other sip traffic while it runs.
+    virtual Admission OnAdmitCallee(const UserId& peer) { return {}; }
 };
 
 class UserInterface {
@@ -93,19 +118,130 @@ struct StackOptions {
     util::Optional<uint16_t> tcp_port;
     bool compression = false;
 
+    // prepended to the os names of the stack and per-user dum threads,
+    // empty leaves them unnamed
+    std::string thread_name_prefix;
+    // cpu mask for the same threads, 0 for no affinity
+    uint64_t thread_affinity = 0;
+
+    // how often resip's statistics manager reports, which refreshes the
+    // transaction counts of StackMetrics
+    uint32_t statistics_interval_sec = 10;
+
+    // Bulk tasks (in-dialog MESSAGE traffic) the stack and dum threads run
+    // per turn of their loop; call setup, teardown and registration tasks
+    // always go first. 0 keeps every task in one fifo.
+    uint32_t bulk_task_budget = 16;
+
     StackOptions() = default;
     explicit StackOptions(uint16_t udp_port) : udp_port(udp_port) {}
 };
 
+// Registration states of a user, see SipUserController.
+enum class UserState {
+    kDeregistered,
+    kRegistering,
+    kRegistered,
+    kDeregistering,
+    kUpdating,
+    kCount
+};
+
+const char *UserStateName(UserState state);
+
+// Read from counters the stack's threads keep up to date, without
+// blocking them.
+struct StackMetrics {
+    // live users per registration state
+    uint64_t users[static_cast<size_t>(UserState::kCount)] = {};
+
+    // in flight, as of resip's last statistics report
+    uint64_t client_transactions = 0;
+    uint64_t server_transactions = 0;
+
+    // in-dialog MESSAGE requests
+    uint64_t messages_sent = 0;
+    uint64_t messages_received = 0;
+
+    // tasks waiting for the stack thread, and messages waiting for the dum
+    // threads summed over users; each loop samples its own queue as it runs
+    // (a dum thread when it runs a posted task), so the depths lag
+    uint64_t stack_queue_depth = 0;
+    uint64_t dum_queue_depth = 0;
+};
+
+struct LogoutReport {
+    // not deregistered when the logout started
+    size_t users = 0;
+    // deregistered by the deadline
+    size_t logged_out = 0;
+    // not even asked to log out by the deadline
+    size_t not_sent = 0;
+    uint64_t elapsed_us = 0;
+
+    bool complete() const { return logged_out == users; }
+};
+
 class StackInterface {
 public:
     virtual ~StackInterface() = default;
     virtual const StackOptions& options() const = 0;
     virtual std::unique_ptr<UserInterface> CreateUser(const UserOptions& options, 
                                                       std::shared_ptr<UserCallback> callback) = 0;
+
+    // the stack thread followed by the dum thread of every live user
+    virtual std::vector<util::ThreadSnapshot> GetThreadStats() const = 0;
+    virtual StackMetrics GetMetrics() const = 0;
+
+    // Logs out every live user, at most batch_size de-registrations in
+    // flight at once, and blocks until they are deregistered or the
+    // deadline has passed. The users stay; destroying them afterwards has
+    // no registration left to end.
+    virtual LogoutReport LogoutAll(size_t batch_size, uint32_t deadline_ms) = 0;
 };
 
 std::unique_ptr<StackInterface> CreateStack(const StackOptions& options);
+
+struct RegistrarOptions {
+    // domain users log into and digest realm, requests whose uri host is
+    // the realm or the bound host are routed to the registered contact
+    std::string realm = "127.0.0.1";
+    std::string host = "127.0.0.1";
+    uint16_t udp_port = 3390;
+
+    // shared by every user, unset accepts any REGISTER without a challenge
+    util::Optional<std::string> password;
+    uint32_t max_expires_sec = 3600;
+
+    // applied to everything the registrar sends, including its own responses
+    uint32_t delay_ms = 0;
+    uint32_t jitter_ms = 0;
+    // probability in [0, 1] of dropping a message
+    double loss = 0;
+};
+
+struct RegistrarStats {
+    uint64_t registrations = 0;
+    uint64_t challenges = 0;
+    uint64_t forwarded_requests = 0;
+    uint64_t forwarded_responses = 0;
+    uint64_t not_found = 0;
+    uint64_t dropped = 0;
+};
+
+// Minimal registrar and proxy for offline tests and benchmarks. It keeps
+// bindings in memory and record-routes INVITE dialogs, so in-dialog
+// MESSAGE and BYE pass through it and see the same delay and loss.
+class RegistrarInterface {
+public:
+    virtual ~RegistrarInterface() = default;
+    virtual const RegistrarOptions& options() const = 0;
+    // unexpired bindings, as of the last purge at most a second ago
+    virtual size_t registered_users() const = 0;
+    virtual RegistrarStats stats() const = 0;
+};
+
+std::unique_ptr<RegistrarInterface> CreateRegistrar(const RegistrarOptions& options);
 void SetLogger(const char *cat, const char *level, const char *filename);
 }
 
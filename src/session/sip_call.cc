@@ -1,5 +1,7 @@
 #include "session/sip_call.h"
 
+#include <utility>
+
 using namespace rtc_session;
 
 void SipCallerContext::Invite(const std::string *offer) {
@@ -22,6 +24,13 @@ void SipCallerContext::Invite(const std::string *offer) {
 }
 
 void SipCallerContext::DoInvite(const std::string *offer) {
+    util::ScopedTrace trace(kTraceCategory, "SipCallerContext::DoInvite", trace_id_);
+    // hung up while the offer was being made
+    if (ended_) {
+        OnFailure();
+        return;
+    }
+
     resip::SdpContents contents;
 
     if (offer) {
@@ -32,26 +41,38 @@ void SipCallerContext::DoInvite(const std::string *offer) {
         GetDomainUserAddr(user_ctx_->options(), peer().name),
         offer ? &contents : nullptr,
         new SipCallDialogSet<SipCallerContext>(shared_from_this()));
+    SetCallId(*invite_request_msg_);
 
     user_ctx_->send(invite_request_msg_);
+    OnInviteSent();
 }
 
 void SipCallerContext::End() {
     std::weak_ptr<SipCallerContext> wp = shared_from_this();
-    user_ctx_->Dispatch([wp, h = h_]() mutable {
-        if (h.isValid()) {
-            h->end();
-        } else {
-            auto sp = wp.lock();
-            if (sp && sp->invite_request_msg_) {
-                resip::SharedPtr<resip::SipMessage> cancel_msg 
-                    { resip::Helper::makeCancel(*sp->invite_request_msg_) };
-                sp->user_ctx_->send(cancel_msg);
-            }
+    user_ctx_->Dispatch([wp] {
+        auto sp = wp.lock();
+        if (!sp) {
+            return;
+        }
+
+        bool cancelled = std::exchange(sp->ended_, true);
+        if (sp->h_.isValid()) {
+            sp->h_->end();
+        } else if (sp->invite_request_msg_ && !cancelled) {
+            resip::SharedPtr<resip::SipMessage> cancel_msg 
+                { resip::Helper::makeCancel(*sp->invite_request_msg_) };
+            sp->user_ctx_->send(cancel_msg);
         }
     });
 }
 
+void SipCallerContext::Init(resip::ClientInviteSessionHandle h) {
+    SipCallContext<resip::ClientInviteSessionHandle>::Init(h);
+    if (ended_) {
+        h->end();
+    }
+}
+
 void SipCalleeContext::Accept(const std::string& answer, int code) {
     user_ctx_->Dispatch([h = h_, answer, code]() mutable {
         if (h.isValid()) {
@@ -75,6 +96,7 @@ resip::AppDialogSet *SipDialogSetFactory::createAppDialogSet(
         auto ctx = std::make_shared<SipCalleeContext>(
             user_ctx_, 
             MakeUserId(msg.header(resip::h_From)));
+        ctx->SetCallId(msg);
         user_ctx_->OnCallee(std::make_unique<SipCallee>(ctx));
         return new SipCallDialogSet<SipCalleeContext>(ctx);
     }
@@ -1,12 +1,17 @@
 #ifndef _RTC_SIP_SESSION_CALL_H_INCLUDED
 #define _RTC_SIP_SESSION_CALL_H_INCLUDED
 
+#include <atomic>
+#include <mutex>
+
 #include "resip/dum/AppDialogSet.hxx"
 #include "resip/dum/ClientInviteSession.hxx"
 #include "resip/dum/ServerInviteSession.hxx"
 #include "resip/dum/AppDialogSetFactory.hxx"
 
+#include "utility/tracer.h"
 #include "session/sip_user.h"
+#include "session/sip_stack.h"
 #include "session/resip_util.h"
 
 namespace rtc_session {
@@ -14,18 +19,37 @@ namespace rtc_session {
 template<typename Handle = resip::InviteSessionHandle>
 class SipCallContext {
 public:
+    // trace category, caller and callee spans get separate tracks
+    static constexpr const char *kTraceCategory =
+        std::is_same_v<Handle, resip::ClientInviteSessionHandle> ? "caller" : "callee";
+
     SipCallContext(std::shared_ptr<SipUserContext> user_ctx, const UserId& user_id)
         : user_ctx_(user_ctx)
-        , user_id_(user_id) {
+        , user_id_(user_id)
+        , trace_id_(util::Tracer::NewId()) {
         //std::clog << "call ctx new\t" << this << std::endl;
+        util::TraceAsyncBegin(kTraceCategory, "call", trace_id_);
     }
 
     ~SipCallContext() {
         //std::clog << "call ctx release\t" << this << std::endl;
+        util::TraceAsyncEnd(kTraceCategory, "call", trace_id_);
     }
 
     auto& user_context() { return user_ctx_; }
     const UserId& peer() const { return user_id_; }
+    uint64_t trace_id() const { return trace_id_; }
+
+    std::string call_id() const {
+        std::lock_guard<std::mutex> guard(call_id_mu_);
+        return call_id_;
+    }
+
+    void SetCallId(const resip::SipMessage& msg) {
+        auto& id = msg.header(resip::h_CallID).value();
+        std::lock_guard<std::mutex> guard(call_id_mu_);
+        call_id_.assign(id.data(), id.size());
+    }
     void SetCallback(std::shared_ptr<CallCallback> callback) { 
         callback_ = callback; 
     }
@@ -48,7 +72,8 @@ public:
     }
 
     void Message(const Contents& msg) {
-        user_ctx_->Dispatch([h = h_, msg]() mutable {
+        user_ctx_->counters().messages_sent.fetch_add(1, std::memory_order_relaxed);
+        user_ctx_->DispatchBulk([h = h_, msg]() mutable {
             if (h.isValid()) {
                 h->message(*MakeContents(msg));
             }
@@ -57,13 +82,13 @@ public:
 
     void AcceptNIT(int code, const Contents *msg) {
         if (msg) {
-            user_ctx_->Dispatch([h = h_, code, msg = *msg]() mutable {
+            user_ctx_->DispatchBulk([h = h_, code, msg = *msg]() mutable {
                 if (h.isValid()) {
                     h->acceptNIT(code, MakeContents(msg).get());
                 }
             });
         } else {
-            user_ctx_->Dispatch([h = h_, code]() mutable {
+            user_ctx_->DispatchBulk([h = h_, code]() mutable {
                 if (h.isValid()) {
                     h->acceptNIT(code);
                 }
@@ -72,7 +97,7 @@ public:
     }
 
     void RejectNIT(int code) {
-        user_ctx_->Dispatch([h = h_, code]() mutable {
+        user_ctx_->DispatchBulk([h = h_, code]() mutable {
             if (h.isValid()) {
                 h->rejectNIT(code);
             }
@@ -116,6 +141,14 @@ public:
         callback_(&CallCallback::OnConnected);
     }
 
+    void OnInviteSent() {
+        callback_(&CallCallback::OnInviteSent);
+    }
+
+    void OnProvisional(int code) {
+        callback_(&CallCallback::OnProvisional, code);
+    }
+
     void OnTerminated() {
         callback_(&CallCallback::OnTerminated);
     }
@@ -123,6 +156,9 @@ public:
 protected:
     Handle h_;
     UserId user_id_;
+    const uint64_t trace_id_;
+    mutable std::mutex call_id_mu_;
+    std::string call_id_;
     std::shared_ptr<SipUserContext> user_ctx_;
     util::CallbackWrapper<CallCallback> callback_;
 };
@@ -135,10 +171,15 @@ public:
 
     void Invite(const std::string *offer);
     void End();
+    // on the dum thread, ends the dialog at once if End() came first
+    void Init(resip::ClientInviteSessionHandle h);
 private:
     void DoInvite(const std::string *offer);
 
     resip::SharedPtr<resip::SipMessage> invite_request_msg_;
+    // dum thread only: once End() has run no INVITE goes out, and one
+    // already out is cancelled
+    bool ended_ = false;
 };
 
 class SipCalleeContext 
@@ -156,12 +197,21 @@ class SipCall : public T {
 public:
     explicit SipCall(std::shared_ptr<Context> ctx) : ctx_(ctx) {}
 
+    // a released call always ends, whatever End() did before
     ~SipCall() override { ctx_->End(); }
 
     const UserId& peer() const override {
         return ctx_->peer();
     }
 
+    uint64_t trace_id() const override {
+        return ctx_->trace_id();
+    }
+
+    std::string call_id() const override {
+        return ctx_->call_id();
+    }
+
     bool GetLocalSdp(std::string *out) override {
         return ctx_->GetLocalSdp(out);
     }
@@ -181,8 +231,15 @@ public:
     void SetCallback(std::shared_ptr<CallCallback> callback) override {
         ctx_->SetCallback(callback);
     }
+
+    void End() override {
+        if (!ended_.exchange(true)) {
+            ctx_->End();
+        }
+    }
 protected:
     std::shared_ptr<Context> ctx_;
+    std::atomic<bool> ended_{ false };
 };
 
 class SipCaller : public SipCall<CallerInterface, SipCallerContext> {
@@ -0,0 +1,380 @@
+#include "session/sip_registrar.h"
+
+#include <algorithm>
+
+#include "resip/stack/Helper.hxx"
+#include "resip/stack/EventStackThread.hxx"
+
+#include "utility/histogram.h"
+#include "session/resip_util.h"
+
+using namespace rtc_session;
+
+#define kFD_POLL_GRP_TYPE   "event"
+
+namespace {
+
+const resip::Data kRegistrarName("SipRegistrar");
+
+// the longest the worker sleeps before checking for shutdown
+const int kMaxWaitMs = 100;
+
+// lifetime of a digest nonce, in seconds
+const int kNonceExpires = 300;
+
+// how often expired bindings are dropped, so registered_users() lags by
+// at most this much
+const uint64_t kPurgeIntervalUs = 1000000;
+
+std::string MakeString(const resip::Data& data) {
+    return { data.data(), data.size() };
+}
+}
+
+void SipRegistrar::WorkerThread::thread() {
+    while (!isShutdown()) {
+        registrar_.Process(kMaxWaitMs);
+    }
+}
+
+SipRegistrar::~SipRegistrar() {
+    if (worker_) {
+        worker_->shutdown();
+        worker_->join();
+    }
+
+    if (stack_thread_) {
+        stack_thread_->shutdown();
+        stack_thread_->join();
+    }
+
+    if (stack_) {
+        stack_->shutdown();
+        stack_->processTimers();
+        stack_.reset();
+    }
+}
+
+bool SipRegistrar::Initialize() {
+    if (options_.realm.empty() || options_.host.empty() || 0 == options_.udp_port) {
+        return false;
+    }
+
+    self_uri_.scheme() = resip::Symbols::Sip;
+    self_uri_.host() = MakeData(options_.host, false);
+    self_uri_.port() = options_.udp_port;
+    self_uri_.param(resip::p_lr);
+
+    poll_grp_.reset(resip::FdPollGrp::create(kFD_POLL_GRP_TYPE));
+    if (!poll_grp_) {
+        return false;
+    }
+
+    interruptor_ = std::make_unique<resip::EventThreadInterruptor>(*poll_grp_);
+
+    resip::SipStackOptions options;
+    options.mPollGrp = poll_grp_.get();
+    options.mAsyncProcessHandler = interruptor_.get();
+
+    stack_ = std::make_unique<resip::SipStack>(options);
+
+    try {
+        stack_->addTransport(resip::UDP, options_.udp_port, resip::V4, resip::StunDisabled,
+                             MakeData(options_.host, false));
+    } catch (...) {
+        return false;
+    }
+
+    stack_->registerTransactionUser(*this);
+
+    stack_thread_ = std::make_unique<resip::EventStackThread>(*stack_, *interruptor_, *poll_grp_);
+    stack_thread_->run();
+
+    worker_ = std::make_unique<WorkerThread>(*this);
+    worker_->run();
+
+    return true;
+}
+
+size_t SipRegistrar::registered_users() const {
+    return registered_users_.load(std::memory_order_relaxed);
+}
+
+RegistrarStats SipRegistrar::stats() const {
+    RegistrarStats stats;
+    stats.registrations = registrations_.load(std::memory_order_relaxed);
+    stats.challenges = challenges_.load(std::memory_order_relaxed);
+    stats.forwarded_requests = forwarded_requests_.load(std::memory_order_relaxed);
+    stats.forwarded_responses = forwarded_responses_.load(std::memory_order_relaxed);
+    stats.not_found = not_found_.load(std::memory_order_relaxed);
+    stats.dropped = dropped_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+const resip::Data& SipRegistrar::name() const {
+    return kRegistrarName;
+}
+
+void SipRegistrar::Process(int timeout_ms) {
+    if (!delayed_.empty()) {
+        auto now_us = util::MonotonicMicros();
+        auto due_us = delayed_.begin()->first;
+        auto wait_ms = due_us > now_us ? static_cast<int>((due_us - now_us + 999) / 1000) : 0;
+        timeout_ms = std::min(timeout_ms, wait_ms);
+    }
+
+    // the fifo blocks forever on 0 and polls on a negative timeout
+    std::unique_ptr<resip::Message> msg(mFifo.getNext(timeout_ms > 0 ? timeout_ms : -1));
+    if (msg) {
+        auto sip_msg = dynamic_cast<resip::SipMessage *>(msg.get());
+        if (sip_msg) {
+            msg.release();
+            if (sip_msg->isRequest()) {
+                OnRequest(std::unique_ptr<resip::SipMessage>(sip_msg));
+            } else {
+                OnResponse(std::unique_ptr<resip::SipMessage>(sip_msg));
+            }
+        }
+    }
+
+    auto now_us = util::MonotonicMicros();
+    FlushDelayed(now_us);
+    if (now_us >= next_purge_us_) {
+        PurgeExpired(now_us);
+        next_purge_us_ = now_us + kPurgeIntervalUs;
+    }
+}
+
+void SipRegistrar::PurgeExpired(uint64_t now_us) {
+    for (auto it = bindings_.begin(); it != bindings_.end();) {
+        if (it->second.expires_us <= now_us) {
+            it = bindings_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    registered_users_.store(bindings_.size(), std::memory_order_relaxed);
+}
+
+void SipRegistrar::OnRequest(std::unique_ptr<resip::SipMessage> request) {
+    switch (request->method()) {
+    case resip::REGISTER:
+        OnRegister(*request);
+        return;
+    case resip::CANCEL:
+        OnCancel(*request);
+        return;
+    default:
+        break;
+    }
+
+    if (request->exists(resip::h_MaxForwards)) {
+        auto& max_forwards = request->header(resip::h_MaxForwards).value();
+        if (max_forwards <= 1) {
+            Respond(*request, 483);
+            return;
+        }
+        --max_forwards;
+    }
+
+    // loose routing: our own Record-Route comes back as the top Route
+    if (request->exists(resip::h_Routes)
+        && !request->header(resip::h_Routes).empty()
+        && IsSelf(request->header(resip::h_Routes).front().uri())) {
+        request->header(resip::h_Routes).pop_front();
+    }
+
+    bool has_route = request->exists(resip::h_Routes) && !request->header(resip::h_Routes).empty();
+    if (!has_route && IsLocalDomain(request->header(resip::h_RequestLine).uri())) {
+        auto user = MakeString(request->header(resip::h_RequestLine).uri().user());
+        auto it = bindings_.find(user);
+        if (bindings_.end() != it && it->second.expires_us <= util::MonotonicMicros()) {
+            bindings_.erase(it);
+            registered_users_.store(bindings_.size(), std::memory_order_relaxed);
+            it = bindings_.end();
+        }
+
+        if (bindings_.end() == it) {
+            not_found_.fetch_add(1, std::memory_order_relaxed);
+            if (resip::ACK != request->method()) {
+                Respond(*request, 404);
+            }
+            return;
+        }
+
+        request->header(resip::h_RequestLine).uri() = it->second.contact.uri();
+    }
+
+    bool initial_invite = resip::INVITE == request->method()
+        && !request->header(resip::h_To).exists(resip::p_tag);
+    if (initial_invite) {
+        request->header(resip::h_RecordRoutes).push_front(resip::NameAddr(self_uri_));
+    }
+
+    // a default Via carries a fresh branch, the stack fills in the rest
+    auto tid = request->getTransactionId();
+    request->header(resip::h_Vias).push_front(resip::Via());
+
+    if (resip::INVITE == request->method()) {
+        pending_invites_[tid].reset(new resip::SipMessage(*request));
+    }
+
+    forwarded_requests_.fetch_add(1, std::memory_order_relaxed);
+    Send(std::move(request));
+}
+
+void SipRegistrar::OnResponse(std::unique_ptr<resip::SipMessage> response) {
+    auto& vias = response->header(resip::h_Vias);
+    if (!vias.empty()) {
+        vias.pop_front();
+    }
+
+    // e.g. the answer to a CANCEL we sent
+    if (vias.empty()) {
+        return;
+    }
+
+    int code = response->header(resip::h_StatusLine).statusCode();
+    if (code >= 200 && resip::INVITE == response->header(resip::h_CSeq).method()) {
+        pending_invites_.erase(response->getTransactionId());
+    }
+
+    forwarded_responses_.fetch_add(1, std::memory_order_relaxed);
+    Send(std::move(response));
+}
+
+void SipRegistrar::OnRegister(const resip::SipMessage& request) {
+    if (!Authenticate(request)) {
+        return;
+    }
+
+    auto user = MakeString(request.header(resip::h_To).uri().user());
+    auto now_us = util::MonotonicMicros();
+
+    uint32_t default_expires = options_.max_expires_sec;
+    if (request.exists(resip::h_Expires)) {
+        default_expires = std::min<uint32_t>(request.header(resip::h_Expires).value(),
+                                             options_.max_expires_sec);
+    }
+
+    std::unique_ptr<resip::SipMessage> response(resip::Helper::makeResponse(request, 200));
+
+    if (request.exists(resip::h_Contacts)) {
+        for (auto&& contact : request.header(resip::h_Contacts)) {
+            if (contact.isAllContacts()) {
+                bindings_.erase(user);
+                continue;
+            }
+
+            uint32_t expires = default_expires;
+            if (contact.exists(resip::p_expires)) {
+                expires = std::min<uint32_t>(contact.param(resip::p_expires),
+                                             options_.max_expires_sec);
+            }
+
+            if (0 == expires) {
+                auto it = bindings_.find(user);
+                if (bindings_.end() != it && it->second.contact.uri() == contact.uri()) {
+                    bindings_.erase(it);
+                }
+                continue;
+            }
+
+            // one binding per user, the latest contact wins
+            Binding binding{ contact, now_us + static_cast<uint64_t>(expires) * 1000000 };
+            binding.contact.remove(resip::p_expires);
+            bindings_[user] = binding;
+
+            auto bound = binding.contact;
+            bound.param(resip::p_expires) = expires;
+            response->header(resip::h_Contacts).push_back(bound);
+        }
+    }
+
+    registered_users_.store(bindings_.size(), std::memory_order_relaxed);
+    registrations_.fetch_add(1, std::memory_order_relaxed);
+    Send(std::move(response));
+}
+
+void SipRegistrar::OnCancel(const resip::SipMessage& request) {
+    Respond(request, 200);
+
+    auto it = pending_invites_.find(request.getTransactionId());
+    if (pending_invites_.end() == it) {
+        return;
+    }
+
+    std::unique_ptr<resip::SipMessage> cancel(resip::Helper::makeCancel(*it->second));
+    Send(std::move(cancel));
+}
+
+bool SipRegistrar::Authenticate(const resip::SipMessage& request) {
+    if (!options_.password) {
+        return true;
+    }
+
+    auto realm = MakeData(options_.realm, false);
+    bool stale = false;
+
+    if (request.exists(resip::h_Authorizations)) {
+        auto result = resip::Helper::authenticateRequest(
+            request, realm, MakeData(*options_.password, false), kNonceExpires);
+        if (resip::Helper::Authenticated == result) {
+            return true;
+        }
+
+        if (resip::Helper::Expired != result) {
+            Respond(request, 403);
+            return false;
+        }
+        stale = true;
+    }
+
+    std::unique_ptr<resip::SipMessage> challenge(
+        resip::Helper::makeWWWChallenge(request, realm, true, stale));
+    challenges_.fetch_add(1, std::memory_order_relaxed);
+    Send(std::move(challenge));
+    return false;
+}
+
+bool SipRegistrar::IsSelf(const resip::Uri& uri) const {
+    return uri.host() == self_uri_.host() && uri.port() == self_uri_.port();
+}
+
+bool SipRegistrar::IsLocalDomain(const resip::Uri& uri) const {
+    return !uri.user().empty()
+        && (IsSelf(uri) || uri.host() == MakeData(options_.realm, false));
+}
+
+void SipRegistrar::Send(std::unique_ptr<resip::SipMessage> msg) {
+    if (options_.loss > 0
+        && std::uniform_real_distribution<double>(0, 1)(random_) < options_.loss) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    uint64_t delay_us = static_cast<uint64_t>(options_.delay_ms) * 1000;
+    if (options_.jitter_ms > 0) {
+        delay_us += std::uniform_int_distribution<uint64_t>(
+            0, static_cast<uint64_t>(options_.jitter_ms) * 1000)(random_);
+    }
+
+    if (0 == delay_us) {
+        stack_->send(*msg, this);
+        return;
+    }
+
+    delayed_.emplace(util::MonotonicMicros() + delay_us, std::move(msg));
+}
+
+void SipRegistrar::Respond(const resip::SipMessage& request, int code) {
+    std::unique_ptr<resip::SipMessage> response(resip::Helper::makeResponse(request, code));
+    Send(std::move(response));
+}
+
+void SipRegistrar::FlushDelayed(uint64_t now_us) {
+    while (!delayed_.empty() && delayed_.begin()->first <= now_us) {
+        stack_->send(*delayed_.begin()->second, this);
+        delayed_.erase(delayed_.begin());
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef _RTC_SIP_REGISTRAR_H_INCLUDED
+#define _RTC_SIP_REGISTRAR_H_INCLUDED
+
+#include <atomic>
+#include <map>
+#include <random>
+#include <string>
+
+#include "rutil/ThreadIf.hxx"
+#include "resip/stack/SipStack.hxx"
+#include "resip/stack/SipMessage.hxx"
+#include "resip/stack/TransactionUser.hxx"
+#include "resip/stack/EventStackThread.hxx"
+
+#include "session/interface.h"
+
+namespace rtc_session {
+
+// All SIP processing runs on one worker thread draining the transaction
+// user fifo, the stack runs on its own EventStackThread like SipStack.
+class SipRegistrar : public RegistrarInterface
+                   , public resip::TransactionUser {
+public:
+    explicit SipRegistrar(const RegistrarOptions& options) : options_(options) {}
+    ~SipRegistrar();
+
+    bool Initialize();
+
+    // override
+    const RegistrarOptions& options() const override { return options_; }
+    size_t registered_users() const override;
+    RegistrarStats stats() const override;
+private:
+    const resip::Data& name() const override;
+
+    void Process(int timeout_ms);
+    void OnRequest(std::unique_ptr<resip::SipMessage> request);
+    void OnResponse(std::unique_ptr<resip::SipMessage> response);
+    void OnRegister(const resip::SipMessage& request);
+    void OnCancel(const resip::SipMessage& request);
+    bool Authenticate(const resip::SipMessage& request);
+    bool IsSelf(const resip::Uri& uri) const;
+    bool IsLocalDomain(const resip::Uri& uri) const;
+
+    // Sends now or after the configured delay, unless dropped.
+    void Send(std::unique_ptr<resip::SipMessage> msg);
+    void Respond(const resip::SipMessage& request, int code);
+    void FlushDelayed(uint64_t now_us);
+    void PurgeExpired(uint64_t now_us);
+
+    class WorkerThread : public resip::ThreadIf {
+    public:
+        explicit WorkerThread(SipRegistrar& registrar) : registrar_(registrar) {}
+    private:
+        void thread() override;
+        SipRegistrar& registrar_;
+    };
+
+    struct Binding {
+        resip::NameAddr contact;
+        uint64_t expires_us;
+    };
+
+    RegistrarOptions options_;
+    resip::Uri self_uri_;
+
+    std::unique_ptr<resip::FdPollGrp> poll_grp_;
+    std::unique_ptr<resip::EventThreadInterruptor> interruptor_;
+    std::unique_ptr<resip::SipStack> stack_;
+    std::unique_ptr<resip::EventStackThread> stack_thread_;
+    std::unique_ptr<WorkerThread> worker_;
+
+    // worker thread only
+    std::map<std::string, Binding> bindings_;
+    uint64_t next_purge_us_ = 0;
+    // forwarded INVITEs by the caller's transaction id, to relay CANCEL
+    std::map<resip::Data, std::unique_ptr<resip::SipMessage>> pending_invites_;
+    std::multimap<uint64_t, std::unique_ptr<resip::SipMessage>> delayed_;
+    std::mt19937 random_;
+
+    std::atomic<size_t> registered_users_{ 0 };
+    std::atomic<uint64_t> registrations_{ 0 };
+    std::atomic<uint64_t> challenges_{ 0 };
+    std::atomic<uint64_t> forwarded_requests_{ 0 };
+    std::atomic<uint64_t> forwarded_responses_{ 0 };
+    std::atomic<uint64_t> not_found_{ 0 };
+    std::atomic<uint64_t> dropped_{ 0 };
+};
+}
+
+#endif // !_RTC_SIP_REGISTRAR_H_INCLUDED
@@ -1,27 +1,63 @@
 #include "session/sip_stack.h"
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
 #include "rutil/Lock.hxx"
 
+#include "utility/probes.h"
+#include "utility/tracer.h"
 #include "session/sip_user.h"
 
 using namespace rtc_session;
 
 #define kFD_POLL_GRP_TYPE   "event"
 
+namespace {
+// how often LogoutAll() looks for de-registrations that have completed
+const auto kLogoutPollInterval = std::chrono::milliseconds(5);
+}
+
 void StackThread::Stop() {
     shutdown();
-    afterProcess();
+    while (RunTasks()) {}
     join();
 }
 
+void StackThread::thread() {
+    if (!name_prefix_.empty()) {
+        util::SetCurrentThreadName(name_prefix_ + stats_.name());
+    }
+    util::SetCurrentThreadAffinity(affinity_);
+    util::Tracer::Instance().SetCurrentThreadName(stats_.name());
+
+    stats_.Attach();
+    resip::EventStackThread::thread();
+    stats_.Detach();
+}
+
+// Only posted tasks are timed as tasks, transport and timer processing
+// shows up in the thread's cpu time. Bulk tasks past the budget wait for
+// the next iteration, which the interruptor starts right after this one.
 void StackThread::afterProcess() {
-    TaskInterface *task = nullptr;
-    while (task = tasks_.getNext(-1)) {
-        task->Run();
-        delete task;
+    if (RunTasks()) {
+        interruptor_.handleProcessNotification();
     }
 }
 
+bool StackThread::RunTasks() {
+    bool more = tasks_.Run([this](util::TaskLanes::Task& task, size_t depth) {
+        stats_.PublishQueueDepth(depth);
+        util::ScopedTaskTimer timer(&stats_);
+        RTC_PROBE(stack_task_begin, &task);
+        task.Run();
+        RTC_PROBE(stack_task_end, &task);
+    });
+    stats_.PublishQueueDepth(tasks_.size());
+    return more;
+}
+
 void SipUserManager::AddUser(std::shared_ptr<SipUserContext> user) {
     resip::Lock guard(mu_);
     users_.push_back(user);
@@ -34,6 +70,11 @@ void SipUserManager::RemoveUser(std::shared_ptr<SipUserContext> user) {
     cond_.signal();
 }
 
+std::list<std::shared_ptr<SipUserContext>> SipUserManager::users() {
+    resip::Lock guard(mu_);
+    return users_;
+}
+
 void SipUserManager::WaitAllUsersClosed() {
     resip::Lock guard(mu_);
     while (!users_.empty()) {
@@ -76,6 +117,11 @@ bool SipStack::Initialize() {
         return false;
     }
 
+    stats_handler_ = std::make_unique<StackStatsHandler>(counters_);
+    stack_->setExternalStatsHandler(stats_handler_.get());
+    stack_->setStatisticsInterval(options_.statistics_interval_sec);
+    stack_->statisticsManagerEnabled() = true;
+
     try {
         if (options_.udp_port) {
             stack_->addTransport(resip::UDP, *options_.udp_port);
@@ -88,7 +134,7 @@ bool SipStack::Initialize() {
         return false;
     }
 
-    thread_ = std::make_unique<StackThread>(*stack_, *interruptor_, *poll_grp_);
+    thread_ = std::make_unique<StackThread>(*stack_, *interruptor_, *poll_grp_, options_);
     if (!thread_) {
         return false;
     }
@@ -112,6 +158,86 @@ std::unique_ptr<UserInterface> SipStack::CreateUser(const UserOptions& options,
     return std::make_unique<SipUser>(user_ctx);
 }
 
+std::vector<util::ThreadSnapshot> SipStack::GetThreadStats() const {
+    std::vector<util::ThreadSnapshot> stats;
+    if (thread_) {
+        stats.push_back(thread_->GetThreadStats());
+    }
+
+    if (user_manager_) {
+        for (auto& user : user_manager_->users()) {
+            stats.push_back(user->GetThreadStats());
+        }
+    }
+    return stats;
+}
+
+StackMetrics SipStack::GetMetrics() const {
+    auto load = [](auto& counter) {
+        auto value = counter.load(std::memory_order_relaxed);
+        return value > 0 ? static_cast<uint64_t>(value) : 0;
+    };
+
+    StackMetrics metrics;
+    for (size_t i = 0; i < static_cast<size_t>(UserState::kCount); ++i) {
+        metrics.users[i] = load(counters_.users[i]);
+    }
+    metrics.client_transactions = load(counters_.client_transactions);
+    metrics.server_transactions = load(counters_.server_transactions);
+    metrics.messages_sent = load(counters_.messages_sent);
+    metrics.messages_received = load(counters_.messages_received);
+    metrics.stack_queue_depth = thread_ ? thread_->published_queue_depth() : 0;
+    metrics.dum_queue_depth = load(counters_.dum_queue_depth);
+    return metrics;
+}
+
+LogoutReport SipStack::LogoutAll(size_t batch_size, uint32_t deadline_ms) {
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    auto deadline = start + std::chrono::milliseconds(deadline_ms);
+    batch_size = std::max<size_t>(batch_size, 1);
+
+    LogoutReport report;
+    if (!user_manager_) {
+        return report;
+    }
+
+    auto deregistered = [](const std::shared_ptr<SipUserContext>& user) {
+        return UserState::kDeregistered == user->state();
+    };
+
+    std::vector<std::shared_ptr<SipUserContext>> users;
+    for (auto& user : user_manager_->users()) {
+        if (!deregistered(user)) {
+            users.push_back(std::move(user));
+        }
+    }
+    report.users = users.size();
+
+    // asked to log out and not deregistered yet, the window of the batch;
+    // a user still registering logs out once its registration completes
+    std::vector<std::shared_ptr<SipUserContext>> pending;
+    size_t sent = 0;
+    while (Clock::now() < deadline) {
+        pending.erase(std::remove_if(pending.begin(), pending.end(), deregistered), pending.end());
+        for (; sent < users.size() && pending.size() < batch_size; ++sent) {
+            users[sent]->Logout();
+            pending.push_back(users[sent]);
+        }
+
+        if (pending.empty()) {
+            break;
+        }
+        std::this_thread::sleep_for(kLogoutPollInterval);
+    }
+
+    report.not_sent = users.size() - sent;
+    report.logged_out = std::count_if(users.begin(), users.end(), deregistered);
+    report.elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - start).count();
+    return report;
+}
+
 void SipStack::OnUserDeleted(std::shared_ptr<SipUserContext> user) {
     user_manager_->RemoveUser(user);
 }
\ No newline at end of file
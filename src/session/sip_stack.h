@@ -1,6 +1,7 @@
 #ifndef _RTC_SIP_STACK_H_INCLUDED
 #define _RTC_SIP_STACK_H_INCLUDED
 
+#include <atomic>
 #include <list>
 
 #include "rutil/Fifo.hxx"
@@ -8,51 +9,84 @@
 #include "rutil/Condition.hxx"
 #include "resip/stack/SipStack.hxx"
 #include "resip/stack/EventStackThread.hxx"
+#include "resip/stack/StatisticsHandler.hxx"
+#include "resip/stack/StatisticsMessage.hxx"
 
 #include "utility/callback_wrapper.h"
 #include "utility/invoker.h"
+#include "utility/task_lanes.h"
+#include "utility/thread_stats.h"
 #include "session/interface.h"
 
 namespace rtc_session {
 
 class SipUserContext;
 
+// Updated by the stack's and users' threads, read by SipStack::GetMetrics()
+// from any thread.
+struct SipStackCounters {
+    std::atomic<int64_t> users[static_cast<size_t>(UserState::kCount)] = {};
+    std::atomic<uint64_t> client_transactions{ 0 };
+    std::atomic<uint64_t> server_transactions{ 0 };
+    std::atomic<uint64_t> messages_sent{ 0 };
+    std::atomic<uint64_t> messages_received{ 0 };
+    std::atomic<int64_t> dum_queue_depth{ 0 };
+};
+
+// Keeps the transaction counts of resip's periodic statistics report, run
+// on the stack thread.
+class StackStatsHandler : public resip::ExternalStatsHandler {
+public:
+    explicit StackStatsHandler(SipStackCounters& counters) : counters_(counters) {}
+
+    bool operator()(resip::StatisticsMessage& msg) override {
+        resip::StatisticsMessage::Payload payload;
+        msg.loadOut(payload);
+        counters_.client_transactions.store(payload.activeClientTransactions, std::memory_order_relaxed);
+        counters_.server_transactions.store(payload.activeServerTransactions, std::memory_order_relaxed);
+        // handled, not posted on to the TUs
+        return true;
+    }
+private:
+    SipStackCounters& counters_;
+};
+
 class StackThread : public resip::EventStackThread
                   , public util::Invoker<StackThread> {
 public:
     StackThread(resip::SipStack& stack, 
                 resip::EventThreadInterruptor& si, 
-                resip::FdPollGrp& pollGrp)
+                resip::FdPollGrp& pollGrp,
+                const StackOptions& options)
         : resip::EventStackThread(stack, si, pollGrp)
-        , tasks_(&si) {}
+        , name_prefix_(options.thread_name_prefix)
+        , affinity_(options.thread_affinity)
+        , stats_("sip_stack")
+        , interruptor_(si)
+        , tasks_(options.bulk_task_budget) {}
 
     void Stop();
+    util::ThreadSnapshot GetThreadStats() const { return stats_.GetSnapshot(tasks_.size()); }
+    size_t published_queue_depth() const { return stats_.published_queue_depth(); }
 
     resip::ThreadIf::Id tid() const { return mId; }
     template<typename Fn>
-    void PostImpl(Fn&& fn) {
-        tasks_.add(new FunctionTask<Fn>(std::forward<Fn>(fn)));
+    void PostImpl(Fn&& fn, util::Lane lane) {
+        if (tasks_.Push(std::forward<Fn>(fn), lane)) {
+            interruptor_.handleProcessNotification();
+        }
     }
 private:
+    void thread() override;
     void afterProcess() override;
-
-    class TaskInterface {
-    public:
-        virtual ~TaskInterface() = default;
-        virtual void Run() = 0;
-    };
-
-    template<typename Fn>
-    class FunctionTask : public TaskInterface {
-    public:
-        explicit FunctionTask(Fn&& fn) : fn_(std::forward<Fn>(fn)) {}
-
-    private:
-        void Run() override { fn_(); }
-        Fn fn_;
-    };
-
-    resip::Fifo<TaskInterface> tasks_;
+    // true if bulk tasks are left for the next loop iteration
+    bool RunTasks();
+
+    std::string name_prefix_;
+    uint64_t affinity_;
+    util::ThreadStats stats_;
+    resip::EventThreadInterruptor& interruptor_;
+    util::TaskLanes tasks_;
 };
 
 class SipUserManager final {
@@ -62,6 +96,7 @@ public:
     void AddUser(std::shared_ptr<SipUserContext> user);
     void RemoveUser(std::shared_ptr<SipUserContext> user);
     void WaitAllUsersClosed();
+    std::list<std::shared_ptr<SipUserContext>> users();
 private:
     SipUserManager(const SipUserManager&) = delete;
     SipUserManager& operator=(const SipUserManager&) = delete;
@@ -78,17 +113,23 @@ public:
 
     bool Initialize();
     resip::SipStack& lower_stack() { return *stack_; }
+    SipStackCounters& counters() { return counters_; }
 
     // override
     const StackOptions& options() const override { return options_; }
     std::unique_ptr<UserInterface> CreateUser(
         const UserOptions& options,
         std::shared_ptr<UserCallback> callback) override;
+    std::vector<util::ThreadSnapshot> GetThreadStats() const override;
+    StackMetrics GetMetrics() const override;
+    LogoutReport LogoutAll(size_t batch_size, uint32_t deadline_ms) override;
 private:
     friend class SipUserContext;
     void OnUserDeleted(std::shared_ptr<SipUserContext> user);
 
     StackOptions options_;
+    SipStackCounters counters_;
+    std::unique_ptr<StackStatsHandler> stats_handler_;
     std::unique_ptr<resip::FdPollGrp> poll_grp_;
     std::unique_ptr<resip::EventThreadInterruptor> interruptor_;
     std::unique_ptr<StackThread> thread_;
@@ -62,6 +62,14 @@ bool UpdateRegisterationByRport(const resip::NameAddrs& all_contacts,
     return !contacts->add.empty() && !contacts->del.empty();
 }
 
+// util::Tracer id of a call for probes, kNoTraceId if it is not ours
+const uint64_t kNoTraceId = 0;
+
+template<typename Context>
+uint64_t TraceId(const std::shared_ptr<Context>& ctx) {
+    return ctx ? ctx->trace_id() : kNoTraceId;
+}
+
 bool equal(const resip::Data& data, const std::string& str) {
     if (data.size() != str.size()) {
         return false;
@@ -72,7 +80,19 @@ bool equal(const resip::Data& data, const std::string& str) {
 }
 
 void SipUserContext::DumThreadWrapper::thread() {
+    auto& options = ctx_->stack_.options();
+    if (!options.thread_name_prefix.empty()) {
+        util::SetCurrentThreadName(options.thread_name_prefix + ctx_->stats_.name());
+    }
+    util::SetCurrentThreadAffinity(options.thread_affinity);
+    util::Tracer::Instance().SetCurrentThreadName(ctx_->stats_.name());
+
+    ctx_->stats_.Attach();
     resip::DumThread::thread();
+    ctx_->stats_.Detach();
+
+    ctx_->controller_->Close();
+    ctx_->PublishQueueDepth(0);
     ctx_->stack_.OnUserDeleted(ctx_);
 }
 
@@ -82,7 +102,9 @@ SipUserContext::SipUserContext(const UserOptions& options,
     : resip::DialogUsageManager(stack.lower_stack())
     , options_(options)
     , stack_(stack)
-    , callback_(callback) {
+    , callback_(callback)
+    , stats_("dum:" + options.name)
+    , tasks_(stack.options().bulk_task_budget) {
 }
 
 bool SipUserContext::Initialize() {
@@ -117,16 +139,18 @@ bool SipUserContext::Initialize() {
 
     setClientRegistrationHandler(this);
     setInviteSessionHandler(this);
+    addIncomingFeature(resip::SharedPtr<resip::DumFeature>(new SipAdmissionFeature(*this)));
 
     std::auto_ptr<resip::AppDialogSetFactory> dialog_set_factory(
         new SipDialogSetFactory(shared_from_this()));
     setAppDialogSetFactory(dialog_set_factory);
 
+    // before the thread, which closes it on exit
+    controller_ = std::make_unique<SipUserController>(*this);
+
     thread_.reset(new DumThreadWrapper(shared_from_this()));
     thread_->run();
 
-    controller_ = std::make_unique<SipUserController>(*this);
-
     return true;
 }
 
@@ -138,6 +162,29 @@ void SipUserContext::Shutdown() {
     });
 }
 
+SipStackCounters& SipUserContext::counters() {
+    return stack_.counters();
+}
+
+void SipUserContext::ScheduleTasks() {
+    post(MakeFunctionDumCommand([this] {
+        bool more = tasks_.Run([this](util::TaskLanes::Task& task, size_t depth) {
+            PublishQueueDepth(mFifo.size() + depth);
+            util::ScopedTaskTimer timer(&stats_);
+            task.Run();
+        });
+        if (more) {
+            ScheduleTasks();
+        }
+    }).release());
+}
+
+void SipUserContext::PublishQueueDepth(size_t depth) {
+    auto previous = stats_.PublishQueueDepth(depth);
+    counters().dum_queue_depth.fetch_add(static_cast<int64_t>(depth) - static_cast<int64_t>(previous),
+                                         std::memory_order_relaxed);
+}
+
 void SipUserContext::Login() {
     controller_->Register();
 }
@@ -146,6 +193,10 @@ void SipUserContext::Logout() {
     controller_->Deregister();
 }
 
+UserState SipUserContext::state() const {
+    return controller_->state();
+}
+
 void SipUserContext::SendAddRegMsg() {
     Dispatch([this] {
         send(makeRegistration(GetDomainUserAddr(options_)));
@@ -180,6 +231,44 @@ void SipUserContext::OnCallee(std::unique_ptr<CalleeInterface> callee) {
     callback_(&UserCallback::OnCallee, std::move(callee));
 }
 
+bool SipUserContext::AdmitCallee(const resip::SipMessage& invite) {
+    auto admission = callback_(&UserCallback::OnAdmitCallee,
+                               MakeUserId(invite.header(resip::h_From)));
+    if (!admission || admission->accept) {
+        return true;
+    }
+
+    resip::SharedPtr<resip::SipMessage> response(new resip::SipMessage);
+    makeResponse(*response, invite, 503);
+    if (admission->retry_after_sec) {
+        response->header(resip::h_RetryAfter).value() = admission->retry_after_sec;
+    }
+    send(response);
+    return false;
+}
+
+SipAdmissionFeature::SipAdmissionFeature(SipUserContext& ctx)
+    : resip::DumFeature(ctx, ctx.dumIncomingTarget())
+    , ctx_(ctx) {
+}
+
+resip::DumFeature::ProcessingResult SipAdmissionFeature::process(resip::Message *msg) {
+    // new INVITEs only, an in-dialog one already carries the To tag
+    auto sip = dynamic_cast<resip::SipMessage *>(msg);
+    if (!sip || !sip->isRequest() || resip::INVITE != sip->method()
+        || sip->header(resip::h_To).exists(resip::p_tag)) {
+        return FeatureDone;
+    }
+
+    if (ctx_.AdmitCallee(*sip)) {
+        return FeatureDone;
+    }
+
+    // taken, and answered, so dum never sees it
+    delete msg;
+    return ChainDoneAndEventTaken;
+}
+
 void SipUserContext::onDumCanBeDeleted() {
     thread_->shutdown();
 }
@@ -234,6 +323,7 @@ void SipUserContext::onNewSession(resip::ClientInviteSessionHandle h,
                                   resip::InviteSession::OfferAnswerType oat, 
                                   const resip::SipMessage& msg) {
     auto caller_ctx = GetCallCtxFromHandle<SipCallerContext>(h);
+    RTC_PROBE(sip_invite_callback, "onNewSession", TraceId(caller_ctx));
     if (caller_ctx) {
         caller_ctx->Init(h);
     }
@@ -243,6 +333,7 @@ void SipUserContext::onNewSession(resip::ServerInviteSessionHandle h,
                                   resip::InviteSession::OfferAnswerType oat, 
                                   const resip::SipMessage& msg) {
     auto callee_ctx = GetCallCtxFromHandle<SipCalleeContext>(h);
+    RTC_PROBE(sip_invite_callback, "onNewSession", TraceId(callee_ctx));
     if (callee_ctx) {
         callee_ctx->Init(h);
     }
@@ -251,6 +342,7 @@ void SipUserContext::onNewSession(resip::ServerInviteSessionHandle h,
 void SipUserContext::onFailure(resip::ClientInviteSessionHandle h,
                                const resip::SipMessage& msg) {
     auto caller_ctx = GetCallCtxFromHandle<SipCallerContext>(h);
+    RTC_PROBE(sip_invite_callback, "onFailure", TraceId(caller_ctx));
     if (caller_ctx) {
         caller_ctx->OnFailure();
     }
@@ -259,17 +351,22 @@ void SipUserContext::onFailure(resip::ClientInviteSessionHandle h,
 void SipUserContext::onEarlyMedia(resip::ClientInviteSessionHandle,
                                   const resip::SipMessage&, 
                                   const resip::SdpContents&) {
-
+    RTC_PROBE(sip_invite_callback, "onEarlyMedia", kNoTraceId);
 }
 
-void SipUserContext::onProvisional(resip::ClientInviteSessionHandle,
-                                   const resip::SipMessage&) {
-
+void SipUserContext::onProvisional(resip::ClientInviteSessionHandle h,
+                                   const resip::SipMessage& msg) {
+    auto caller_ctx = GetCallCtxFromHandle<SipCallerContext>(h);
+    RTC_PROBE(sip_invite_callback, "onProvisional", TraceId(caller_ctx));
+    if (caller_ctx) {
+        caller_ctx->OnProvisional(msg.header(resip::h_StatusLine).statusCode());
+    }
 }
 
 void SipUserContext::onConnected(resip::ClientInviteSessionHandle h,
                                  const resip::SipMessage& msg) {
     auto caller_ctx = GetCallCtxFromHandle<SipCallerContext>(h);
+    RTC_PROBE(sip_invite_callback, "onConnected", TraceId(caller_ctx));
     if (caller_ctx) {
         caller_ctx->OnConnected();
     }
@@ -278,6 +375,7 @@ void SipUserContext::onConnected(resip::ClientInviteSessionHandle h,
 void SipUserContext::onConnected(resip::InviteSessionHandle h,
                                  const resip::SipMessage& msg) {
     auto callee_ctx = GetCallCtxFromHandle<SipCalleeContext>(h);
+    RTC_PROBE(sip_invite_callback, "onConnected", TraceId(callee_ctx));
     if (callee_ctx) {
         callee_ctx->OnConnected();
     }
@@ -287,30 +385,36 @@ void SipUserContext::onTerminated(resip::InviteSessionHandle h,
                                   resip::InviteSessionHandler::TerminatedReason reason, 
                                   const resip::SipMessage* related) {
     auto caller_ctx = GetCallCtxFromHandle<SipCallerContext>(h);
+    auto callee_ctx = GetCallCtxFromHandle<SipCalleeContext>(h);
+    RTC_PROBE(sip_invite_callback, "onTerminated",
+              caller_ctx ? caller_ctx->trace_id() : TraceId(callee_ctx));
+
     if (caller_ctx) {
         caller_ctx->OnTerminated();
     }
 
-    auto callee_ctx = GetCallCtxFromHandle<SipCalleeContext>(h);
     if (callee_ctx) {
         callee_ctx->OnTerminated();
     }
 }
 
 void SipUserContext::onForkDestroyed(resip::ClientInviteSessionHandle) {
-
+    RTC_PROBE(sip_invite_callback, "onForkDestroyed", kNoTraceId);
 }
 
 void SipUserContext::onRedirected(resip::ClientInviteSessionHandle,
                                   const resip::SipMessage& msg) {
-
+    RTC_PROBE(sip_invite_callback, "onRedirected", kNoTraceId);
 }
 
 void SipUserContext::onAnswer(resip::InviteSessionHandle h,
                               const resip::SipMessage& msg, 
                               const resip::SdpContents& sdp) {
     auto caller_ctx = GetCallCtxFromHandle<SipCallerContext>(h);
+    RTC_PROBE(sip_invite_callback, "onAnswer", TraceId(caller_ctx));
     if (caller_ctx) {
+        util::ScopedTrace trace(SipCallerContext::kTraceCategory,
+                                "SipUserContext::onAnswer", caller_ctx->trace_id());
         caller_ctx->OnAnswer({ sdp.getBodyData().data(), sdp.getBodyData().size() });
     }
 }
@@ -319,43 +423,51 @@ void SipUserContext::onOffer(resip::InviteSessionHandle h,
                              const resip::SipMessage& msg, 
                              const resip::SdpContents& sdp) {
     auto callee_ctx = GetCallCtxFromHandle<SipCalleeContext>(h);
+    RTC_PROBE(sip_invite_callback, "onOffer", TraceId(callee_ctx));
     if (callee_ctx) {
+        util::ScopedTrace trace(SipCalleeContext::kTraceCategory,
+                                "SipUserContext::onOffer", callee_ctx->trace_id());
         callee_ctx->OnOffer({ sdp.getBodyData().data(), sdp.getBodyData().size() });
     }
 }
 
 void SipUserContext::onOfferRequired(resip::InviteSessionHandle,
                                      const resip::SipMessage& msg) {
-
+    RTC_PROBE(sip_invite_callback, "onOfferRequired", kNoTraceId);
 }
 
 void SipUserContext::onOfferRejected(resip::InviteSessionHandle,
                                      const resip::SipMessage* msg) {
-
+    RTC_PROBE(sip_invite_callback, "onOfferRejected", kNoTraceId);
 }
 
 void SipUserContext::onInfo(resip::InviteSessionHandle, 
                             const resip::SipMessage& msg) {
+    RTC_PROBE(sip_invite_callback, "onInfo", kNoTraceId);
 }
 
 void SipUserContext::onInfoSuccess(resip::InviteSessionHandle,
                                    const resip::SipMessage& msg) {
-
+    RTC_PROBE(sip_invite_callback, "onInfoSuccess", kNoTraceId);
 }
 
 void SipUserContext::onInfoFailure(resip::InviteSessionHandle,
                                    const resip::SipMessage& msg) {
-
+    RTC_PROBE(sip_invite_callback, "onInfoFailure", kNoTraceId);
 }
 
 void SipUserContext::onMessage(resip::InviteSessionHandle h,
                                const resip::SipMessage& msg) {
     auto caller_ctx = GetCallCtxFromHandle<SipCallerContext>(h);
+    auto callee_ctx = GetCallCtxFromHandle<SipCalleeContext>(h);
+    RTC_PROBE(sip_invite_callback, "onMessage",
+              caller_ctx ? caller_ctx->trace_id() : TraceId(callee_ctx));
+    counters().messages_received.fetch_add(1, std::memory_order_relaxed);
+
     if (caller_ctx) {
         caller_ctx->OnMessage(MakeContents(*msg.getContents()));
     }
 
-    auto callee_ctx = GetCallCtxFromHandle<SipCalleeContext>(h);
     if (callee_ctx) {
         callee_ctx->OnMessage(MakeContents(*msg.getContents()));
     }
@@ -364,11 +476,14 @@ void SipUserContext::onMessage(resip::InviteSessionHandle h,
 void SipUserContext::onMessageSuccess(resip::InviteSessionHandle h,
                                       const resip::SipMessage& msg) {
     auto caller_ctx = GetCallCtxFromHandle<SipCallerContext>(h);
+    auto callee_ctx = GetCallCtxFromHandle<SipCalleeContext>(h);
+    RTC_PROBE(sip_invite_callback, "onMessageSuccess",
+              caller_ctx ? caller_ctx->trace_id() : TraceId(callee_ctx));
+
     if (caller_ctx) {
         caller_ctx->OnMessageResult(true);
     }
 
-    auto callee_ctx = GetCallCtxFromHandle<SipCalleeContext>(h);
     if (callee_ctx) {
         callee_ctx->OnMessageResult(true);
     }
@@ -377,11 +492,14 @@ void SipUserContext::onMessageSuccess(resip::InviteSessionHandle h,
 void SipUserContext::onMessageFailure(resip::InviteSessionHandle h,
                                       const resip::SipMessage& msg) {
     auto caller_ctx = GetCallCtxFromHandle<SipCallerContext>(h);
+    auto callee_ctx = GetCallCtxFromHandle<SipCalleeContext>(h);
+    RTC_PROBE(sip_invite_callback, "onMessageFailure",
+              caller_ctx ? caller_ctx->trace_id() : TraceId(callee_ctx));
+
     if (caller_ctx) {
         caller_ctx->OnMessageResult(false);
     }
 
-    auto callee_ctx = GetCallCtxFromHandle<SipCalleeContext>(h);
     if (callee_ctx) {
         callee_ctx->OnMessageResult(false);
     }
@@ -390,23 +508,23 @@ void SipUserContext::onMessageFailure(resip::InviteSessionHandle h,
 void SipUserContext::onRefer(resip::InviteSessionHandle,
                              resip::ServerSubscriptionHandle, 
                              const resip::SipMessage& msg) {
-
+    RTC_PROBE(sip_invite_callback, "onRefer", kNoTraceId);
 }
 
 void SipUserContext::onReferNoSub(resip::InviteSessionHandle,
                                   const resip::SipMessage& msg) {
-
+    RTC_PROBE(sip_invite_callback, "onReferNoSub", kNoTraceId);
 }
 
 void SipUserContext::onReferRejected(resip::InviteSessionHandle,
                                      const resip::SipMessage& msg) {
-
+    RTC_PROBE(sip_invite_callback, "onReferRejected", kNoTraceId);
 }
 
 void SipUserContext::onReferAccepted(resip::InviteSessionHandle,
                                      resip::ClientSubscriptionHandle, 
                                      const resip::SipMessage& msg) {
-
+    RTC_PROBE(sip_invite_callback, "onReferAccepted", kNoTraceId);
 }
 
 const StackInterface *SipUserContext::stack() const {
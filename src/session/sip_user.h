@@ -15,11 +15,15 @@
 
 #include "utility/invoker.h"
 #include "utility/callback_wrapper.h"
+#include "utility/probes.h"
+#include "utility/task_lanes.h"
+#include "utility/thread_stats.h"
 #include "session/interface.h"
 
 namespace rtc_session {
 
 class SipStack;
+struct SipStackCounters;
 class SipUser;
 class SipUserController;
 struct UpdateContacts;
@@ -30,7 +34,9 @@ public:
     explicit FunctionDumCommand(Fn&& fn) : fn_(std::forward<Fn>(fn)) {}
 private:
     void executeCommand() override {
+        RTC_PROBE(dum_command_begin, this);
         fn_();
+        RTC_PROBE(dum_command_end, this);
     }
 
     resip::Message* clone() const override {
@@ -60,6 +66,18 @@ decltype(auto) MakeFunctionDumCommand(Fn&& fn) {
     return std::make_unique<FunctionDumCommand<Fn>>(std::forward<Fn>(fn));
 }
 
+class SipUserContext;
+
+// First in line for every incoming transaction, so an INVITE the user turns
+// away is answered before dum builds a dialog set for it, let alone a call.
+class SipAdmissionFeature : public resip::DumFeature {
+public:
+    explicit SipAdmissionFeature(SipUserContext& ctx);
+    ProcessingResult process(resip::Message *msg) override;
+private:
+    SipUserContext& ctx_;
+};
+
 class SipUserContext : public resip::DialogUsageManager
                      , public resip::ClientRegistrationHandler
                      , public resip::InviteSessionHandler
@@ -74,17 +92,29 @@ public:
     void Shutdown();
 
     const StackInterface *stack() const;
+    SipStackCounters& counters();
     const UserOptions& options() const { return options_; }
+    // queue depth counts sip messages and posted tasks alike
+    util::ThreadSnapshot GetThreadStats() const {
+        return stats_.GetSnapshot(mFifo.size() + tasks_.size());
+    }
     void Login();
     void Logout();
+    UserState state() const;
 
-    // impl dum's invoker
+    // impl dum's invoker; posted tasks wait in lanes of their own and are
+    // run by one dum command at a time, which goes to the back of dum's
+    // fifo again while bulk tasks are left, behind the sip messages
     resip::ThreadIf::Id tid() const { return thread_->id(); }
     template<typename Fn>
-    void PostImpl(Fn&& fn) {
-        post(MakeFunctionDumCommand(std::forward<Fn>(fn)).release());
+    void PostImpl(Fn&& fn, util::Lane lane) {
+        if (tasks_.Push(std::forward<Fn>(fn), lane)) {
+            ScheduleTasks();
+        }
     }
 private:
+    void ScheduleTasks();
+
     friend class SipUserRegisteringState;
     friend class SipUserRegisteredState;
     friend class SipUserDeregisteringState;
@@ -92,6 +122,9 @@ private:
     friend class SipUserUpdatingState;
     friend class SipDialogSetFactory;
 
+    // into stats_ and the stack's sum over users
+    void PublishQueueDepth(size_t depth);
+
     void SendAddRegMsg();
     void SendEndRegMsg();
     void SendUpdateRegMsg(const UpdateContacts& contacts);
@@ -99,6 +132,10 @@ private:
     friend class SipDialogSetFactory;
     void OnCallee(std::unique_ptr<CalleeInterface> callee);
 
+    // false once a new INVITE has been answered 503 in place of dum
+    friend class SipAdmissionFeature;
+    bool AdmitCallee(const resip::SipMessage& invite);
+
     void onDumCanBeDeleted() override;
 
     // client registeration handler
@@ -249,6 +286,8 @@ private:
     std::unique_ptr<DumThreadWrapper> thread_;
     std::unique_ptr<SipUserController> controller_;
     resip::ClientRegistrationHandle client_registeration_handle_;
+    util::ThreadStats stats_;
+    util::TaskLanes tasks_;
 };
 
 class SipUser : public UserInterface {
@@ -1,11 +1,38 @@
 #include "session/sip_user_state.h"
 #include "session/sip_user.h"
+#include "session/sip_stack.h"
 
 using namespace rtc_session;
 
 SipUserController::SipUserController(SipUserContext& ctx)
     : ctx_(ctx)
     , state_(&SipUserDeregisteredState::Instance()){
+    CountState(UserState::kCount, state_->id());
+}
+
+void SipUserController::Close() {
+    resip::Lock guard(mu_);
+    if (!closed_) {
+        CountState(state_->id(), UserState::kCount);
+        closed_ = true;
+    }
+}
+
+// Moves the user between the stack's per state gauges, kCount is neither.
+void SipUserController::CountState(UserState from, UserState to) {
+    auto& users = ctx_.counters().users;
+    if (UserState::kCount != from) {
+        users[static_cast<size_t>(from)].fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    if (UserState::kCount != to) {
+        users[static_cast<size_t>(to)].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+UserState SipUserController::state() const {
+    resip::Lock guard(mu_);
+    return state_->id();
 }
 
 void SipUserController::Register() {
@@ -8,6 +8,7 @@
 #include "resip/stack/NameAddr.hxx"
 
 #include "utility/singleton.h"
+#include "session/interface.h"
 
 namespace rtc_session {
 
@@ -31,6 +32,7 @@ public:
     virtual void OnRegFailure(SipUserController *) = 0;
     virtual void OnRegRemoved(SipUserController *) = 0;
     virtual const char *name() const = 0;
+    virtual UserState id() const = 0;
 };
 
 class SipUserController {
@@ -43,6 +45,9 @@ public:
     bool OnRegSuccess();
     void OnRegFailure();
     void OnRegRemoved();
+    UserState state() const;
+    // takes the user out of the stack's metrics, once its dum thread is done
+    void Close();
 private:
     friend class SipUserDeregisteredState;
     friend class SipUserRegisteringState;
@@ -53,15 +58,20 @@ private:
     void set_state(SipUserStateInterface &state) { 
         std::clog << "set user state:" 
             << state_->name() << "->" << state.name() << std::endl;
+        if (!closed_) {
+            CountState(state_->id(), state.id());
+        }
         state_ = &state;
     }
     template<typename S>
     void set_state() { set_state(S::Instance()); }
+    void CountState(UserState from, UserState to);
 
     mutable resip::RecursiveMutex mu_;
     SipUserContext& ctx_ ;
     SipUserStateInterface *state_ = nullptr;
     bool regist_op_ = false;
+    bool closed_ = false;
 };
 
 template<typename T>
@@ -80,6 +90,7 @@ class SipUserDeregisteredState : public SipUserState<SipUserDeregisteredState> {
 private:
     void DoRegisteration(SipUserController *controller) override;
     const char *name() const override { return "Deregistered";  }
+    UserState id() const override { return UserState::kDeregistered; }
 };
 
 class SipUserRegisteringState : public SipUserState<SipUserRegisteringState> {
@@ -87,6 +98,7 @@ private:
     bool OnRegSuccess(SipUserController *controller) override;
     void OnRegFailure(SipUserController *controller) override;
     const char *name() const override { return "Registering"; }
+    UserState id() const override { return UserState::kRegistering; }
 };
 
 class SipUserRegisteredState : public SipUserState<SipUserRegisteredState> {
@@ -96,12 +108,14 @@ private:
     bool OnRegSuccess(SipUserController *controller) override;
     void OnRegFailure(SipUserController *controller) override;
     const char *name() const override { return "Registered"; }
+    UserState id() const override { return UserState::kRegistered; }
 };
 
 class SipUserDeregisteringState : public SipUserState<SipUserDeregisteringState> {
 private:
     void OnRegRemoved(SipUserController *controller) override;
     const char *name() const override { return "Deregistering"; }
+    UserState id() const override { return UserState::kDeregistering; }
 };
 
 class SipUserUpdatingState : public SipUserState<SipUserUpdatingState> {
@@ -109,6 +123,7 @@ private:
     bool OnRegSuccess(SipUserController *controller) override;
     void OnRegFailure(SipUserController *controller) override;
     const char *name() const override { return "Updating"; }
+    UserState id() const override { return UserState::kUpdating; }
 };
 }
 
@@ -0,0 +1,283 @@
+#ifndef _RTC_CORO_H_INCLUDED
+#define _RTC_CORO_H_INCLUDED
+
+// C++20 coroutine helpers, empty for compilers without coroutines.
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "utility/executor.h"
+
+#define RTC_HAS_COROUTINES 1
+
+namespace util {
+
+template<typename T>
+class Task;
+
+namespace detail {
+
+struct TaskPromiseBase {
+    // resumes whoever awaits the task once it finishes
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+            auto continuation = h.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+
+    // the engine does not throw, neither may its coroutines
+    void unhandled_exception() const noexcept { std::terminate(); }
+
+    std::coroutine_handle<> continuation;
+};
+
+template<typename T>
+struct TaskPromise : TaskPromiseBase {
+    Task<T> get_return_object();
+
+    template<typename U>
+    void return_value(U&& value) { value_.emplace(std::forward<U>(value)); }
+
+    T result() { return std::move(*value_); }
+
+    std::optional<T> value_;
+};
+
+template<>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object();
+    void return_void() const noexcept {}
+    void result() const noexcept {}
+};
+}
+
+// Lazily started coroutine: the body runs once the task is awaited, and
+// the awaiter resumes on the thread that finishes it. Start a top level
+// one with Spawn().
+template<typename T = void>
+class Task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+
+    Task(Task&& other) noexcept : h_(std::exchange(other.h_, nullptr)) {}
+
+    ~Task() {
+        if (h_) {
+            h_.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+        h_.promise().continuation = awaiter;
+        return h_;
+    }
+
+    T await_resume() { return h_.promise().result(); }
+private:
+    friend promise_type;
+
+    explicit Task(std::coroutine_handle<promise_type> h) : h_(h) {}
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    std::coroutine_handle<promise_type> h_;
+};
+
+namespace detail {
+
+template<typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>{ std::coroutine_handle<TaskPromise<T>>::from_promise(*this) };
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>{ std::coroutine_handle<TaskPromise<void>>::from_promise(*this) };
+}
+
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+}
+
+// Runs task up to its first suspension on the calling thread; it frees
+// itself when it finishes.
+inline detail::DetachedTask Spawn(Task<void> task) {
+    co_await std::move(task);
+}
+
+// co_await ResumeOn(executor) continues the coroutine as a task of executor.
+inline auto ResumeOn(Executor *executor) {
+    struct Awaiter {
+        Executor *executor;
+
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> h) const {
+            executor->Post([h] { h.resume(); });
+        }
+
+        void await_resume() const noexcept {}
+    };
+    return Awaiter{ executor };
+}
+
+// A value set once from any thread, awaited by one coroutine at a time.
+// Copies share the value. The awaiter resumes on executor, or on the
+// setting thread when it is null; awaiting after Set() does not suspend.
+template<typename T>
+class AsyncResult {
+public:
+    explicit AsyncResult(Executor *executor = nullptr)
+        : state_(std::make_shared<State>()) {
+        state_->executor = executor;
+    }
+
+    // the first value wins
+    void Set(T value) const {
+        std::coroutine_handle<> waiter;
+        {
+            std::lock_guard<std::mutex> guard(state_->mu);
+            if (state_->value) {
+                return;
+            }
+            state_->value.emplace(std::move(value));
+            waiter = std::exchange(state_->waiter, nullptr);
+        }
+        Resume(waiter);
+    }
+
+    auto operator co_await() const {
+        struct Awaiter {
+            std::shared_ptr<State> state;
+
+            bool await_ready() const {
+                std::lock_guard<std::mutex> guard(state->mu);
+                return state->value.has_value();
+            }
+
+            bool await_suspend(std::coroutine_handle<> h) const {
+                std::lock_guard<std::mutex> guard(state->mu);
+                if (state->value) {
+                    return false;
+                }
+                state->waiter = h;
+                return true;
+            }
+
+            T await_resume() const {
+                std::lock_guard<std::mutex> guard(state->mu);
+                return *state->value;
+            }
+        };
+        return Awaiter{ state_ };
+    }
+private:
+    struct State {
+        std::mutex mu;
+        std::optional<T> value;
+        std::coroutine_handle<> waiter;
+        Executor *executor = nullptr;
+    };
+
+    void Resume(std::coroutine_handle<> waiter) const {
+        if (!waiter) {
+            return;
+        }
+
+        if (state_->executor) {
+            state_->executor->Post([waiter] { waiter.resume(); });
+        } else {
+            waiter.resume();
+        }
+    }
+
+    std::shared_ptr<State> state_;
+};
+
+// Values pushed from any thread, popped in order by one coroutine at a
+// time; resumes like AsyncResult.
+template<typename T>
+class AsyncQueue {
+public:
+    explicit AsyncQueue(Executor *executor = nullptr) : executor_(executor) {}
+
+    void Push(T value) {
+        std::coroutine_handle<> waiter;
+        {
+            std::lock_guard<std::mutex> guard(mu_);
+            values_.push_back(std::move(value));
+            waiter = std::exchange(waiter_, nullptr);
+        }
+
+        if (!waiter) {
+            return;
+        }
+
+        if (executor_) {
+            executor_->Post([waiter] { waiter.resume(); });
+        } else {
+            waiter.resume();
+        }
+    }
+
+    auto Pop() {
+        struct Awaiter {
+            AsyncQueue *queue;
+
+            bool await_ready() const {
+                std::lock_guard<std::mutex> guard(queue->mu_);
+                return !queue->values_.empty();
+            }
+
+            bool await_suspend(std::coroutine_handle<> h) const {
+                std::lock_guard<std::mutex> guard(queue->mu_);
+                if (!queue->values_.empty()) {
+                    return false;
+                }
+                queue->waiter_ = h;
+                return true;
+            }
+
+            T await_resume() const {
+                std::lock_guard<std::mutex> guard(queue->mu_);
+                auto value = std::move(queue->values_.front());
+                queue->values_.pop_front();
+                return value;
+            }
+        };
+        return Awaiter{ this };
+    }
+private:
+    Executor *executor_;
+    std::mutex mu_;
+    std::deque<T> values_;
+    std::coroutine_handle<> waiter_;
+};
+}
+
+#endif
+
+#endif // !_RTC_CORO_H_INCLUDED
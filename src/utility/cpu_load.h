@@ -0,0 +1,86 @@
+#ifndef _RTC_CPU_LOAD_H_INCLUDED
+#define _RTC_CPU_LOAD_H_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#ifdef WEBRTC_WIN
+#include <winsock2.h>
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "utility/histogram.h"
+
+namespace util {
+
+// user plus system time of every thread of the process
+inline uint64_t ProcessCpuMicros() {
+#ifdef WEBRTC_WIN
+    FILETIME creation, exit, kernel, user;
+    if (!::GetProcessTimes(::GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return 0;
+    }
+    auto to_us = [](const FILETIME& t) {
+        return ((static_cast<uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime) / 10;
+    };
+    return to_us(kernel) + to_us(user);
+#else
+    rusage usage{};
+    if (0 != ::getrusage(RUSAGE_SELF, &usage)) {
+        return 0;
+    }
+    auto to_us = [](const timeval& t) {
+        return static_cast<uint64_t>(t.tv_sec) * 1000000 + static_cast<uint64_t>(t.tv_usec);
+    };
+    return to_us(usage.ru_utime) + to_us(usage.ru_stime);
+#endif
+}
+
+// Process cpu time over the last period, as a percentage of all cores.
+// Read from any thread: the first reader to find the sample a period old
+// takes the next one, the others get the last without waiting. 0 until a
+// full period has passed.
+class ProcessCpuLoad {
+public:
+    explicit ProcessCpuLoad(uint64_t period_us = 1000000)
+        : period_us_(period_us)
+        , cores_(std::max(1u, std::thread::hardware_concurrency())) {}
+
+    double percent() {
+        auto now = MonotonicMicros();
+        if (now - sampled_us_.load(std::memory_order_relaxed) >= period_us_) {
+            std::unique_lock<std::mutex> lock(mu_, std::try_to_lock);
+            if (lock.owns_lock() && now - sampled_us_.load(std::memory_order_relaxed) >= period_us_) {
+                Sample(now);
+            }
+        }
+        return percent_.load(std::memory_order_relaxed);
+    }
+private:
+    void Sample(uint64_t now) {
+        auto cpu_us = ProcessCpuMicros();
+        auto wall_us = now - sampled_us_.load(std::memory_order_relaxed);
+        if (last_cpu_us_ && cpu_us >= last_cpu_us_ && wall_us) {
+            percent_.store(100.0 * (cpu_us - last_cpu_us_) / (static_cast<double>(wall_us) * cores_),
+                           std::memory_order_relaxed);
+        }
+        last_cpu_us_ = cpu_us;
+        sampled_us_.store(now, std::memory_order_relaxed);
+    }
+
+    const uint64_t period_us_;
+    const unsigned cores_;
+    std::atomic<uint64_t> sampled_us_{ 0 };
+    std::atomic<double> percent_{ 0 };
+
+    std::mutex mu_;
+    uint64_t last_cpu_us_ = 0;
+};
+}
+
+#endif // !_RTC_CPU_LOAD_H_INCLUDED
@@ -0,0 +1,476 @@
+#ifndef _RTC_EXECUTOR_H_INCLUDED
+#define _RTC_EXECUTOR_H_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifndef WEBRTC_WIN
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+#endif
+
+#include "utility/histogram.h"
+#include "utility/thread_stats.h"
+
+namespace util {
+
+struct ExecutorSnapshot {
+    uint64_t tasks = 0;
+    // wakeups that ran at least one task, and the most tasks one ran
+    uint64_t batches = 0;
+    uint64_t max_batch = 0;
+    size_t queue_depth = 0;
+    size_t max_queue_depth = 0;
+    // from Post() to the task starting, and the task itself
+    Histogram::Snapshot latency_us;
+    Histogram::Snapshot run_us;
+};
+
+// Where observer callbacks run. Post() may be called from any thread.
+class Executor {
+public:
+    using Task = std::function<void()>;
+
+    virtual ~Executor() = default;
+    virtual void Post(Task task) = 0;
+    virtual ExecutorSnapshot GetSnapshot() const = 0;
+};
+
+// Runs each task within Post(), on the posting thread. Tasks posted from
+// different threads are not ordered against each other.
+class InlineExecutor : public Executor {
+public:
+    void Post(Task task) override {
+        tasks_.fetch_add(1, std::memory_order_relaxed);
+        ScopedHistogramTimer timer(&run_us_);
+        task();
+    }
+
+    ExecutorSnapshot GetSnapshot() const override {
+        ExecutorSnapshot s;
+        s.tasks = tasks_.load(std::memory_order_relaxed);
+        s.batches = s.tasks;
+        s.max_batch = s.tasks ? 1 : 0;
+        s.run_us = run_us_.GetSnapshot();
+        return s;
+    }
+private:
+    std::atomic<uint64_t> tasks_{ 0 };
+    Histogram run_us_;
+};
+
+// Queues tasks and runs them one at a time in post order. A wakeup takes
+// everything queued so far as one batch, so a burst of events costs one
+// wakeup of the consumer rather than one each. Subclasses provide the
+// wakeup; at most one is outstanding at any time.
+class BatchingExecutor : public Executor {
+public:
+    void Post(Task task) override {
+        bool wake = false;
+        {
+            std::lock_guard<std::mutex> guard(mu_);
+            queue_.push_back({ MonotonicMicros(), std::move(task) });
+            max_queue_depth_ = std::max(max_queue_depth_, queue_.size());
+            queue_depth_.store(queue_.size(), std::memory_order_relaxed);
+            if (!scheduled_) {
+                scheduled_ = true;
+                wake = true;
+            }
+        }
+
+        if (wake) {
+            Wake();
+        }
+    }
+
+    ExecutorSnapshot GetSnapshot() const override {
+        ExecutorSnapshot s;
+        s.tasks = tasks_.load(std::memory_order_relaxed);
+        s.batches = batches_.load(std::memory_order_relaxed);
+        s.max_batch = max_batch_.load(std::memory_order_relaxed);
+        s.queue_depth = queue_depth_.load(std::memory_order_relaxed);
+        s.latency_us = latency_us_.GetSnapshot();
+        s.run_us = run_us_.GetSnapshot();
+
+        std::lock_guard<std::mutex> guard(mu_);
+        s.max_queue_depth = max_queue_depth_;
+        return s;
+    }
+protected:
+    // arrange for RunBatch() to be called once, on the consuming thread
+    virtual void Wake() = 0;
+
+    // Runs the tasks queued so far, then wakes again if more were posted
+    // meanwhile. Returns the number of tasks run.
+    size_t RunBatch() {
+        std::deque<Entry> batch;
+        {
+            std::lock_guard<std::mutex> guard(mu_);
+            batch.swap(queue_);
+            queue_depth_.store(0, std::memory_order_relaxed);
+        }
+
+        for (auto& entry : batch) {
+            latency_us_.Add(MonotonicMicros() - entry.posted_us);
+            ScopedHistogramTimer timer(&run_us_);
+            entry.task();
+        }
+
+        if (!batch.empty()) {
+            tasks_.fetch_add(batch.size(), std::memory_order_relaxed);
+            batches_.fetch_add(1, std::memory_order_relaxed);
+            auto max = max_batch_.load(std::memory_order_relaxed);
+            while (batch.size() > max
+                && !max_batch_.compare_exchange_weak(max, batch.size(), std::memory_order_relaxed));
+        }
+
+        bool wake = false;
+        {
+            std::lock_guard<std::mutex> guard(mu_);
+            wake = !queue_.empty();
+            scheduled_ = wake;
+        }
+
+        if (wake) {
+            Wake();
+        }
+        return batch.size();
+    }
+private:
+    struct Entry {
+        uint64_t posted_us;
+        Task task;
+    };
+
+    mutable std::mutex mu_;
+    std::deque<Entry> queue_;
+    bool scheduled_ = false;
+    size_t max_queue_depth_ = 0;
+
+    std::atomic<size_t> queue_depth_{ 0 };
+    std::atomic<uint64_t> tasks_{ 0 };
+    std::atomic<uint64_t> batches_{ 0 };
+    std::atomic<uint64_t> max_batch_{ 0 };
+    Histogram latency_us_;
+    Histogram run_us_;
+};
+
+// A thread of its own for the application's callbacks. Tasks still queued
+// when the last reference is dropped run before the thread exits. If one of
+// its own tasks drops it, the thread is detached and deletes the executor
+// once it has run them.
+class ThreadExecutor : public BatchingExecutor {
+public:
+    static std::shared_ptr<ThreadExecutor> Create(const std::string& name) {
+        auto raw = new ThreadExecutor(name);
+        raw->thread_ = std::thread([raw] { raw->Run(); });
+        return std::shared_ptr<ThreadExecutor>(raw, [](ThreadExecutor *executor) {
+            executor->Shutdown();
+        });
+    }
+
+    ThreadSnapshot GetThreadSnapshot() const {
+        return stats_.GetSnapshot(GetSnapshot().queue_depth);
+    }
+private:
+    explicit ThreadExecutor(const std::string& name) : stats_(name) {}
+    ~ThreadExecutor() override = default;
+
+    void Shutdown() {
+        bool own_thread = std::this_thread::get_id() == thread_.get_id();
+        {
+            std::lock_guard<std::mutex> guard(mu_);
+            stop_ = true;
+            self_delete_ = own_thread;
+        }
+        cv_.notify_one();
+
+        if (own_thread) {
+            thread_.detach();
+            return;
+        }
+        thread_.join();
+        delete this;
+    }
+
+    void Wake() override {
+        {
+            std::lock_guard<std::mutex> guard(mu_);
+            woken_ = true;
+        }
+        cv_.notify_one();
+    }
+
+    void Run() {
+        SetCurrentThreadName(stats_.name());
+        stats_.Attach();
+
+        bool self_delete = false;
+        for (;;) {
+            bool stop = false;
+            {
+                std::unique_lock<std::mutex> lock(mu_);
+                cv_.wait(lock, [this] { return woken_ || stop_; });
+                stop = stop_ && !woken_;
+                self_delete = self_delete_;
+                woken_ = false;
+            }
+
+            if (stop) {
+                break;
+            }
+
+            ScopedTaskTimer timer(&stats_);
+            RunBatch();
+        }
+
+        stats_.Detach();
+        if (self_delete) {
+            delete this;
+        }
+    }
+
+    ThreadStats stats_;
+    std::thread thread_;
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    bool woken_ = false;
+    bool stop_ = false;
+    bool self_delete_ = false;
+};
+
+// Delivers through the application's own queue, e.g. a ui loop's post
+// function. post is called once per batch rather than once per task, and
+// never again after the executor is gone.
+class QueueExecutor : public BatchingExecutor
+                    , public std::enable_shared_from_this<QueueExecutor> {
+public:
+    using PostFn = std::function<void(Task)>;
+
+    static std::shared_ptr<QueueExecutor> Create(PostFn post) {
+        if (!post) {
+            return nullptr;
+        }
+        return std::shared_ptr<QueueExecutor>(new QueueExecutor(std::move(post)));
+    }
+private:
+    explicit QueueExecutor(PostFn post) : post_(std::move(post)) {}
+
+    void Wake() override {
+        std::weak_ptr<QueueExecutor> weak_self = shared_from_this();
+        post_([weak_self] {
+            if (auto self = weak_self.lock()) {
+                self->RunBatch();
+            }
+        });
+    }
+
+    PostFn post_;
+};
+
+// For applications with an event loop of their own: Post() pushes onto a
+// lock-free stack and makes handle() readable, the loop then calls Drain()
+// on its thread. The engine threads never take a lock or wait for the
+// application, and the application needs no locks against them.
+class PollableExecutor : public Executor {
+public:
+#ifdef WEBRTC_WIN
+    // manual reset event, signaled while tasks are pending
+    using NativeHandle = HANDLE;
+#else
+    // eventfd on linux and a pipe elsewhere, readable while tasks are pending
+    using NativeHandle = int;
+#endif
+
+    static std::shared_ptr<PollableExecutor> Create() {
+        std::shared_ptr<PollableExecutor> executor(new PollableExecutor);
+        if (!executor->Initialize()) {
+            return nullptr;
+        }
+        return executor;
+    }
+
+    ~PollableExecutor() override {
+        auto node = head_.exchange(nullptr, std::memory_order_acquire);
+        while (node) {
+            auto next = node->next;
+            delete node;
+            node = next;
+        }
+#ifdef WEBRTC_WIN
+        if (event_) {
+            ::CloseHandle(event_);
+        }
+#else
+        if (-1 != read_fd_) {
+            ::close(read_fd_);
+        }
+        if (-1 != write_fd_ && write_fd_ != read_fd_) {
+            ::close(write_fd_);
+        }
+#endif
+    }
+
+    NativeHandle handle() const {
+#ifdef WEBRTC_WIN
+        return event_;
+#else
+        return read_fd_;
+#endif
+    }
+
+    void Post(Task task) override {
+        // counted first so Drain() never takes it below zero
+        auto depth = queue_depth_.fetch_add(1, std::memory_order_relaxed) + 1;
+        auto max = max_queue_depth_.load(std::memory_order_relaxed);
+        while (depth > max
+            && !max_queue_depth_.compare_exchange_weak(max, depth, std::memory_order_relaxed));
+
+        // sequentially consistent with Drain(): a push that finds signaled_
+        // still set is taken by the drain that clears it
+        auto node = new Node{ MonotonicMicros(), std::move(task), head_.load(std::memory_order_relaxed) };
+        while (!head_.compare_exchange_weak(node->next, node));
+
+        // one signal per drain, however many tasks are posted meanwhile
+        if (!signaled_.exchange(true)) {
+            Signal();
+        }
+    }
+
+    // Runs every task posted so far, in post order, on the calling thread.
+    // Call when handle() is readable; a spurious call just returns 0.
+    size_t Drain() {
+        // cleared before taking the tasks, so a Post() after the take
+        // signals again and none is left behind unsignaled
+        Unsignal();
+        signaled_.store(false);
+
+        // the stack is newest first
+        Node *batch = nullptr;
+        auto node = head_.exchange(nullptr);
+        while (node) {
+            auto next = node->next;
+            node->next = batch;
+            batch = node;
+            node = next;
+        }
+
+        size_t count = 0;
+        while (batch) {
+            std::unique_ptr<Node> current(batch);
+            batch = current->next;
+            queue_depth_.fetch_sub(1, std::memory_order_relaxed);
+
+            latency_us_.Add(MonotonicMicros() - current->posted_us);
+            ScopedHistogramTimer timer(&run_us_);
+            current->task();
+            ++count;
+        }
+
+        if (count) {
+            tasks_.fetch_add(count, std::memory_order_relaxed);
+            batches_.fetch_add(1, std::memory_order_relaxed);
+            auto max = max_batch_.load(std::memory_order_relaxed);
+            while (count > max
+                && !max_batch_.compare_exchange_weak(max, count, std::memory_order_relaxed));
+        }
+        return count;
+    }
+
+    ExecutorSnapshot GetSnapshot() const override {
+        ExecutorSnapshot s;
+        s.tasks = tasks_.load(std::memory_order_relaxed);
+        s.batches = batches_.load(std::memory_order_relaxed);
+        s.max_batch = max_batch_.load(std::memory_order_relaxed);
+        s.queue_depth = queue_depth_.load(std::memory_order_relaxed);
+        s.max_queue_depth = max_queue_depth_.load(std::memory_order_relaxed);
+        s.latency_us = latency_us_.GetSnapshot();
+        s.run_us = run_us_.GetSnapshot();
+        return s;
+    }
+private:
+    struct Node {
+        uint64_t posted_us;
+        Task task;
+        Node *next;
+    };
+
+    PollableExecutor() = default;
+
+    bool Initialize() {
+#ifdef WEBRTC_WIN
+        event_ = ::CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        return nullptr != event_;
+#elif defined(__linux__)
+        read_fd_ = write_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        return -1 != read_fd_;
+#else
+        int fds[2];
+        if (0 != ::pipe(fds)) {
+            return false;
+        }
+        read_fd_ = fds[0];
+        write_fd_ = fds[1];
+        for (auto fd : fds) {
+            ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+            ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+        return true;
+#endif
+    }
+
+    void Signal() {
+#ifdef WEBRTC_WIN
+        ::SetEvent(event_);
+#elif defined(__linux__)
+        uint64_t one = 1;
+        (void)::write(write_fd_, &one, sizeof(one));
+#else
+        char one = 1;
+        (void)::write(write_fd_, &one, sizeof(one));
+#endif
+    }
+
+    void Unsignal() {
+#ifdef WEBRTC_WIN
+        ::ResetEvent(event_);
+#elif defined(__linux__)
+        uint64_t count;
+        (void)::read(read_fd_, &count, sizeof(count));
+#else
+        char buffer[64];
+        while (::read(read_fd_, buffer, sizeof(buffer)) > 0);
+#endif
+    }
+
+    std::atomic<Node *> head_{ nullptr };
+    std::atomic<bool> signaled_{ false };
+#ifdef WEBRTC_WIN
+    HANDLE event_ = nullptr;
+#else
+    int read_fd_ = -1;
+    int write_fd_ = -1;
+#endif
+
+    std::atomic<size_t> queue_depth_{ 0 };
+    std::atomic<size_t> max_queue_depth_{ 0 };
+    std::atomic<uint64_t> tasks_{ 0 };
+    std::atomic<uint64_t> batches_{ 0 };
+    std::atomic<uint64_t> max_batch_{ 0 };
+    Histogram latency_us_;
+    Histogram run_us_;
+};
+}
+
+#endif // !_RTC_EXECUTOR_H_INCLUDED
@@ -0,0 +1,153 @@
+#ifndef _RTC_HISTOGRAM_H_INCLUDED
+#define _RTC_HISTOGRAM_H_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace util {
+
+inline uint64_t MonotonicMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Lock-free histogram of non-negative samples. Buckets are log2 with
+// kSubBuckets linear steps per power of two, so percentiles have at most
+// 1/kSubBuckets relative error. Add() may be called from any thread.
+class Histogram {
+public:
+    static constexpr int kSubBucketBits = 2;
+    static constexpr int kSubBuckets = 1 << kSubBucketBits;
+    static constexpr int kBuckets = 64 * kSubBuckets;
+
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+        uint64_t buckets[kBuckets] = {};
+
+        double mean() const {
+            return count ? static_cast<double>(sum) / count : 0.0;
+        }
+
+        // combines histograms of the same quantity, e.g. one per sink
+        void Merge(const Snapshot& other) {
+            count += other.count;
+            sum += other.sum;
+            max = max > other.max ? max : other.max;
+            for (int i = 0; i < kBuckets; ++i) {
+                buckets[i] += other.buckets[i];
+            }
+        }
+
+        // p in [0, 100], returns the upper bound of the matching bucket
+        uint64_t Percentile(double p) const {
+            if (0 == count) {
+                return 0;
+            }
+
+            auto rank = static_cast<uint64_t>(p / 100.0 * count);
+            if (rank >= count) {
+                rank = count - 1;
+            }
+
+            uint64_t seen = 0;
+            for (int i = 0; i < kBuckets; ++i) {
+                seen += buckets[i];
+                if (seen > rank) {
+                    auto upper = BucketUpperBound(i);
+                    return upper < max ? upper : max;
+                }
+            }
+            return max;
+        }
+    };
+
+    Histogram() = default;
+
+    void Add(uint64_t value) {
+        buckets_[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+
+        auto max = max_.load(std::memory_order_relaxed);
+        while (value > max
+            && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed));
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+
+    Snapshot GetSnapshot() const {
+        Snapshot s;
+        s.count = count_.load(std::memory_order_relaxed);
+        s.sum = sum_.load(std::memory_order_relaxed);
+        s.max = max_.load(std::memory_order_relaxed);
+        for (int i = 0; i < kBuckets; ++i) {
+            s.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        }
+        return s;
+    }
+
+    void Reset() {
+        for (auto& bucket : buckets_) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        count_.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+    static int BucketIndex(uint64_t value) {
+        if (value < kSubBuckets) {
+            return static_cast<int>(value);
+        }
+
+        int msb = 63;
+        while (!(value >> msb)) {
+            --msb;
+        }
+
+        int shift = msb - kSubBucketBits;
+        int sub = static_cast<int>((value >> shift) & (kSubBuckets - 1));
+        return (shift + 1) * kSubBuckets + sub;
+    }
+
+    static uint64_t BucketUpperBound(int index) {
+        if (index < kSubBuckets) {
+            return index;
+        }
+
+        int shift = index / kSubBuckets - 1;
+        uint64_t sub = index % kSubBuckets;
+        return ((kSubBuckets + sub + 1) << shift) - 1;
+    }
+private:
+    Histogram(const Histogram&) = delete;
+    Histogram& operator=(const Histogram&) = delete;
+
+    std::atomic<uint64_t> buckets_[kBuckets] = {};
+    std::atomic<uint64_t> count_{ 0 };
+    std::atomic<uint64_t> sum_{ 0 };
+    std::atomic<uint64_t> max_{ 0 };
+};
+
+// Records the elapsed microseconds of its scope into a histogram.
+class ScopedHistogramTimer {
+public:
+    explicit ScopedHistogramTimer(Histogram *histogram)
+        : histogram_(histogram)
+        , start_us_(MonotonicMicros()) {}
+
+    ~ScopedHistogramTimer() {
+        if (histogram_) {
+            histogram_->Add(MonotonicMicros() - start_us_);
+        }
+    }
+private:
+    Histogram *histogram_;
+    uint64_t start_us_;
+};
+}
+
+#endif // !_RTC_HISTOGRAM_H_INCLUDED
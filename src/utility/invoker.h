@@ -6,12 +6,24 @@
 
 namespace util {
 
+// Queue a posted task waits in. Control tasks run ahead of every bulk
+// one, which is for traffic a busy peer can post faster than it drains.
+enum class Lane {
+    kControl,
+    kBulk
+};
+
 template<typename C>
 class Invoker {
 public:
     template<typename Fn>
     void Post(Fn&& fn) {
-        impl()->PostImpl(std::forward<Fn>(fn));
+        impl()->PostImpl(std::forward<Fn>(fn), Lane::kControl);
+    }
+
+    template<typename Fn>
+    void PostBulk(Fn&& fn) {
+        impl()->PostImpl(std::forward<Fn>(fn), Lane::kBulk);
     }
 
     template<typename Fn>
@@ -19,6 +31,11 @@ public:
         this->InThisThread() ? (void)fn() : this->Post(std::forward<Fn>(fn));
     }
 
+    template<typename Fn>
+    void DispatchBulk(Fn&& fn) {
+        this->InThisThread() ? (void)fn() : this->PostBulk(std::forward<Fn>(fn));
+    }
+
     template<typename Fn, typename ... Args>
     auto Invoke(Fn&& fn, Args&& ... args) -> decltype(fn(args...)) {
         if (InThisThread()) {
@@ -0,0 +1,46 @@
+#ifndef _RTC_PROBES_H_INCLUDED
+#define _RTC_PROBES_H_INCLUDED
+
+// USDT static tracepoints under the provider "rtc_call", for bpftrace and
+// perf on Linux, e.g.
+//
+//     bpftrace -e 'usdt:./rtc_call_test:rtc_call:stack_task_begin { ... }'
+//
+// A probe compiles to a single nop plus an ELF note, arguments are only
+// read by an attached tracer; keep them to values already at hand, they
+// are still evaluated. Elsewhere, or with RTC_DISABLE_USDT defined, probes
+// compile to nothing.
+//
+// Probes and their arguments:
+//
+//   stack_task_begin(task *), stack_task_end(task *)
+//       around each task posted to the sip StackThread
+//   dum_command_begin(command *), dum_command_end(command *)
+//       around each function posted to a user's dum thread
+//   sip_invite_callback(const char *callback, uint64_t trace_id)
+//       entry of each SipUserContext invite session callback, trace_id
+//       is the call's util::Tracer id or 0 if the call is not known
+//   call_ice_candidate(uint64_t trace_id, int sdp_mline_index)
+//       a local candidate gathered, before it is sent to the peer
+//   call_message(uint64_t trace_id, size_t body_size)
+//       an in-dialog MESSAGE received by Call
+//   video_sink_frame(sink *, int width, int height, int64_t timestamp_us)
+//       a decoded or captured frame entering VideoSinkAdapter
+//   sdl_render_begin(renderer *), sdl_render_end(renderer *)
+//       around SDLVideoRenderer::RenderTexture, including the wait for
+//       its mutex and SDL_RenderPresent
+
+#if defined(__linux__) && !defined(RTC_DISABLE_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define RTC_USDT_ENABLED 1
+#endif
+#endif
+
+#ifdef RTC_USDT_ENABLED
+#define RTC_PROBE(name, ...) STAP_PROBEV(rtc_call, name, ##__VA_ARGS__)
+#else
+#define RTC_PROBE(name, ...) ((void)0)
+#endif
+
+#endif // !_RTC_PROBES_H_INCLUDED
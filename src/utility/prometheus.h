@@ -0,0 +1,57 @@
+#ifndef _RTC_PROMETHEUS_H_INCLUDED
+#define _RTC_PROMETHEUS_H_INCLUDED
+
+#include <cstdint>
+#include <initializer_list>
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace util {
+
+// Builds a Prometheus text format (0.0.4) exposition. Each metric family is
+// declared once with Family() and followed by all of its samples.
+class PrometheusWriter {
+public:
+    using Labels = std::initializer_list<std::pair<const char *, std::string>>;
+
+    // type is "counter" or "gauge"
+    void Family(const char *name, const char *type, const char *help) {
+        out_ << "# HELP " << name << ' ' << help << '\n'
+             << "# TYPE " << name << ' ' << type << '\n';
+    }
+
+    template<typename T>
+    void Sample(const char *name, T value, Labels labels = {}) {
+        out_ << name;
+        if (labels.size()) {
+            const char *separator = "{";
+            for (auto& label : labels) {
+                out_ << separator << label.first << "=\"";
+                WriteEscaped(label.second);
+                out_ << '"';
+                separator = ",";
+            }
+            out_ << '}';
+        }
+        out_ << ' ' << value << '\n';
+    }
+
+    std::string str() const { return out_.str(); }
+private:
+    void WriteEscaped(const std::string& value) {
+        for (auto c : value) {
+            switch (c) {
+            case '\\': out_ << "\\\\"; break;
+            case '"': out_ << "\\\""; break;
+            case '\n': out_ << "\\n"; break;
+            default: out_ << c; break;
+            }
+        }
+    }
+
+    std::ostringstream out_;
+};
+}
+
+#endif // !_RTC_PROMETHEUS_H_INCLUDED
@@ -0,0 +1,92 @@
+#ifndef _RTC_TASK_LANES_H_INCLUDED
+#define _RTC_TASK_LANES_H_INCLUDED
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+#include "utility/invoker.h"
+
+namespace util {
+
+// The two lanes of an Invoker's queue, under one lock. A run takes every
+// control task, including those posted while it runs, and at most budget
+// bulk tasks; the owner then gets to its own work before the next run,
+// so a burst of bulk tasks neither holds up control ones nor the loop.
+class TaskLanes {
+public:
+    class Task {
+    public:
+        virtual ~Task() = default;
+        virtual void Run() = 0;
+    };
+
+    // 0 puts bulk tasks in the control lane, one fifo as without lanes
+    explicit TaskLanes(size_t budget) : budget_(budget) {}
+
+    // true if the lanes were idle, the owner then schedules a Run()
+    template<typename Fn>
+    bool Push(Fn&& fn, Lane lane) {
+        std::unique_ptr<Task> task(new FunctionTask<std::decay_t<Fn>>(std::forward<Fn>(fn)));
+
+        std::lock_guard<std::mutex> guard(mu_);
+        (Lane::kBulk == lane && budget_ ? bulk_ : control_).push_back(std::move(task));
+        return !std::exchange(scheduled_, true);
+    }
+
+    // run(task, depth) for each task taken, depth being what is left in
+    // both lanes. True if bulk tasks are left over, the owner schedules
+    // another Run() behind its other work; false leaves the lanes idle
+    // until the next Push().
+    template<typename RunFn>
+    bool Run(RunFn&& run) {
+        size_t bulk = 0;
+        for (;;) {
+            std::unique_ptr<Task> task;
+            size_t depth = 0;
+            {
+                std::lock_guard<std::mutex> guard(mu_);
+                auto& lane = !control_.empty() || bulk >= budget_ ? control_ : bulk_;
+                if (lane.empty()) {
+                    scheduled_ = !bulk_.empty();
+                    return scheduled_;
+                }
+
+                if (&lane == &bulk_) {
+                    ++bulk;
+                }
+                task = std::move(lane.front());
+                lane.pop_front();
+                depth = control_.size() + bulk_.size();
+            }
+            run(*task, depth);
+        }
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> guard(mu_);
+        return control_.size() + bulk_.size();
+    }
+private:
+    template<typename Fn>
+    class FunctionTask : public Task {
+    public:
+        explicit FunctionTask(Fn&& fn) : fn_(std::move(fn)) {}
+        explicit FunctionTask(const Fn& fn) : fn_(fn) {}
+    private:
+        void Run() override { fn_(); }
+        Fn fn_;
+    };
+
+    const size_t budget_;
+    mutable std::mutex mu_;
+    std::deque<std::unique_ptr<Task>> control_;
+    std::deque<std::unique_ptr<Task>> bulk_;
+    // a Run() is pending or in progress
+    bool scheduled_ = false;
+};
+}
+
+#endif // !_RTC_TASK_LANES_H_INCLUDED
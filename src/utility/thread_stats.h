@@ -0,0 +1,242 @@
+#ifndef _RTC_THREAD_STATS_H_INCLUDED
+#define _RTC_THREAD_STATS_H_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#ifdef WEBRTC_WIN
+#include <winsock2.h>
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+#include "utility/histogram.h"
+
+namespace util {
+
+struct ThreadSnapshot {
+    std::string name;
+    uint64_t os_id = 0;
+    // false once the thread has left its loop, cpu and wall time then stop
+    bool alive = false;
+
+    // since the thread entered its loop; idle is wall minus cpu
+    uint64_t wall_us = 0;
+    uint64_t cpu_us = 0;
+
+    // tasks run from the loop's own queue, see each loop for what counts
+    uint64_t tasks = 0;
+    uint64_t task_us = 0;
+    uint64_t max_task_us = 0;
+    size_t queue_depth = 0;
+
+    uint64_t idle_us() const { return wall_us > cpu_us ? wall_us - cpu_us : 0; }
+    double busy_percent() const { return wall_us ? 100.0 * cpu_us / wall_us : 0.0; }
+};
+
+inline uint64_t CurrentThreadId() {
+#ifdef WEBRTC_WIN
+    return ::GetCurrentThreadId();
+#elif defined(__APPLE__)
+    uint64_t tid = 0;
+    pthread_threadid_np(nullptr, &tid);
+    return tid;
+#else
+    return static_cast<uint64_t>(::syscall(SYS_gettid));
+#endif
+}
+
+// Os thread name, truncated where the os limits it. Call on the thread.
+inline void SetCurrentThreadName(const std::string& name) {
+#ifdef WEBRTC_WIN
+    // SetThreadDescription is Windows 10 1607 and later only
+    using SetThreadDescriptionFn = HRESULT (WINAPI *)(HANDLE, PCWSTR);
+    auto set_description = reinterpret_cast<SetThreadDescriptionFn>(
+        ::GetProcAddress(::GetModuleHandleW(L"kernel32.dll"), "SetThreadDescription"));
+    if (set_description) {
+        std::wstring wide(name.begin(), name.end());
+        set_description(::GetCurrentThread(), wide.c_str());
+    }
+#elif defined(__APPLE__)
+    pthread_setname_np(name.c_str());
+#else
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#endif
+}
+
+// Bit n of mask allows cpu n, 0 leaves the affinity alone. Call on the thread.
+inline bool SetCurrentThreadAffinity(uint64_t mask) {
+    if (0 == mask) {
+        return true;
+    }
+#ifdef WEBRTC_WIN
+    return 0 != ::SetThreadAffinityMask(::GetCurrentThread(), static_cast<DWORD_PTR>(mask));
+#elif defined(__APPLE__)
+    return false;
+#else
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu = 0; cpu < 64; ++cpu) {
+        if (mask & (1ull << cpu)) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return 0 == pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
+
+// Busy time, task counts and longest task of one event loop. Attach() and
+// Detach() are called by the loop's own thread around the loop, AddTask()
+// by the loop after each task and GetSnapshot() from any thread.
+class ThreadStats {
+public:
+    explicit ThreadStats(const std::string& name) : name_(name) {}
+    ~ThreadStats() { Detach(); }
+
+    const std::string& name() const { return name_; }
+
+    void Attach() {
+        std::lock_guard<std::mutex> guard(mu_);
+        if (attached_) {
+            return;
+        }
+        os_id_ = CurrentThreadId();
+#ifdef WEBRTC_WIN
+        ::DuplicateHandle(::GetCurrentProcess(), ::GetCurrentThread(), ::GetCurrentProcess(),
+                          &handle_, THREAD_QUERY_LIMITED_INFORMATION, FALSE, 0);
+#else
+        pthread_getcpuclockid(pthread_self(), &clock_);
+#endif
+        attached_ = true;
+        attach_us_ = MonotonicMicros();
+        attach_cpu_us_ = ThreadCpuMicros();
+    }
+
+    void Detach() {
+        std::lock_guard<std::mutex> guard(mu_);
+        if (!attached_) {
+            return;
+        }
+
+        wall_us_ = MonotonicMicros() - attach_us_;
+        cpu_us_ = ThreadCpuMicros() - attach_cpu_us_;
+        attached_ = false;
+#ifdef WEBRTC_WIN
+        if (handle_) {
+            ::CloseHandle(handle_);
+            handle_ = nullptr;
+        }
+#endif
+    }
+
+    void AddTask(uint64_t run_us) {
+        tasks_.fetch_add(1, std::memory_order_relaxed);
+        task_us_.fetch_add(run_us, std::memory_order_relaxed);
+
+        auto max = max_task_us_.load(std::memory_order_relaxed);
+        while (run_us > max
+            && !max_task_us_.compare_exchange_weak(max, run_us, std::memory_order_relaxed));
+    }
+
+    // Set by the loop on its own thread as it runs, for readers that must
+    // not lock the queue. Returns the previously published depth.
+    size_t PublishQueueDepth(size_t depth) {
+        return queue_depth_.exchange(depth, std::memory_order_relaxed);
+    }
+
+    size_t published_queue_depth() const { return queue_depth_.load(std::memory_order_relaxed); }
+
+    // the queue is the owner's, so it passes the depth in
+    ThreadSnapshot GetSnapshot(size_t queue_depth) const {
+        ThreadSnapshot s;
+        s.name = name_;
+        s.queue_depth = queue_depth;
+        s.tasks = tasks_.load(std::memory_order_relaxed);
+        s.task_us = task_us_.load(std::memory_order_relaxed);
+        s.max_task_us = max_task_us_.load(std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> guard(mu_);
+        s.os_id = os_id_;
+        s.alive = attached_;
+        if (attached_) {
+            s.wall_us = MonotonicMicros() - attach_us_;
+            s.cpu_us = ThreadCpuMicros() - attach_cpu_us_;
+        } else {
+            s.wall_us = wall_us_;
+            s.cpu_us = cpu_us_;
+        }
+        return s;
+    }
+private:
+    ThreadStats(const ThreadStats&) = delete;
+    ThreadStats& operator=(const ThreadStats&) = delete;
+
+    // user plus kernel time of the attached thread, under mu_
+    uint64_t ThreadCpuMicros() const {
+#ifdef WEBRTC_WIN
+        FILETIME creation, exit, kernel, user;
+        if (!handle_ || !::GetThreadTimes(handle_, &creation, &exit, &kernel, &user)) {
+            return 0;
+        }
+
+        auto to_us = [](const FILETIME& t) {
+            return ((static_cast<uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime) / 10;
+        };
+        return to_us(kernel) + to_us(user);
+#else
+        struct timespec ts;
+        if (0 != clock_gettime(clock_, &ts)) {
+            return 0;
+        }
+        return ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+#endif
+    }
+
+    const std::string name_;
+
+    mutable std::mutex mu_;
+    bool attached_ = false;
+    uint64_t os_id_ = 0;
+    uint64_t attach_us_ = 0;
+    uint64_t attach_cpu_us_ = 0;
+    // frozen by Detach()
+    uint64_t wall_us_ = 0;
+    uint64_t cpu_us_ = 0;
+#ifdef WEBRTC_WIN
+    HANDLE handle_ = nullptr;
+#else
+    clockid_t clock_ = CLOCK_THREAD_CPUTIME_ID;
+#endif
+
+    std::atomic<uint64_t> tasks_{ 0 };
+    std::atomic<uint64_t> task_us_{ 0 };
+    std::atomic<uint64_t> max_task_us_{ 0 };
+    std::atomic<size_t> queue_depth_{ 0 };
+};
+
+// Adds the elapsed time of its scope to a ThreadStats as one task.
+class ScopedTaskTimer {
+public:
+    explicit ScopedTaskTimer(ThreadStats *stats)
+        : stats_(stats)
+        , start_us_(MonotonicMicros()) {}
+
+    ~ScopedTaskTimer() {
+        if (stats_) {
+            stats_->AddTask(MonotonicMicros() - start_us_);
+        }
+    }
+private:
+    ThreadStats *stats_;
+    uint64_t start_us_;
+};
+}
+
+#endif // !_RTC_THREAD_STATS_H_INCLUDED
@@ -0,0 +1,192 @@
+#ifndef _RTC_TRACER_H_INCLUDED
+#define _RTC_TRACER_H_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "utility/histogram.h"
+#include "utility/singleton.h"
+#include "utility/thread_stats.h"
+
+namespace util {
+
+// Records Chrome trace_event spans, exported as JSON that chrome://tracing
+// and Perfetto open. Every thread appends to its own fixed size buffer
+// without locking; a full buffer drops further events. When disabled,
+// recording costs one relaxed load. Names and categories must be string
+// literals, they are stored as pointers.
+class Tracer : public Singleton<Tracer> {
+public:
+    static constexpr size_t kEventsPerThread = 1 << 16;
+
+    void Enable(bool enable) { enabled_.store(enable, std::memory_order_relaxed); }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // process-unique, never 0
+    static uint64_t NewId() {
+        static std::atomic<uint64_t> next_id{ 1 };
+        return next_id.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // phase is 'X' (complete, with dur_us), or 'b', 'e' and 'n' for async
+    // begin, end and instant events grouped by category and id
+    void Add(char phase, const char *cat, const char *name, uint64_t id,
+             uint64_t ts_us, uint64_t dur_us = 0) {
+        auto buffer = CurrentBuffer();
+        auto size = buffer->size.load(std::memory_order_relaxed);
+        if (size >= kEventsPerThread) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        buffer->events[size] = { phase, cat, name, id, ts_us, dur_us };
+        buffer->size.store(size + 1, std::memory_order_release);
+    }
+
+    // shown as the thread's name in the viewer
+    void SetCurrentThreadName(const std::string& name) {
+        std::lock_guard<std::mutex> guard(mu_);
+        thread_names_[CurrentThreadId()] = name;
+    }
+
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    // may run while other threads keep recording
+    std::string ExportJson() const {
+        std::ostringstream out;
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+        std::lock_guard<std::mutex> guard(mu_);
+        bool first = true;
+        for (auto& name : thread_names_) {
+            out << (first ? "" : ",")
+                << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << name.first
+                << ",\"args\":{\"name\":\"" << name.second << "\"}}";
+            first = false;
+        }
+
+        for (auto& buffer : buffers_) {
+            auto size = buffer->size.load(std::memory_order_acquire);
+            for (size_t i = 0; i < size; ++i) {
+                auto& event = buffer->events[i];
+                out << (first ? "" : ",")
+                    << "{\"ph\":\"" << event.phase
+                    << "\",\"cat\":\"" << event.cat
+                    << "\",\"name\":\"" << event.name
+                    << "\",\"pid\":1,\"tid\":" << buffer->tid
+                    << ",\"ts\":" << event.ts_us;
+                if ('X' == event.phase) {
+                    out << ",\"dur\":" << event.dur_us
+                        << ",\"args\":{\"id\":" << event.id << "}";
+                } else {
+                    out << ",\"id\":\"0x" << std::hex << event.id << std::dec << "\"";
+                }
+                out << "}";
+                first = false;
+            }
+        }
+
+        out << "]}";
+        return out.str();
+    }
+
+    bool WriteJson(const std::string& path) const {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+
+        file << ExportJson();
+        return static_cast<bool>(file);
+    }
+private:
+    struct Event {
+        char phase;
+        const char *cat;
+        const char *name;
+        uint64_t id;
+        uint64_t ts_us;
+        uint64_t dur_us;
+    };
+
+    // written by its thread only, kept after the thread exits
+    struct ThreadBuffer {
+        uint64_t tid = 0;
+        std::atomic<size_t> size{ 0 };
+        std::unique_ptr<Event[]> events{ new Event[kEventsPerThread] };
+    };
+
+    ThreadBuffer *CurrentBuffer() {
+        thread_local ThreadBuffer *buffer = nullptr;
+        if (!buffer) {
+            auto new_buffer = std::make_unique<ThreadBuffer>();
+            new_buffer->tid = CurrentThreadId();
+
+            std::lock_guard<std::mutex> guard(mu_);
+            buffers_.push_back(std::move(new_buffer));
+            buffer = buffers_.back().get();
+        }
+        return buffer;
+    }
+
+    std::atomic<bool> enabled_{ false };
+    std::atomic<uint64_t> dropped_{ 0 };
+
+    mutable std::mutex mu_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+    std::map<uint64_t, std::string> thread_names_;
+};
+
+// Complete event covering the enclosing scope, tagged with an id.
+class ScopedTrace {
+public:
+    ScopedTrace(const char *cat, const char *name, uint64_t id)
+        : cat_(cat)
+        , name_(Tracer::Instance().enabled() ? name : nullptr)
+        , id_(id)
+        , start_us_(name_ ? MonotonicMicros() : 0) {}
+
+    ~ScopedTrace() {
+        if (name_) {
+            Tracer::Instance().Add('X', cat_, name_, id_, start_us_, MonotonicMicros() - start_us_);
+        }
+    }
+private:
+    ScopedTrace(const ScopedTrace&) = delete;
+    ScopedTrace& operator=(const ScopedTrace&) = delete;
+
+    const char *cat_;
+    const char *name_;
+    uint64_t id_;
+    uint64_t start_us_;
+};
+
+// Spans and marks that may start and end on different threads.
+inline void TraceAsync(char phase, const char *cat, const char *name, uint64_t id) {
+    auto& tracer = Tracer::Instance();
+    if (tracer.enabled()) {
+        tracer.Add(phase, cat, name, id, MonotonicMicros());
+    }
+}
+
+inline void TraceAsyncBegin(const char *cat, const char *name, uint64_t id) {
+    TraceAsync('b', cat, name, id);
+}
+
+inline void TraceAsyncEnd(const char *cat, const char *name, uint64_t id) {
+    TraceAsync('e', cat, name, id);
+}
+
+inline void TraceAsyncInstant(const char *cat, const char *name, uint64_t id) {
+    TraceAsync('n', cat, name, id);
+}
+}
+
+#endif // !_RTC_TRACER_H_INCLUDED
@@ -0,0 +1,257 @@
+#ifndef _RTC_BENCH_UTIL_H_INCLUDED
+#define _RTC_BENCH_UTIL_H_INCLUDED
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef WEBRTC_WIN
+#include <windows.h>
+#include <psapi.h>
+#include <tlhelp32.h>
+#else
+#include <dirent.h>
+#include <fstream>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include "utility/histogram.h"
+
+namespace bench {
+
+struct ProcessStats {
+    size_t threads = 0;
+    uint64_t rss_bytes = 0;
+    // user plus kernel time
+    uint64_t cpu_us = 0;
+};
+
+inline ProcessStats GetProcessStats() {
+    ProcessStats stats;
+#ifdef WEBRTC_WIN
+    HANDLE snapshot = ::CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+    if (INVALID_HANDLE_VALUE != snapshot) {
+        THREADENTRY32 entry;
+        entry.dwSize = sizeof(entry);
+        auto pid = ::GetCurrentProcessId();
+        for (BOOL ok = ::Thread32First(snapshot, &entry); ok; ok = ::Thread32Next(snapshot, &entry)) {
+            if (pid == entry.th32OwnerProcessID) {
+                ++stats.threads;
+            }
+        }
+        ::CloseHandle(snapshot);
+    }
+
+    PROCESS_MEMORY_COUNTERS counters;
+    if (::GetProcessMemoryInfo(::GetCurrentProcess(), &counters, sizeof(counters))) {
+        stats.rss_bytes = counters.WorkingSetSize;
+    }
+
+    FILETIME creation, exit, kernel, user;
+    if (::GetProcessTimes(::GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        auto to_us = [](const FILETIME& t) {
+            return ((static_cast<uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime) / 10;
+        };
+        stats.cpu_us = to_us(kernel) + to_us(user);
+    }
+#else
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (0 == line.compare(0, 8, "Threads:")) {
+            stats.threads = std::stoul(line.substr(8));
+        } else if (0 == line.compare(0, 6, "VmRSS:")) {
+            stats.rss_bytes = std::stoull(line.substr(6)) * 1024;
+        }
+    }
+
+    struct rusage usage;
+    if (0 == ::getrusage(RUSAGE_SELF, &usage)) {
+        stats.cpu_us = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ull
+            + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+    }
+#endif
+    return stats;
+}
+
+struct ThreadCpu {
+    uint64_t id = 0;
+    // empty where the os has no thread names
+    std::string name;
+    uint64_t cpu_us = 0;
+};
+
+inline std::vector<ThreadCpu> GetThreadCpu() {
+    std::vector<ThreadCpu> threads;
+#ifdef WEBRTC_WIN
+    HANDLE snapshot = ::CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+    if (INVALID_HANDLE_VALUE == snapshot) {
+        return threads;
+    }
+
+    THREADENTRY32 entry;
+    entry.dwSize = sizeof(entry);
+    auto pid = ::GetCurrentProcessId();
+    for (BOOL ok = ::Thread32First(snapshot, &entry); ok; ok = ::Thread32Next(snapshot, &entry)) {
+        if (pid != entry.th32OwnerProcessID) {
+            continue;
+        }
+
+        HANDLE thread = ::OpenThread(THREAD_QUERY_LIMITED_INFORMATION, FALSE, entry.th32ThreadID);
+        if (!thread) {
+            continue;
+        }
+
+        FILETIME creation, exit, kernel, user;
+        if (::GetThreadTimes(thread, &creation, &exit, &kernel, &user)) {
+            auto to_us = [](const FILETIME& t) {
+                return ((static_cast<uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime) / 10;
+            };
+
+            ThreadCpu cpu;
+            cpu.id = entry.th32ThreadID;
+            cpu.cpu_us = to_us(kernel) + to_us(user);
+            threads.push_back(cpu);
+        }
+        ::CloseHandle(thread);
+    }
+    ::CloseHandle(snapshot);
+#else
+    DIR *dir = ::opendir("/proc/self/task");
+    if (!dir) {
+        return threads;
+    }
+
+    auto ticks_per_sec = ::sysconf(_SC_CLK_TCK);
+    while (auto entry = ::readdir(dir)) {
+        if ('.' == entry->d_name[0]) {
+            continue;
+        }
+
+        std::string task = std::string("/proc/self/task/") + entry->d_name;
+        std::ifstream stat(task + "/stat");
+        std::string line;
+        if (!std::getline(stat, line)) {
+            continue;
+        }
+
+        // utime and stime are the 12th and 13th fields after the ")" closing comm
+        auto pos = line.rfind(')');
+        if (std::string::npos == pos) {
+            continue;
+        }
+
+        std::istringstream fields(line.substr(pos + 2));
+        std::string field;
+        uint64_t utime = 0, stime = 0;
+        for (int i = 0; i < 13 && fields >> field; ++i) {
+            if (11 == i) {
+                utime = std::stoull(field);
+            } else if (12 == i) {
+                stime = std::stoull(field);
+            }
+        }
+
+        ThreadCpu cpu;
+        cpu.id = std::stoull(entry->d_name);
+        std::ifstream comm(task + "/comm");
+        std::getline(comm, cpu.name);
+        cpu.cpu_us = (utime + stime) * 1000000 / ticks_per_sec;
+        threads.push_back(cpu);
+    }
+    ::closedir(dir);
+#endif
+    return threads;
+}
+
+// Busy percentage of each thread alive in both samples, busiest first.
+inline std::vector<double> ThreadBusyPercent(const std::vector<ThreadCpu>& before,
+                                             const std::vector<ThreadCpu>& after,
+                                             uint64_t elapsed_us) {
+    std::map<uint64_t, uint64_t> start;
+    for (auto& thread : before) {
+        start[thread.id] = thread.cpu_us;
+    }
+
+    std::vector<double> busy;
+    for (auto& thread : after) {
+        auto it = start.find(thread.id);
+        if (start.end() != it && elapsed_us > 0) {
+            busy.push_back(100.0 * (thread.cpu_us - it->second) / elapsed_us);
+        }
+    }
+
+    std::sort(busy.begin(), busy.end(), [](double a, double b) { return a > b; });
+    return busy;
+}
+
+// Flat JSON object writer for benchmark results, one object per run so the
+// output can be appended to and diffed line by line.
+class JsonObject {
+public:
+    JsonObject& Add(const std::string& key, const std::string& value) {
+        Key(key);
+        out_ << '"' << value << '"';
+        return *this;
+    }
+
+    JsonObject& Add(const std::string& key, const char *value) {
+        return Add(key, std::string(value));
+    }
+
+    template<typename T>
+    JsonObject& Add(const std::string& key, T value) {
+        Key(key);
+        out_ << value;
+        return *this;
+    }
+
+    // count, mean, p50, p90, p99 and max of a histogram under key_*
+    JsonObject& Add(const std::string& key, const util::Histogram::Snapshot& h) {
+        Add(key + "_count", h.count);
+        Add(key + "_mean", h.mean());
+        Add(key + "_p50", h.Percentile(50));
+        Add(key + "_p90", h.Percentile(90));
+        Add(key + "_p99", h.Percentile(99));
+        Add(key + "_max", h.max);
+        return *this;
+    }
+
+    template<typename T>
+    JsonObject& Add(const std::string& key, const std::vector<T>& values) {
+        Key(key);
+        out_ << "[";
+        for (size_t i = 0; i < values.size(); ++i) {
+            out_ << (i ? "," : "") << values[i];
+        }
+        out_ << "]";
+        return *this;
+    }
+
+    std::string str() const {
+        return "{" + out_.str() + "}";
+    }
+private:
+    void Key(const std::string& key) {
+        if (!first_) {
+            out_ << ",";
+        }
+        first_ = false;
+        out_ << '"' << key << "\":";
+    }
+
+    std::ostringstream out_;
+    bool first_ = true;
+};
+
+inline std::ostream& operator<<(std::ostream& out, const JsonObject& object) {
+    return out << object.str();
+}
+}
+
+#endif // !_RTC_BENCH_UTIL_H_INCLUDED
@@ -0,0 +1,222 @@
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+
+#include "session/interface.h"
+#include "utility/histogram.h"
+
+// Time from releasing a caller to its BYE reaching the callee, right after
+// the caller has queued a burst of in-dialog MESSAGEs, once with one fifo
+// and once with the control and bulk lanes. Fails if the BYE's p99 with
+// lanes exceeds the bound.
+
+namespace {
+
+const char kHost[] = "127.0.0.1";
+const char kPassword[] = "123456";
+
+const char kSdp[] =
+    "v=0\r\n"
+    "o=- 0 0 IN IP4 127.0.0.1\r\n"
+    "s=-\r\n"
+    "c=IN IP4 127.0.0.1\r\n"
+    "t=0 0\r\n"
+    "m=audio 9 RTP/AVP 0\r\n"
+    "a=rtpmap:0 PCMU/8000\r\n";
+
+const rtc_session::Contents kMessage{ "application/json", "{\"bye_latency_test\":1}" };
+
+// What the test thread waits for, set from the dum threads.
+class Events {
+public:
+    void Set(bool Events::*flag) {
+        std::lock_guard<std::mutex> guard(mu_);
+        this->*flag = true;
+        if (&Events::terminated == flag) {
+            terminated_us = util::MonotonicMicros();
+        }
+        cond_.notify_all();
+    }
+
+    bool Wait(bool Events::*flag) {
+        std::unique_lock<std::mutex> lock(mu_);
+        return cond_.wait_for(lock, std::chrono::seconds(10), [&] { return this->*flag; });
+    }
+
+    void Reset() {
+        std::lock_guard<std::mutex> guard(mu_);
+        logged_in = connected = failed = terminated = false;
+    }
+
+    bool logged_in = false;
+    bool connected = false;
+    bool failed = false;
+    bool terminated = false;
+    uint64_t terminated_us = 0;
+private:
+    std::mutex mu_;
+    std::condition_variable cond_;
+};
+
+class Agent : public rtc_session::UserCallback
+            , public rtc_session::CallCallback
+            , public std::enable_shared_from_this<Agent> {
+public:
+    explicit Agent(Events& events) : events_(events) {}
+private:
+    void OnLoginResult(bool success) override {
+        if (success) {
+            events_.Set(&Events::logged_in);
+        }
+    }
+
+    void OnCallee(std::unique_ptr<rtc_session::CalleeInterface> callee) override {
+        callee_ = std::move(callee);
+        callee_->SetCallback(shared_from_this());
+    }
+
+    void OnInit() override {}
+    void OnAnswer(const std::string& answer) override {}
+    void OnMessageResult(bool success) override {}
+
+    void OnFailure() override {
+        events_.Set(&Events::failed);
+    }
+
+    void OnOffer(const std::string& offer) override {
+        callee_->Accept(kSdp);
+    }
+
+    void OnMessage(const rtc_session::Contents& msg) override {
+        callee_->AcceptNIT();
+    }
+
+    void OnConnected() override {
+        events_.Set(&Events::connected);
+    }
+
+    void OnTerminated() override {
+        events_.Set(&Events::terminated);
+    }
+
+    Events& events_;
+    std::unique_ptr<rtc_session::CalleeInterface> callee_;
+};
+
+std::unique_ptr<rtc_session::UserInterface> CreateUser(rtc_session::StackInterface *stack,
+                                                       const std::string& name,
+                                                       uint16_t registrar_port,
+                                                       std::shared_ptr<Agent> agent) {
+    rtc_session::UserOptions options;
+    options.name = name;
+    options.realm = kHost;
+    options.password = std::string(kPassword);
+    options.login_server_port = registrar_port;
+    options.login_keepalive_sec = 3600;
+    return stack->CreateUser(options, agent);
+}
+
+// BYE latencies in microseconds, empty if a call could not be set up
+util::Histogram::Snapshot Run(uint32_t budget, uint16_t port, size_t calls, size_t messages) {
+    rtc_session::RegistrarOptions registrar_options;
+    registrar_options.realm = kHost;
+    registrar_options.host = kHost;
+    registrar_options.udp_port = port;
+    registrar_options.password.emplace(kPassword);
+    auto registrar = rtc_session::CreateRegistrar(registrar_options);
+
+    // one stack each, see caps_bench
+    rtc_session::StackOptions options(port + 1);
+    options.bulk_task_budget = budget;
+    auto caller_stack = rtc_session::CreateStack(options);
+    options.udp_port.emplace(port + 2);
+    auto callee_stack = rtc_session::CreateStack(options);
+    if (!registrar || !caller_stack || !callee_stack) {
+        std::cerr << "failed to start the registrar or stacks on port " << port << std::endl;
+        return {};
+    }
+
+    Events caller_events, callee_events;
+    auto caller_agent = std::make_shared<Agent>(caller_events);
+    auto callee_agent = std::make_shared<Agent>(callee_events);
+    auto caller_user = CreateUser(caller_stack.get(), "caller", port, caller_agent);
+    auto callee_user = CreateUser(callee_stack.get(), "callee", port, callee_agent);
+    caller_user->Login();
+    callee_user->Login();
+    if (!caller_events.Wait(&Events::logged_in) || !callee_events.Wait(&Events::logged_in)) {
+        std::cerr << "login failed" << std::endl;
+        return {};
+    }
+
+    rtc_session::UserId peer;
+    peer.realm = kHost;
+    peer.name = "callee";
+
+    util::Histogram bye_us;
+    for (size_t i = 0; i < calls; ++i) {
+        caller_events.Reset();
+        callee_events.Reset();
+
+        auto caller = caller_user->NewCall(peer);
+        caller->SetCallback(caller_agent);
+        std::string sdp(kSdp);
+        caller->Invite(&sdp);
+        if (!caller_events.Wait(&Events::connected) || !callee_events.Wait(&Events::connected)) {
+            std::cerr << "call " << i << " failed to connect" << std::endl;
+            return {};
+        }
+
+        for (size_t j = 0; j < messages; ++j) {
+            caller->Message(kMessage);
+        }
+
+        // releasing the caller sends the BYE
+        auto start_us = util::MonotonicMicros();
+        caller.reset();
+        if (!callee_events.Wait(&Events::terminated)) {
+            std::cerr << "call " << i << " never saw its BYE" << std::endl;
+            return {};
+        }
+        bye_us.Add(callee_events.terminated_us - start_us);
+        caller_events.Wait(&Events::terminated);
+    }
+
+    caller_user.reset();
+    callee_user.reset();
+    return bye_us.GetSnapshot();
+}
+
+void Print(const char *mode, const util::Histogram::Snapshot& bye_us) {
+    std::cout << mode
+        << "\tcalls:" << bye_us.count
+        << "\tbye_p50_ms:" << bye_us.Percentile(50) / 1000.0
+        << "\tbye_p99_ms:" << bye_us.Percentile(99) / 1000.0
+        << "\tbye_max_ms:" << bye_us.max / 1000.0 << std::endl;
+}
+}
+
+int main(int argc, char *argv[]) {
+    size_t calls = argc > 1 ? std::stoul(argv[1]) : 20;
+    size_t messages = argc > 2 ? std::stoul(argv[2]) : 1000;
+    double bound_ms = argc > 3 ? std::stod(argv[3]) : 100;
+
+    rtc_session::SetLogger("file", "WARNING", "bye_latency_test.log");
+
+    auto fifo = Run(0, 3490, calls, messages);
+    Print("fifo", fifo);
+
+    auto lanes = Run(rtc_session::StackOptions().bulk_task_budget, 3500, calls, messages);
+    Print("lanes", lanes);
+
+    if (lanes.count != calls) {
+        return 1;
+    }
+
+    if (lanes.Percentile(99) / 1000.0 > bound_ms) {
+        std::cerr << "bye p99 over " << bound_ms << "ms with lanes" << std::endl;
+        return 1;
+    }
+    return 0;
+}
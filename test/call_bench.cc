@@ -0,0 +1,298 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <initializer_list>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rtc_call_interface.h"
+#include "render/interface.h"
+#include "session/interface.h"
+#include "utility/histogram.h"
+#include "bench_util.h"
+
+namespace {
+
+const char kHost[] = "127.0.0.1";
+const char kPassword[] = "123456";
+const uint16_t kRegistrarPort = 5100;
+
+class NullLocalSink : public rtc::I420VideoSinkInterface {
+private:
+    void OnFrame(const rtc::I420VideoFrame& video_frame) override {}
+};
+
+// One null renderer per call side, so frames can be counted per call.
+class BenchCallObserver : public rtc::CallObserver {
+public:
+    BenchCallObserver()
+        : renderer_(rtc::VideoRendererInterface::Create(
+            rtc::VideoRendererBackend::kNull, "call_bench", 640, 480)) {}
+
+    uint64_t frames_rendered() const { return renderer_->frames_rendered(); }
+    util::Histogram::Snapshot latency() const { return renderer_->GetLatencyHistogram(); }
+    bool error() const { return error_.load(); }
+private:
+    void OnError() override {
+        error_ = true;
+    }
+
+    std::unique_ptr<rtc::I420VideoSinkInterface> OnAddStream(
+        bool remote, const std::string& stream_label, const std::string& track_id) override {
+        if (remote) {
+            return renderer_->CreateSink(0, 0, 1, 1);
+        }
+        return std::make_unique<NullLocalSink>();
+    }
+
+    std::shared_ptr<rtc::VideoRendererInterface> renderer_;
+    std::atomic<bool> error_{ false };
+};
+
+struct BenchCall {
+    BenchCallObserver *observer;
+    std::shared_ptr<rtc::CallInterface> call;
+};
+
+// Observers live as long as the user: a callee Call is also held by the
+// engine until its BYE is processed and may still call into them.
+class BenchUser : public rtc::CallUserObserver {
+public:
+    BenchUser(std::shared_ptr<rtc::CallEngineInterface> engine, const std::string& name) {
+        rtc::CallUserOptions options;
+        options.domain = kHost;
+        options.name = name;
+        options.password = kPassword;
+        options.login_server_port = kRegistrarPort;
+        user_ = engine->CreateUser(options, this);
+    }
+
+    ~BenchUser() {
+        calls_.clear();
+        user_.reset();
+    }
+
+    bool WaitLogin() {
+        std::unique_lock<std::mutex> lock(mu_);
+        cond_.wait_for(lock, std::chrono::seconds(10), [this] { return login_done_; });
+        return login_success_;
+    }
+
+    void MakeCall(const std::string& peer) {
+        auto observer = NewObserver();
+        auto call = user_->MakeCall(peer, observer);
+        if (!call) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> guard(mu_);
+        calls_.push_back({ observer, call });
+    }
+
+    std::vector<BenchCall> calls() {
+        std::lock_guard<std::mutex> guard(mu_);
+        return calls_;
+    }
+
+    void HangUp() {
+        std::lock_guard<std::mutex> guard(mu_);
+        calls_.clear();
+    }
+private:
+    void OnLogin(bool ok) override {
+        std::lock_guard<std::mutex> guard(mu_);
+        if (!login_done_) {
+            login_done_ = true;
+            login_success_ = ok;
+            cond_.notify_all();
+        }
+    }
+
+    rtc::CallObserver *OnCallee(std::shared_ptr<rtc::CallInterface> callee) override {
+        auto observer = NewObserver();
+
+        std::lock_guard<std::mutex> guard(mu_);
+        calls_.push_back({ observer, callee });
+        return observer;
+    }
+
+    BenchCallObserver *NewObserver() {
+        std::lock_guard<std::mutex> guard(mu_);
+        observers_.emplace_back();
+        return &observers_.back();
+    }
+
+    std::shared_ptr<rtc::CallUserInterface> user_;
+
+    std::mutex mu_;
+    std::condition_variable cond_;
+    bool login_done_ = false;
+    bool login_success_ = false;
+    std::list<BenchCallObserver> observers_;
+    std::vector<BenchCall> calls_;
+};
+
+std::shared_ptr<rtc::CallEngineInterface> CreateEngine(uint16_t udp_port) {
+    rtc::CallEngineOptions options;
+    options.session.udp_port = udp_port;
+    options.session.login_keepalive_sec = 3600;
+    options.video_capture.type = rtc::CallEngineOptions::VideoCapture::Type::kSynthetic;
+    return rtc::CreateCallEngine(options);
+}
+
+// Places m calls at once, waits for the first remote frame on both sides of
+// every call, then samples rendered fps, CPU and memory for a while. The
+// caller engine then hangs them all up at once.
+void RunLevel(rtc::CallEngineInterface& caller_engine,
+              BenchUser& caller, BenchUser& callee, size_t m, int seconds) {
+    auto baseline = bench::GetProcessStats();
+
+    for (size_t i = 0; i < m; ++i) {
+        caller.MakeCall("callee");
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30 + m);
+    for (;;) {
+        auto caller_calls = caller.calls();
+        auto callee_calls = callee.calls();
+
+        size_t with_frames = 0;
+        for (auto& calls : { caller_calls, callee_calls }) {
+            for (auto& call : calls) {
+                if (call.call->setup_timings()[rtc::CallSetupStage::kFirstFrame] >= 0) {
+                    ++with_frames;
+                }
+            }
+        }
+
+        if (with_frames >= 2 * m || std::chrono::steady_clock::now() > deadline) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    util::Histogram ttff_us;
+    util::Histogram callee_ttff_us;
+    size_t errors = 0;
+    auto caller_calls = caller.calls();
+    auto callee_calls = callee.calls();
+    for (auto& call : caller_calls) {
+        auto first_frame_us = call.call->setup_timings()[rtc::CallSetupStage::kFirstFrame];
+        if (first_frame_us >= 0) {
+            ttff_us.Add(first_frame_us);
+        }
+        errors += call.observer->error() ? 1 : 0;
+    }
+    for (auto& call : callee_calls) {
+        auto first_frame_us = call.call->setup_timings()[rtc::CallSetupStage::kFirstFrame];
+        if (first_frame_us >= 0) {
+            callee_ttff_us.Add(first_frame_us);
+        }
+        errors += call.observer->error() ? 1 : 0;
+    }
+
+    std::vector<uint64_t> frames_before;
+    for (auto& calls : { caller_calls, callee_calls }) {
+        for (auto& call : calls) {
+            frames_before.push_back(call.observer->frames_rendered());
+        }
+    }
+
+    auto process_before = bench::GetProcessStats();
+    auto start_us = util::MonotonicMicros();
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    auto elapsed_us = util::MonotonicMicros() - start_us;
+    auto process_after = bench::GetProcessStats();
+
+    // fps of every receiving side
+    double fps_sum = 0;
+    double fps_min = 0;
+    size_t i = 0;
+    for (auto& calls : { caller_calls, callee_calls }) {
+        for (auto& call : calls) {
+            auto frames = call.observer->frames_rendered() - frames_before[i];
+            double fps = frames * 1e6 / elapsed_us;
+            fps_sum += fps;
+            fps_min = 0 == i ? fps : std::min(fps_min, fps);
+            ++i;
+        }
+    }
+
+    util::Histogram::Snapshot glass_to_glass_us;
+    for (auto& calls : { caller_calls, callee_calls }) {
+        for (auto& call : calls) {
+            glass_to_glass_us.Merge(call.observer->latency());
+        }
+    }
+
+    auto teardown = caller_engine.TerminateAllCalls(rtc::TerminateOptions());
+
+    bench::JsonObject result;
+    result.Add("bench", "call")
+        .Add("calls", m)
+        .Add("caller_calls", caller_calls.size())
+        .Add("callee_calls", callee_calls.size())
+        .Add("errors", errors)
+        .Add("ttff_us", ttff_us.GetSnapshot())
+        .Add("callee_ttff_us", callee_ttff_us.GetSnapshot())
+        .Add("fps_mean", i ? fps_sum / i : 0.0)
+        .Add("fps_min", fps_min)
+        .Add("glass_to_glass_us", glass_to_glass_us)
+        .Add("cpu_percent_per_call",
+             100.0 * (process_after.cpu_us - process_before.cpu_us) / elapsed_us / m)
+        .Add("rss_bytes_per_call",
+             (static_cast<double>(process_after.rss_bytes) - baseline.rss_bytes) / m)
+        .Add("threads", process_after.threads)
+        .Add("teardown_us", teardown.elapsed_us)
+        .Add("teardown_ended", teardown.ended);
+    std::cout << result << std::endl;
+
+    caller.HangUp();
+    callee.HangUp();
+
+    // let the BYEs and peer connection teardown settle before the next level
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+}
+}
+
+// call_bench [max_calls=16] [seconds_per_level=10]
+// Two engines in one process, synthetic capture and null renderers. The
+// number of concurrent calls doubles from 1 to max_calls.
+int main(int argc, char *argv[]) {
+    size_t max_calls = argc > 1 ? std::stoul(argv[1]) : 16;
+    int seconds = argc > 2 ? std::stoi(argv[2]) : 10;
+
+    rtc_session::RegistrarOptions registrar_options;
+    registrar_options.realm = kHost;
+    registrar_options.host = kHost;
+    registrar_options.udp_port = kRegistrarPort;
+    registrar_options.password.emplace(kPassword);
+
+    auto registrar = rtc_session::CreateRegistrar(registrar_options);
+    auto caller_engine = CreateEngine(kRegistrarPort + 1);
+    auto callee_engine = CreateEngine(kRegistrarPort + 2);
+    if (!registrar || !caller_engine || !callee_engine) {
+        std::cerr << "failed to start registrar or engines" << std::endl;
+        return -1;
+    }
+
+    {
+        BenchUser caller(caller_engine, "caller");
+        BenchUser callee(callee_engine, "callee");
+        if (!caller.WaitLogin() || !callee.WaitLogin()) {
+            std::cerr << "login failed" << std::endl;
+            return -1;
+        }
+
+        for (size_t m = 1; m <= max_calls; m *= 2) {
+            RunLevel(*caller_engine, caller, callee, m, seconds);
+        }
+    }
+
+    return 0;
+}
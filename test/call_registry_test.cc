@@ -0,0 +1,86 @@
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+
+#include "rtc_call_registry.h"
+
+// Lookups by handle and by Call-ID, and the ending window that
+// TerminateAllCalls paces its hangups with: a call holds a slot from
+// SetEnding() until it has ended or is removed, and WaitEnding() returns
+// once a slot frees up.
+
+namespace {
+
+using Clock = rtc::CallRegistry::Clock;
+
+int failures = 0;
+
+void Check(bool ok, const char *what) {
+    std::cout << what << "\t" << (ok ? "ok" : "FAILED") << std::endl;
+    if (!ok) {
+        ++failures;
+    }
+}
+
+// the registry only keeps and hands back the pointer, so any object stands
+// in for a Call
+std::shared_ptr<rtc::Call> FakeCall() {
+    auto owner = std::make_shared<int>(0);
+    return std::shared_ptr<rtc::Call>(owner, reinterpret_cast<rtc::Call *>(owner.get()));
+}
+
+Clock::time_point In(int ms) {
+    return Clock::now() + std::chrono::milliseconds(ms);
+}
+}
+
+int main() {
+    rtc::CallRegistry registry;
+
+    auto a = FakeCall();
+    auto b = FakeCall();
+    auto ha = registry.Add(a);
+    auto hb = registry.Add(b);
+    Check(0 != ha && 0 != hb && ha != hb, "handles");
+    Check(registry.Find(ha) == a && registry.Find(hb) == b, "find");
+    Check(!registry.Find(hb + 1), "find unknown");
+
+    Check(!registry.FindByCallId("a@host"), "no call id yet");
+    registry.SetCallId(ha, "a@host");
+    Check(registry.FindByCallId("a@host") == a, "find by call id");
+    registry.SetCallId(ha, "a2@host");
+    Check(!registry.FindByCallId("a@host") && registry.FindByCallId("a2@host") == a,
+          "call id replaced");
+
+    // a call gone without Remove() is not handed out
+    auto c = FakeCall();
+    auto hc = registry.Add(c);
+    c.reset();
+    Check(!registry.Find(hc), "expired call");
+    Check(2 == registry.All().size(), "all");
+    registry.Remove(hc);
+
+    Check(registry.SetEnding(ha) && registry.SetEnding(hb), "set ending");
+    Check(registry.SetEnding(ha), "set ending twice");
+    Check(!registry.WaitEnding(2, In(10)), "two ending");
+    Check(registry.WaitEnding(3, In(10)), "room for a third");
+
+    registry.SetEnded(ha);
+    Check(registry.Ended(ha) && !registry.Ended(hb), "ended");
+    Check(!registry.SetEnding(ha), "ending after ended");
+    Check(1 == registry.Live().size() && registry.Live()[0] == b, "live");
+    Check(registry.WaitEnding(2, In(10)) && !registry.WaitEnding(1, In(10)), "one ending");
+
+    // removing an ending call frees its slot and wakes a waiter
+    auto waiter = std::async(std::launch::async, [&] {
+        return registry.WaitEnding(1, In(5000));
+    });
+    registry.Remove(hb);
+    Check(waiter.get(), "removed call frees its slot");
+    Check(!registry.Find(hb) && registry.Ended(hb), "removed");
+
+    registry.Remove(ha);
+    Check(!registry.FindByCallId("a2@host") && 0 == registry.size(), "empty");
+    return failures ? 1 : 0;
+}
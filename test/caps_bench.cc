@@ -0,0 +1,463 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "session/coro.h"
+#include "session/interface.h"
+#include "utility/histogram.h"
+#include "bench_util.h"
+
+namespace {
+
+const char kHost[] = "127.0.0.1";
+const char kPassword[] = "123456";
+
+const char kSdp[] =
+    "v=0\r\n"
+    "o=- 0 0 IN IP4 127.0.0.1\r\n"
+    "s=-\r\n"
+    "c=IN IP4 127.0.0.1\r\n"
+    "t=0 0\r\n"
+    "m=audio 9 RTP/AVP 0\r\n"
+    "a=rtpmap:0 PCMU/8000\r\n";
+
+const rtc_session::Contents kMessage{ "application/json", "{\"caps_bench\":1}" };
+
+struct LevelState {
+    util::Histogram setup_us;
+    util::Histogram cycle_us;
+    std::atomic<uint64_t> started{ 0 };
+    std::atomic<uint64_t> completed{ 0 };
+    std::atomic<uint64_t> failed{ 0 };
+};
+
+class LoginWaiter {
+public:
+    void OnLogin(bool success) {
+        std::lock_guard<std::mutex> guard(mu_);
+        (success ? succeeded_ : failed_)++;
+        cond_.notify_one();
+    }
+
+    bool Wait(size_t users) {
+        std::unique_lock<std::mutex> lock(mu_);
+        cond_.wait_for(lock, std::chrono::seconds(30), [&] {
+            return succeeded_ + failed_ >= users;
+        });
+        return succeeded_ >= users;
+    }
+private:
+    std::mutex mu_;
+    std::condition_variable cond_;
+    size_t succeeded_ = 0;
+    size_t failed_ = 0;
+};
+
+class CallerAgent;
+
+// One caller and one callee user, each on its own stack: a stack hands
+// incoming requests to the first user that claims the domain, so users
+// sharing a stack can't tell their in-dialog requests apart.
+class Pair {
+public:
+    Pair(LoginWaiter& login_waiter, size_t index, uint16_t registrar_port, uint16_t port);
+
+    bool valid() const { return caller_ && callee_; }
+    void Login();
+    void MakeCall(LevelState *level);
+#ifdef RTC_HAS_COROUTINES
+    void MakeCoroCall(LevelState *level);
+#endif
+    void OnCallerDone(CallerAgent *agent);
+    size_t active_calls();
+private:
+    class UserAgent : public rtc_session::UserCallback {
+    public:
+        UserAgent(LoginWaiter& login_waiter, bool callee)
+            : login_waiter_(login_waiter)
+            , callee_(callee) {}
+    private:
+        void OnLoginResult(bool success) override;
+        void OnCallee(std::unique_ptr<rtc_session::CalleeInterface> callee) override;
+
+        LoginWaiter& login_waiter_;
+        bool callee_;
+        std::atomic<bool> logged_in_{ false };
+    };
+
+    std::unique_ptr<rtc_session::UserInterface> CreateUser(
+        const std::string& name, uint16_t registrar_port, bool callee);
+
+    LoginWaiter& login_waiter_;
+    std::string callee_name_;
+    std::unique_ptr<rtc_session::StackInterface> caller_stack_;
+    std::unique_ptr<rtc_session::StackInterface> callee_stack_;
+    std::unique_ptr<rtc_session::UserInterface> caller_;
+    std::unique_ptr<rtc_session::UserInterface> callee_;
+
+    std::mutex mu_;
+    std::map<CallerAgent *, std::shared_ptr<CallerAgent>> active_;
+    std::atomic<size_t> active_coro_{ 0 };
+};
+
+// INVITE with canned sdp, 200/ACK, one in-dialog MESSAGE, then BYE.
+class CallerAgent : public rtc_session::CallCallback
+                  , public std::enable_shared_from_this<CallerAgent> {
+public:
+    CallerAgent(Pair& pair, LevelState *level) : pair_(pair), level_(level) {}
+
+    void Start(std::unique_ptr<rtc_session::CallerInterface> caller) {
+        std::lock_guard<std::mutex> guard(mu_);
+        caller_ = std::move(caller);
+        caller_->SetCallback(shared_from_this());
+
+        start_us_ = util::MonotonicMicros();
+        std::string sdp(kSdp);
+        caller_->Invite(&sdp);
+    }
+private:
+    void OnInit() override {}
+    void OnOffer(const std::string& offer) override {}
+    void OnAnswer(const std::string& answer) override {}
+    void OnMessage(const rtc_session::Contents& msg) override {}
+
+    void OnFailure() override {
+        Finish(false);
+    }
+
+    void OnConnected() override {
+        level_->setup_us.Add(util::MonotonicMicros() - start_us_);
+
+        std::lock_guard<std::mutex> guard(mu_);
+        if (caller_) {
+            caller_->Message(kMessage);
+        }
+    }
+
+    void OnMessageResult(bool success) override {
+        if (!success) {
+            Finish(false);
+            return;
+        }
+
+        // releasing the caller sends the BYE
+        std::lock_guard<std::mutex> guard(mu_);
+        caller_.reset();
+    }
+
+    void OnTerminated() override {
+        Finish(true);
+    }
+
+    void Finish(bool success) {
+        if (finished_.exchange(true)) {
+            return;
+        }
+
+        if (success) {
+            level_->cycle_us.Add(util::MonotonicMicros() - start_us_);
+            level_->completed.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            level_->failed.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(mu_);
+            caller_.reset();
+        }
+        pair_.OnCallerDone(this);
+    }
+
+    Pair& pair_;
+    LevelState *level_;
+    std::mutex mu_;
+    std::unique_ptr<rtc_session::CallerInterface> caller_;
+    uint64_t start_us_ = 0;
+    std::atomic<bool> finished_{ false };
+};
+
+// Accepts every offer with the same sdp and every MESSAGE.
+class CalleeAgent : public rtc_session::CallCallback
+                  , public std::enable_shared_from_this<CalleeAgent> {
+public:
+    explicit CalleeAgent(std::unique_ptr<rtc_session::CalleeInterface> callee)
+        : callee_(std::move(callee)) {}
+
+    void Start() {
+        callee_->SetCallback(shared_from_this());
+        self_ = shared_from_this();
+    }
+private:
+    void OnInit() override {}
+    void OnAnswer(const std::string& answer) override {}
+    void OnMessageResult(bool success) override {}
+    void OnConnected() override {}
+
+    void OnOffer(const std::string& offer) override {
+        callee_->Accept(kSdp);
+    }
+
+    void OnMessage(const rtc_session::Contents& msg) override {
+        callee_->AcceptNIT();
+    }
+
+    void OnFailure() override {
+        self_.reset();
+    }
+
+    void OnTerminated() override {
+        self_.reset();
+    }
+
+    std::unique_ptr<rtc_session::CalleeInterface> callee_;
+    // keeps itself alive until the dialog ends
+    std::shared_ptr<CalleeAgent> self_;
+};
+
+void Pair::UserAgent::OnLoginResult(bool success) {
+    if (!logged_in_.exchange(true)) {
+        login_waiter_.OnLogin(success);
+    }
+}
+
+void Pair::UserAgent::OnCallee(std::unique_ptr<rtc_session::CalleeInterface> callee) {
+    if (callee_) {
+        std::make_shared<CalleeAgent>(std::move(callee))->Start();
+    }
+}
+
+Pair::Pair(LoginWaiter& login_waiter, size_t index, uint16_t registrar_port, uint16_t port)
+    : login_waiter_(login_waiter)
+    , callee_name_("callee" + std::to_string(index)) {
+    caller_stack_ = rtc_session::CreateStack(rtc_session::StackOptions(port));
+    callee_stack_ = rtc_session::CreateStack(rtc_session::StackOptions(port + 1));
+    if (!caller_stack_ || !callee_stack_) {
+        return;
+    }
+
+    caller_ = CreateUser("caller" + std::to_string(index), registrar_port, false);
+    callee_ = CreateUser(callee_name_, registrar_port, true);
+}
+
+std::unique_ptr<rtc_session::UserInterface> Pair::CreateUser(
+    const std::string& name, uint16_t registrar_port, bool callee) {
+    rtc_session::UserOptions options;
+    options.name = name;
+    options.realm = kHost;
+    options.password = std::string(kPassword);
+    options.login_server_port = registrar_port;
+    options.login_keepalive_sec = 3600;
+
+    auto& stack = callee ? callee_stack_ : caller_stack_;
+    return stack->CreateUser(options, std::make_shared<UserAgent>(login_waiter_, callee));
+}
+
+void Pair::Login() {
+    caller_->Login();
+    callee_->Login();
+}
+
+void Pair::MakeCall(LevelState *level) {
+    rtc_session::UserId peer;
+    peer.realm = kHost;
+    peer.name = callee_name_;
+
+    auto agent = std::make_shared<CallerAgent>(*this, level);
+    {
+        std::lock_guard<std::mutex> guard(mu_);
+        active_[agent.get()] = agent;
+    }
+
+    level->started.fetch_add(1, std::memory_order_relaxed);
+    agent->Start(caller_->NewCall(peer));
+}
+
+#ifdef RTC_HAS_COROUTINES
+// CallerAgent's cycle as one coroutine, resumed on the dum thread by each
+// event it waits for.
+util::Task<void> CoroCallerCycle(std::unique_ptr<rtc_session::CallerInterface> caller,
+                                 LevelState *level,
+                                 std::atomic<size_t> *active) {
+    auto callback = std::make_shared<rtc_session::CoroCallCallback>();
+    caller->SetCallback(callback);
+
+    auto start_us = util::MonotonicMicros();
+    std::string sdp(kSdp);
+    bool ok = (co_await callback->Invite(*caller, &sdp)).has_value()
+        && co_await callback->Connected();
+    if (ok) {
+        level->setup_us.Add(util::MonotonicMicros() - start_us);
+        ok = co_await callback->Message(*caller, kMessage);
+    }
+
+    // releasing the caller sends the BYE
+    caller.reset();
+    co_await callback->Terminated();
+
+    if (ok) {
+        level->cycle_us.Add(util::MonotonicMicros() - start_us);
+        level->completed.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        level->failed.fetch_add(1, std::memory_order_relaxed);
+    }
+    active->fetch_sub(1, std::memory_order_relaxed);
+}
+
+void Pair::MakeCoroCall(LevelState *level) {
+    rtc_session::UserId peer;
+    peer.realm = kHost;
+    peer.name = callee_name_;
+
+    active_coro_.fetch_add(1, std::memory_order_relaxed);
+    level->started.fetch_add(1, std::memory_order_relaxed);
+    util::Spawn(CoroCallerCycle(caller_->NewCall(peer), level, &active_coro_));
+}
+#endif
+
+void Pair::OnCallerDone(CallerAgent *agent) {
+    std::lock_guard<std::mutex> guard(mu_);
+    active_.erase(agent);
+}
+
+size_t Pair::active_calls() {
+    std::lock_guard<std::mutex> guard(mu_);
+    return active_.size() + active_coro_.load(std::memory_order_relaxed);
+}
+
+// Starts calls at a fixed rate round robin over the pairs for the given
+// duration, then gives the calls in flight a moment to finish.
+void RunLevel(std::vector<std::unique_ptr<Pair>>& pairs, int offered_caps, int seconds,
+              bool coro, bool *saturated) {
+    LevelState level;
+
+    auto process_before = bench::GetProcessStats();
+    auto threads_before = bench::GetThreadCpu();
+    auto start_us = util::MonotonicMicros();
+
+    auto interval = std::chrono::microseconds(1000000 / offered_caps);
+    auto next = std::chrono::steady_clock::now();
+    size_t total = static_cast<size_t>(offered_caps) * seconds;
+    for (size_t i = 0; i < total; ++i) {
+        auto& pair = pairs[i % pairs.size()];
+#ifdef RTC_HAS_COROUTINES
+        if (coro) {
+            pair->MakeCoroCall(&level);
+        } else {
+            pair->MakeCall(&level);
+        }
+#else
+        pair->MakeCall(&level);
+#endif
+        next += interval;
+        std::this_thread::sleep_until(next);
+    }
+
+    auto elapsed_us = util::MonotonicMicros() - start_us;
+    auto completed = level.completed.load();
+    auto threads_after = bench::GetThreadCpu();
+    auto process_after = bench::GetProcessStats();
+
+    auto drain_deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    for (;;) {
+        size_t active = 0;
+        for (auto& pair : pairs) {
+            active += pair->active_calls();
+        }
+
+        if (0 == active || std::chrono::steady_clock::now() > drain_deadline) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    auto started = level.started.load();
+    auto failed = level.failed.load();
+    auto achieved_caps = completed * 1e6 / elapsed_us;
+
+    // saturated once the layer completes less than 90% of the offered load
+    // or more than 1% of the calls fail
+    *saturated = achieved_caps < 0.9 * offered_caps || failed * 100 > started;
+
+    auto busy = bench::ThreadBusyPercent(threads_before, threads_after, elapsed_us);
+    busy.resize(std::min<size_t>(busy.size(), 8));
+
+    bench::JsonObject result;
+    result.Add("bench", "caps")
+        .Add("callers", coro ? "coroutine" : "callback")
+        .Add("pairs", pairs.size())
+        .Add("offered_caps", offered_caps)
+        .Add("achieved_caps", achieved_caps)
+        .Add("started", started)
+        .Add("completed", level.completed.load())
+        .Add("failed", failed)
+        .Add("setup_us", level.setup_us.GetSnapshot())
+        .Add("cycle_us", level.cycle_us.GetSnapshot())
+        .Add("process_cpu_percent",
+             100.0 * (process_after.cpu_us - process_before.cpu_us) / elapsed_us)
+        .Add("threads", process_after.threads)
+        .Add("top_thread_cpu_percent", busy)
+        .Add("saturated", *saturated ? 1 : 0);
+    std::cout << result << std::endl;
+}
+}
+
+// caps_bench [pairs=4] [seconds_per_level=5] [max_caps=5000] [callers=callback|coro]
+// Doubles the offered load from 10 calls/sec until the session layer
+// saturates, one JSON object per level. coro drives the callers with
+// coroutines, where the compiler has them.
+int main(int argc, char *argv[]) {
+    size_t pair_count = argc > 1 ? std::stoul(argv[1]) : 4;
+    int seconds = argc > 2 ? std::stoi(argv[2]) : 5;
+    int max_caps = argc > 3 ? std::stoi(argv[3]) : 5000;
+    bool coro = argc > 4 && std::string("coro") == argv[4];
+#ifndef RTC_HAS_COROUTINES
+    if (coro) {
+        std::cerr << "built without coroutines" << std::endl;
+        return -1;
+    }
+#endif
+
+    const uint16_t kRegistrarPort = 5090;
+
+    rtc_session::RegistrarOptions registrar_options;
+    registrar_options.realm = kHost;
+    registrar_options.host = kHost;
+    registrar_options.udp_port = kRegistrarPort;
+    registrar_options.password.emplace(kPassword);
+
+    auto registrar = rtc_session::CreateRegistrar(registrar_options);
+    if (!registrar) {
+        std::cerr << "failed to start registrar" << std::endl;
+        return -1;
+    }
+
+    LoginWaiter login_waiter;
+    std::vector<std::unique_ptr<Pair>> pairs;
+    for (size_t i = 0; i < pair_count; ++i) {
+        auto port = static_cast<uint16_t>(kRegistrarPort + 2 + 2 * i);
+        pairs.push_back(std::make_unique<Pair>(login_waiter, i, kRegistrarPort, port));
+        if (!pairs.back()->valid()) {
+            std::cerr << "failed to create pair " << i << std::endl;
+            return -1;
+        }
+        pairs.back()->Login();
+    }
+
+    if (!login_waiter.Wait(2 * pair_count)) {
+        std::cerr << "login failed" << std::endl;
+        return -1;
+    }
+
+    bool saturated = false;
+    for (int caps = 10; caps <= max_caps && !saturated; caps *= 2) {
+        RunLevel(pairs, caps, seconds, coro, &saturated);
+    }
+
+    return 0;
+}
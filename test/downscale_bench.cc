@@ -0,0 +1,68 @@
+#include <iostream>
+#include <vector>
+
+#include "render/sdl_renderer.h"
+#include "render/sdl_util.h"
+#include "test_i420_frame.h"
+
+namespace {
+
+void Run(std::shared_ptr<rtc::SDLVideoRenderer> renderer,
+         bool downscale,
+         int grid,
+         const rtc::I420VideoFrame& frame,
+         int rounds) {
+    renderer->set_downscale_enabled(downscale);
+    renderer->upload_time_us().Reset();
+
+    std::shared_ptr<rtc::VideoRendererInterface> base = renderer;
+    std::vector<std::unique_ptr<rtc::I420VideoSinkInterface>> sinks;
+
+    float tile = 1.0f / grid;
+    for (int i = 0; i < grid; ++i) {
+        for (int j = 0; j < grid; ++j) {
+            sinks.push_back(base->CreateSink(j * tile, i * tile, tile, tile));
+        }
+    }
+
+    util::Histogram round_time_us;
+    for (int i = 0; i < rounds; ++i) {
+        util::ScopedHistogramTimer timer(&round_time_us);
+        for (auto& sink : sinks) {
+            sink->OnFrame(frame);
+        }
+    }
+
+    auto upload = renderer->upload_time_us().GetSnapshot();
+    auto round = round_time_us.GetSnapshot();
+    std::cout << (downscale ? "downscale" : "gpu scale")
+        << "\ttiles:" << sinks.size()
+        << "\t" << frame.width() << "x" << frame.height()
+        << "\tround_mean_us:" << round.mean()
+        << "\tround_p99_us:" << round.Percentile(99)
+        << "\tupload_mean_us:" << upload.mean()
+        << "\tupload_p99_us:" << upload.Percentile(99) << std::endl;
+}
+}
+
+int main() {
+    rtc::SDLInitializer _sdl_initializer;
+
+    auto renderer = rtc::SDLVideoRenderer::Create("downscale_bench", 1280, 720);
+    if (!renderer) {
+        return -1;
+    }
+
+    const int kRounds = 300;
+    rtc::TestI420Frame frame720(1280, 720);
+    rtc::TestI420Frame frame1080(1920, 1080);
+
+    for (int grid = 2; grid <= 4; ++grid) {
+        for (bool downscale : { false, true }) {
+            Run(renderer, downscale, grid, frame720, kRounds);
+            Run(renderer, downscale, grid, frame1080, kRounds);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "render/i420_scaler.h"
+
+// Halving a frame to exactly half its size must give the rounded 2x2 box
+// average whichever row function the cpu selects, and a scaler must give
+// the same output for a size after its scratch has served other sizes.
+
+namespace {
+
+class RandomI420Frame : public rtc::I420VideoFrame {
+public:
+    RandomI420Frame(int w, int h, uint32_t seed)
+        : w_(w)
+        , h_(h)
+        , y_(w * h)
+        , u_(((w + 1) / 2) * ((h + 1) / 2))
+        , v_(u_.size()) {
+        std::mt19937 rng(seed);
+        for (auto plane : { &y_, &u_, &v_ }) {
+            for (auto& pixel : *plane) {
+                pixel = static_cast<uint8_t>(rng());
+            }
+        }
+    }
+
+    int width() const override { return w_; }
+    int height() const override { return h_; }
+
+    const uint8_t* DataY() const override { return y_.data(); }
+    const uint8_t* DataU() const override { return u_.data(); }
+    const uint8_t* DataV() const override { return v_.data(); }
+
+    int StrideY() const override { return w_; }
+    int StrideU() const override { return (w_ + 1) / 2; }
+    int StrideV() const override { return (w_ + 1) / 2; }
+private:
+    int w_;
+    int h_;
+    std::vector<uint8_t> y_;
+    std::vector<uint8_t> u_;
+    std::vector<uint8_t> v_;
+};
+
+// mismatching pixels of a w x h plane against the box filter of src
+int CheckHalved(const uint8_t *src, int src_stride, const uint8_t *dst, int dst_stride, int w, int h) {
+    int mismatches = 0;
+    for (int y = 0; y < h; ++y) {
+        const uint8_t *row0 = src + 2 * y * src_stride;
+        const uint8_t *row1 = row0 + src_stride;
+        for (int x = 0; x < w; ++x) {
+            int expected = (row0[2 * x] + row0[2 * x + 1] + row1[2 * x] + row1[2 * x + 1] + 2) >> 2;
+            if (dst[y * dst_stride + x] != expected) {
+                ++mismatches;
+            }
+        }
+    }
+    return mismatches;
+}
+
+bool SamePlanes(const rtc::ScaledI420Frame& a, const rtc::ScaledI420Frame& b) {
+    auto size = rtc::ScaledI420Frame::BufferSize(a.width(), a.height());
+    return a.width() == b.width() && a.height() == b.height()
+        && std::equal(a.DataY(), a.DataY() + size, b.DataY());
+}
+}
+
+int main() {
+    rtc::I420Scaler scaler(rtc::ScratchBufferPool::Create());
+
+    // luma width 644 and chroma width 322 leave a tail for the C row function
+    RandomI420Frame frame(1288, 724, 1);
+    auto halved = scaler.Scale(frame, 644, 362);
+    if (!halved) {
+        std::cerr << "no halved frame" << std::endl;
+        return 1;
+    }
+
+    int mismatches = CheckHalved(frame.DataY(), frame.StrideY(),
+                                 halved->DataY(), halved->StrideY(), 644, 362)
+        + CheckHalved(frame.DataU(), frame.StrideU(),
+                      halved->DataU(), halved->StrideU(), 322, 181)
+        + CheckHalved(frame.DataV(), frame.StrideV(),
+                      halved->DataV(), halved->StrideV(), 322, 181);
+    std::cout << "halve\tmismatches:" << mismatches << std::endl;
+    if (mismatches) {
+        return 1;
+    }
+
+    auto first = scaler.Scale(frame, 300, 170);
+    scaler.Scale(frame, 900, 100);
+    scaler.Scale(frame, 64, 36);
+    auto again = scaler.Scale(frame, 300, 170);
+    bool same = first && again && SamePlanes(*first, *again);
+    std::cout << "bilinear reuse\tsame:" << same << std::endl;
+    return same ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+#include <chrono>
+#include <cstdio>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "record/interface.h"
+#include "test_i420_frame.h"
+
+namespace {
+
+// Feeds every recorder from its own thread at the given frame rate, like one
+// decode thread per call, and reports what made it to disk.
+void Run(int recorders, bool direct_io, const rtc::I420VideoFrame& frame,
+         int fps, int seconds) {
+    std::vector<std::shared_ptr<rtc::MediaRecorderInterface>> recs;
+    for (int i = 0; i < recorders; ++i) {
+        rtc::MediaRecorderOptions options;
+        options.path = "record_bench_" + std::to_string(i);
+        options.direct_io = direct_io;
+        options.video_fps = fps;
+
+        auto rec = rtc::MediaRecorderInterface::Create(options);
+        if (!rec) {
+            std::cerr << "failed to open " << options.path << std::endl;
+            return;
+        }
+        recs.push_back(rec);
+    }
+
+    // 10ms of 48kHz stereo, as webrtc delivers it
+    std::vector<int16_t> samples(480 * 2);
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::vector<std::thread> threads;
+        for (auto& rec : recs) {
+            threads.emplace_back([&frame, &samples, fps, seconds](
+                std::shared_ptr<rtc::MediaRecorderInterface> rec) {
+                auto video_sink = rec->CreateVideoSink();
+                auto audio_sink = rec->CreateAudioSink();
+
+                auto next = std::chrono::steady_clock::now();
+                for (int i = 0; i < fps * seconds; ++i) {
+                    video_sink->OnFrame(frame);
+                    for (int j = 0; j < 100 / fps; ++j) {
+                        audio_sink->OnData(samples.data(), 48000, 2, 480);
+                    }
+
+                    next += std::chrono::microseconds(1000000 / fps);
+                    std::this_thread::sleep_until(next);
+                }
+            }, rec);
+        }
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    // the rates cover what the writers had done by now; what is still
+    // queued is flushed below, outside the measured window
+    std::vector<rtc::MediaRecorderStats> stats;
+    for (auto& rec : recs) {
+        stats.push_back(rec->stats());
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // dropping the recorders joins the writers, which flush what is still queued
+    recs.clear();
+
+    uint64_t written = 0, dropped = 0, bytes = 0;
+    for (auto& s : stats) {
+        written += s.video_frames_written;
+        dropped += s.video_frames_dropped;
+        bytes += s.bytes_written;
+    }
+
+    std::cout << (direct_io ? "direct" : "buffered")
+        << "\trecorders:" << recorders
+        << "\t" << frame.width() << "x" << frame.height()
+        << "\tframes_written:" << written
+        << "\tframes_dropped:" << dropped
+        << "\tMB/s:" << bytes / elapsed / (1 << 20) << std::endl;
+
+    for (int i = 0; i < recorders; ++i) {
+        std::remove(("record_bench_" + std::to_string(i) + ".y4m").c_str());
+        std::remove(("record_bench_" + std::to_string(i) + ".wav").c_str());
+    }
+}
+}
+
+int main(int argc, char *argv[]) {
+    int max_recorders = argc > 1 ? std::stoi(argv[1]) : 16;
+
+    const int kFps = 30;
+    const int kSeconds = 5;
+    rtc::TestI420Frame frame(1280, 720);
+
+    for (int n = 1; n <= max_recorders; n *= 2) {
+        for (bool direct_io : { false, true }) {
+            Run(n, direct_io, frame, kFps, kSeconds);
+        }
+    }
+
+    return 0;
+}
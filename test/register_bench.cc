@@ -0,0 +1,187 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "session/interface.h"
+#include "utility/histogram.h"
+#include "bench_util.h"
+
+namespace {
+
+const char kHost[] = "127.0.0.1";
+const char kPassword[] = "123456";
+
+struct RunState {
+    util::Histogram login_us;
+    std::atomic<size_t> succeeded{ 0 };
+    std::atomic<size_t> failed{ 0 };
+    std::mutex mu;
+    std::condition_variable cond;
+
+    // under mu, so the waiter cannot check done() and miss the notify
+    void OnDone(bool success) {
+        std::lock_guard<std::mutex> guard(mu);
+        (success ? succeeded : failed).fetch_add(1, std::memory_order_relaxed);
+        cond.notify_one();
+    }
+
+    size_t done() const {
+        return succeeded.load(std::memory_order_relaxed) + failed.load(std::memory_order_relaxed);
+    }
+};
+
+// Login() to the first OnLoginResult(), which comes after the rport
+// rebinding when the registrar reports a different contact.
+class BenchUser : public rtc_session::UserCallback {
+public:
+    explicit BenchUser(RunState& state) : state_(state) {}
+
+    void Start(rtc_session::UserInterface *user) {
+        start_us_ = util::MonotonicMicros();
+        user->Login();
+    }
+private:
+    void OnLoginResult(bool success) override {
+        if (done_.exchange(true)) {
+            return;
+        }
+
+        if (success) {
+            state_.login_us.Add(util::MonotonicMicros() - start_us_);
+        }
+        state_.OnDone(success);
+    }
+
+    void OnCallee(std::unique_ptr<rtc_session::CalleeInterface> callee) override {}
+
+    RunState& state_;
+    uint64_t start_us_ = 0;
+    std::atomic<bool> done_{ false };
+};
+
+void Run(size_t users, uint16_t registrar_port, uint16_t stack_port, int idle_seconds) {
+    rtc_session::RegistrarOptions registrar_options;
+    registrar_options.realm = kHost;
+    registrar_options.host = kHost;
+    registrar_options.udp_port = registrar_port;
+    registrar_options.password.emplace(kPassword);
+
+    auto registrar = rtc_session::CreateRegistrar(registrar_options);
+    auto stack = rtc_session::CreateStack(rtc_session::StackOptions(stack_port));
+    if (!registrar || !stack) {
+        std::cerr << "failed to start registrar or stack" << std::endl;
+        return;
+    }
+
+    auto baseline = bench::GetProcessStats();
+
+    RunState state;
+    std::vector<std::shared_ptr<BenchUser>> callbacks;
+    std::vector<std::unique_ptr<rtc_session::UserInterface>> session_users;
+    callbacks.reserve(users);
+    session_users.reserve(users);
+
+    for (size_t i = 0; i < users; ++i) {
+        rtc_session::UserOptions options;
+        options.name = "bench" + std::to_string(i);
+        options.realm = kHost;
+        options.password = std::string(kPassword);
+        options.login_server_port = registrar_port;
+        options.login_keepalive_sec = 3600;
+
+        auto callback = std::make_shared<BenchUser>(state);
+        auto user = stack->CreateUser(options, callback);
+        if (!user) {
+            std::cerr << "failed to create user " << i << std::endl;
+            return;
+        }
+
+        callbacks.push_back(callback);
+        session_users.push_back(std::move(user));
+    }
+
+    auto created = bench::GetProcessStats();
+
+    auto start_us = util::MonotonicMicros();
+    for (size_t i = 0; i < users; ++i) {
+        callbacks[i]->Start(session_users[i].get());
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(state.mu);
+        state.cond.wait_for(lock, std::chrono::seconds(60 + users / 100), [&] {
+            return state.done() >= users;
+        });
+    }
+    auto elapsed_us = util::MonotonicMicros() - start_us;
+
+    auto registered = bench::GetProcessStats();
+    std::this_thread::sleep_for(std::chrono::seconds(idle_seconds));
+    auto idle = bench::GetProcessStats();
+
+    auto registrar_stats = registrar->stats();
+    auto succeeded = state.succeeded.load();
+
+    auto logout = stack->LogoutAll(200, 10000);
+
+    // with no registration left to end, releasing the users and the stack
+    // only waits for their threads
+    auto teardown_start_us = util::MonotonicMicros();
+    session_users.clear();
+    stack.reset();
+    auto teardown_us = util::MonotonicMicros() - teardown_start_us;
+
+    bench::JsonObject result;
+    result.Add("bench", "register")
+        .Add("users", users)
+        .Add("succeeded", succeeded)
+        .Add("failed", state.failed.load())
+        .Add("timed_out", users - state.done())
+        .Add("elapsed_ms", elapsed_us / 1000)
+        .Add("register_per_sec", elapsed_us ? succeeded * 1e6 / elapsed_us : 0.0)
+        .Add("registrar_registrations", registrar_stats.registrations)
+        .Add("registrar_challenges", registrar_stats.challenges)
+        .Add("login_us", state.login_us.GetSnapshot())
+        .Add("threads", registered.threads)
+        .Add("threads_per_user", static_cast<double>(registered.threads - baseline.threads) / users)
+        .Add("rss_bytes", registered.rss_bytes)
+        .Add("rss_bytes_per_user",
+             (static_cast<double>(registered.rss_bytes) - baseline.rss_bytes) / users)
+        .Add("rss_bytes_per_user_created",
+             (static_cast<double>(created.rss_bytes) - baseline.rss_bytes) / users)
+        .Add("idle_cpu_percent",
+             100.0 * (idle.cpu_us - registered.cpu_us) / (idle_seconds * 1e6))
+        .Add("logout_ms", logout.elapsed_us / 1000)
+        .Add("logged_out", logout.logged_out)
+        .Add("logout_not_sent", logout.not_sent)
+        .Add("teardown_ms", teardown_us / 1000);
+    std::cout << result << std::endl;
+}
+}
+
+// register_bench [max_users=1000] [idle_seconds=5]
+// Prints one JSON object per run, for users = 10, 100, ... up to max_users.
+int main(int argc, char *argv[]) {
+    size_t max_users = argc > 1 ? std::stoul(argv[1]) : 1000;
+    int idle_seconds = argc > 2 ? std::stoi(argv[2]) : 5;
+
+    const size_t kSteps[] = { 10, 100, 1000, 5000, 10000, 50000 };
+
+    uint16_t port = 5070;
+    for (auto users : kSteps) {
+        if (users > max_users) {
+            break;
+        }
+
+        // fresh ports per run, the previous sockets may linger
+        Run(users, port, port + 1, idle_seconds);
+        port += 2;
+    }
+
+    return 0;
+}
@@ -3,14 +3,21 @@
 #include <chrono>
 #include <atomic>
 
+#ifndef WEBRTC_WIN
+#include <poll.h>
+#include <unistd.h>
+#endif
+
 #include "rtc_base/flags.h"
 #include "rtc_base/logging.h"
 #include "rtc_base/logsinks.h"
 #include "rtc_base/fileutils.h"
 
 #include "rtc_call_interface.h"
+#include "session/interface.h"
 #include "render/interface.h"
 #include "render/sdl_util.h"
+#include "utility/tracer.h"
 
 DEFINE_bool(help, false, "print help info");
 DEFINE_string(slog, "rtc_session_test.log", "session log file");
@@ -21,11 +28,35 @@ DEFINE_string(peer, nullptr, "peer name");
 DEFINE_string(domain, "101.132.33.178", "login server");
 DEFINE_int(sport, 3390, "login port");
 DEFINE_int(port, 4455, "login port");
+DEFINE_string(renderer, "sdl", "video renderer: sdl, null or offscreen");
+DEFINE_string(capture, "device", "video capture: device, file or synthetic");
+DEFINE_string(capture_file, "", "y4m or raw i420 file for --capture=file");
+DEFINE_bool(loopback, false, "run an in-process registrar on --domain:--sport");
+DEFINE_string(trace, "", "write a chrome trace_event json of the call to this file");
+DEFINE_int(metrics_port, 0, "serve prometheus metrics on 127.0.0.1:<port>/metrics, 0 for off");
+DEFINE_int(stats_interval, 0, "print call quality stats every this many ms, 0 for off");
+DEFINE_int(max_calls, 0, "answer incoming calls beyond this many live ones with a 503, 0 for no limit");
+DEFINE_int(max_cpu, 0, "answer incoming calls with a 503 while process cpu is above this percent, 0 for no limit");
+DEFINE_string(observer, "engine", "where observer callbacks run: engine, thread or poll (main thread, not with sdl)");
+
+rtc::VideoRendererBackend RendererBackend() {
+    std::string renderer = FLAG_renderer;
+    if ("null" == renderer) {
+        return rtc::VideoRendererBackend::kNull;
+    }
+
+    if ("offscreen" == renderer) {
+        return rtc::VideoRendererBackend::kOffscreen;
+    }
+
+    return rtc::VideoRendererBackend::kSDL;
+}
 
 
 struct CallEnv : rtc::CallEngineOptions {
     std::shared_ptr<rtc::CallEngineInterface> call_engine;
     rtc::CallUserOptions comm_user_options;
+    std::shared_ptr<util::PollableExecutor> poll_executor;
 
     bool Init() {
         call_engine = rtc::CreateCallEngine(*this);
@@ -51,8 +82,28 @@ struct CallEnv : rtc::CallEngineOptions {
         env->ice_servers.push_back(ice_server);
         env->session.login_keepalive_sec = 60;
 
+        std::string capture = FLAG_capture;
+        if ("file" == capture) {
+            env->video_capture.type = rtc::CallEngineOptions::VideoCapture::Type::kFile;
+            env->video_capture.file = FLAG_capture_file;
+        } else if ("synthetic" == capture) {
+            env->video_capture.type = rtc::CallEngineOptions::VideoCapture::Type::kSynthetic;
+        }
+
+        env->metrics.port = static_cast<uint16_t>(FLAG_metrics_port);
+        env->stats_interval_ms = static_cast<uint32_t>(FLAG_stats_interval);
+        env->admission.max_calls = static_cast<uint32_t>(FLAG_max_calls);
+        env->admission.max_cpu_percent = static_cast<uint32_t>(FLAG_max_cpu);
+
         env->comm_user_options.domain = FLAG_domain;
         env->comm_user_options.login_server_port = FLAG_sport;
+        std::string observer = FLAG_observer;
+        if ("thread" == observer) {
+            env->executor = util::ThreadExecutor::Create("app_observer");
+        } else if ("poll" == observer) {
+            env->poll_executor = util::PollableExecutor::Create();
+            env->executor = env->poll_executor;
+        }
 
         env->Init();
 
@@ -64,12 +115,14 @@ class CallUser : public rtc::CallUserObserver
                , public rtc::CallObserver {
 public:
     explicit CallUser(CallEnv *env, const std::string& name) {
-        video_renderer_ = rtc::VideoRendererInterface::Create(name.c_str(), 400, 500);
+        video_renderer_ = rtc::VideoRendererInterface::Create(
+            RendererBackend(), name.c_str(), 400, 500);
         user_ = env->call_engine->CreateUser(env->MakeUserOptions(name), this);
     }
 
     explicit CallUser(CallEnv *env, const std::string& name, const std::string& peer) {
-        video_renderer_ = rtc::VideoRendererInterface::Create(name.c_str(), 400, 500);
+        video_renderer_ = rtc::VideoRendererInterface::Create(
+            RendererBackend(), name.c_str(), 400, 500);
         peer_ = peer;
         user_ = env->call_engine->CreateUser(env->MakeUserOptions(name), this);
         CheckCall();
@@ -105,6 +158,17 @@ private:
         }
     }
 
+    void OnQualityStats(const rtc::CallQualityStats& stats) override {
+        std::cout << "rtt_ms:" << stats.rtt_ms
+            << "\tjitter_ms:" << stats.jitter_ms
+            << "\tloss:" << stats.loss_percent << "%"
+            << "\tsend_kbps:" << stats.send_kbps
+            << "\trecv_kbps:" << stats.recv_kbps
+            << "\tfps:" << stats.framerate
+            << "\tdecode_ms:" << stats.decode_ms
+            << "\tjitter_buffer_ms:" << stats.jitter_buffer_ms << std::endl;
+    }
+
 
     std::shared_ptr<rtc::CallUserInterface> user_;
     std::shared_ptr<rtc::CallInterface> call_;
@@ -133,12 +197,36 @@ int main(int argc, char *argv[]) {
     rtc::LogMessage::AddLogToStream(call_session_log, rtc::LS_INFO);
     RTC_LOG(LS_INFO) << "webrtc log test" << std::endl;
 
+    std::string trace_file = FLAG_trace;
+    util::Tracer::Instance().Enable(!trace_file.empty());
+
     //rtc_session::SetLogger("file", "STACK", FLAG_slog);
 
 
-    rtc::SDLInitializer _sdl_initializer;
+    std::unique_ptr<rtc::SDLInitializer> sdl_initializer;
+    if (rtc::VideoRendererBackend::kSDL == RendererBackend()) {
+        sdl_initializer.reset(new rtc::SDLInitializer);
+    }
+
+    std::unique_ptr<rtc_session::RegistrarInterface> registrar;
+    if (FLAG_loopback) {
+        rtc_session::RegistrarOptions registrar_options;
+        registrar_options.realm = FLAG_domain;
+        registrar_options.host = FLAG_domain;
+        registrar_options.udp_port = FLAG_sport;
+        registrar_options.password.emplace("123456");
+
+        registrar = rtc_session::CreateRegistrar(registrar_options);
+        if (!registrar) {
+            return -1;
+        }
+    }
 
     auto env = CallEnv::CreateDefault();
+    if (env->poll_executor && sdl_initializer) {
+        std::cerr << "--observer=poll needs the main thread, which --renderer=sdl takes" << std::endl;
+        return -1;
+    }
 
     std::unique_ptr<CallUser> user;
     if (FLAG_peer) {
@@ -147,7 +235,67 @@ int main(int argc, char *argv[]) {
         user.reset(new CallUser(env.get(), FLAG_name));
     }
     
-    rtc::SDLLoop();
+    if (sdl_initializer) {
+        rtc::SDLLoop();
+    } else if (env->poll_executor) {
+#ifndef WEBRTC_WIN
+        // every callback on this thread, until enter is pressed
+        pollfd fds[] = { { STDIN_FILENO, POLLIN, 0 }, { env->poll_executor->handle(), POLLIN, 0 } };
+        while (::poll(fds, 2, -1) >= 0 && !(fds[0].revents & POLLIN)) {
+            if (fds[1].revents & POLLIN) {
+                env->poll_executor->Drain();
+            }
+        }
+#else
+        HANDLE handles[] = { ::GetStdHandle(STD_INPUT_HANDLE), env->poll_executor->handle() };
+        while (WAIT_OBJECT_0 + 1 == ::WaitForMultipleObjects(2, handles, FALSE, INFINITE)) {
+            env->poll_executor->Drain();
+        }
+#endif
+    } else {
+        std::cin.get();
+    }
+
+    for (size_t i = 0; i < static_cast<size_t>(rtc::CallSetupStage::kCount); ++i) {
+        auto stage = static_cast<rtc::CallSetupStage>(i);
+        auto setup_us = env->call_engine->GetCallSetupHistogram(stage);
+        if (setup_us.count > 0) {
+            std::cout << rtc::CallSetupStageName(stage)
+                << "\tcount:" << setup_us.count
+                << "\tmean_ms:" << setup_us.mean() / 1000
+                << "\tp99_ms:" << setup_us.Percentile(99) / 1000.0 << std::endl;
+        }
+    }
+
+    if (!trace_file.empty() && !util::Tracer::Instance().WriteJson(trace_file)) {
+        std::cerr << "failed to write " << trace_file << std::endl;
+    }
+
+    for (auto& thread : env->call_engine->GetThreadStats()) {
+        std::cout << thread.name
+            << "\tbusy:" << thread.busy_percent() << "%"
+            << "\ttasks:" << thread.tasks
+            << "\tmax_task_ms:" << thread.max_task_us / 1000.0
+            << "\tqueue:" << thread.queue_depth << std::endl;
+    }
+
+    if (env->executor) {
+        auto executor = env->executor->GetSnapshot();
+        std::cout << "observer executor"
+            << "\ttasks:" << executor.tasks
+            << "\tbatches:" << executor.batches
+            << "\tmax_depth:" << executor.max_queue_depth
+            << "\tlatency_p99_ms:" << executor.latency_us.Percentile(99) / 1000.0
+            << "\trun_p99_ms:" << executor.run_us.Percentile(99) / 1000.0 << std::endl;
+    }
+
+    // so the users and calls released below have nothing left to wait for
+    auto shutdown = env->call_engine->Shutdown(rtc::ShutdownOptions());
+    std::cout << "shutdown"
+        << "\tcalls_ended:" << shutdown.calls.ended << "/" << shutdown.calls.calls
+        << "\tlogged_out:" << shutdown.logged_out << "/" << shutdown.users
+        << "\tpeer_connections_left:" << shutdown.peer_connections
+        << "\telapsed_ms:" << shutdown.elapsed_us / 1000.0 << std::endl;
 
     return 0;
 }
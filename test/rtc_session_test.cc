@@ -26,6 +26,13 @@ std::string ReadAll(const std::string& filename) {
 class TestEnv {
 public:
     explicit TestEnv(uint16_t udp_port) {
+        rtc_session::RegistrarOptions registrar_options;
+        registrar_options.realm = login_server_host_;
+        registrar_options.host = login_server_host_;
+        registrar_options.udp_port = login_server_port_;
+        registrar_options.password.emplace(password_);
+        registrar_ = rtc_session::CreateRegistrar(registrar_options);
+
         rtc_session::StackOptions options(udp_port);
         stack_ = rtc_session::CreateStack(options);
     }
@@ -51,10 +58,12 @@ public:
     }
 
 private:
-    std::string login_server_host_ { "101.132.33.178" };
+    std::string login_server_host_ { "127.0.0.1" };
     std::string password_ { "123456" };
     uint16_t login_server_port_ = 3390;
 
+    // in-process stand-in for the login server, so the test runs offline
+    std::unique_ptr<rtc_session::RegistrarInterface> registrar_;
     std::unique_ptr<rtc_session::StackInterface> stack_;
 };
 
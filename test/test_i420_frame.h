@@ -0,0 +1,45 @@
+#ifndef _RTC_TEST_I420_FRAME_H_INCLUDED
+#define _RTC_TEST_I420_FRAME_H_INCLUDED
+
+#include <vector>
+
+#include "rtc_common_types.h"
+
+namespace rtc {
+
+// Tightly packed synthetic I420 frame for render benchmarks.
+class TestI420Frame : public I420VideoFrame {
+public:
+    TestI420Frame(int w, int h)
+        : w_(w)
+        , h_(h)
+        , y_(w * h)
+        , u_(((w + 1) / 2) * ((h + 1) / 2), 0x40)
+        , v_(((w + 1) / 2) * ((h + 1) / 2), 0xc0) {
+        for (int i = 0; i < h; ++i) {
+            for (int j = 0; j < w; ++j) {
+                y_[i * w + j] = static_cast<uint8_t>(i + j);
+            }
+        }
+    }
+
+    int width() const override { return w_; }
+    int height() const override { return h_; }
+
+    const uint8_t* DataY() const override { return y_.data(); }
+    const uint8_t* DataU() const override { return u_.data(); }
+    const uint8_t* DataV() const override { return v_.data(); }
+
+    int StrideY() const override { return w_; }
+    int StrideU() const override { return (w_ + 1) / 2; }
+    int StrideV() const override { return (w_ + 1) / 2; }
+private:
+    int w_;
+    int h_;
+    std::vector<uint8_t> y_;
+    std::vector<uint8_t> u_;
+    std::vector<uint8_t> v_;
+};
+}
+
+#endif // !_RTC_TEST_I420_FRAME_H_INCLUDED
@@ -0,0 +1,52 @@
+#include <iostream>
+#include <initializer_list>
+
+#include "render/sdl_renderer.h"
+#include "render/sdl_util.h"
+#include "test_i420_frame.h"
+
+namespace {
+
+void Run(std::shared_ptr<rtc::SDLVideoRenderer> renderer,
+         rtc::TextureUploadMode mode,
+         int w,
+         int h,
+         int frames) {
+    renderer->set_texture_upload_mode(mode);
+    renderer->upload_time_us().Reset();
+
+    std::shared_ptr<rtc::VideoRendererInterface> base = renderer;
+    auto sink = base->CreateSink(0, 0, 1, 1);
+
+    rtc::TestI420Frame frame(w, h);
+    for (int i = 0; i < frames; ++i) {
+        sink->OnFrame(frame);
+    }
+
+    auto s = renderer->upload_time_us().GetSnapshot();
+    std::cout << (rtc::TextureUploadMode::kLock == mode ? "lock  " : "update")
+        << "\t" << w << "x" << h
+        << "\tframes:" << s.count
+        << "\tmean_us:" << s.mean()
+        << "\tp50_us:" << s.Percentile(50)
+        << "\tp99_us:" << s.Percentile(99)
+        << "\tmax_us:" << s.max << std::endl;
+}
+}
+
+int main() {
+    rtc::SDLInitializer _sdl_initializer;
+
+    auto renderer = rtc::SDLVideoRenderer::Create("texture_upload_bench", 1280, 720);
+    if (!renderer) {
+        return -1;
+    }
+
+    const int kFrames = 600;
+    for (auto mode : { rtc::TextureUploadMode::kUpdate, rtc::TextureUploadMode::kLock }) {
+        Run(renderer, mode, 1280, 720, kFrames);
+        Run(renderer, mode, 1920, 1080, kFrames);
+    }
+
+    return 0;
+}
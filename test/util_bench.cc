@@ -0,0 +1,490 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "rutil/Fifo.hxx"
+#include "rutil/ThreadIf.hxx"
+
+#include "utility/invoker.h"
+#include "utility/callback_wrapper.h"
+#include "utility/unique_ptr.h"
+#include "utility/optional.h"
+#include "utility/histogram.h"
+#include "utility/executor.h"
+
+namespace {
+
+// Keeps the compiler from dropping a computed value or assuming what
+// lives behind it.
+template<typename T>
+void DoNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &value;
+    _ReadWriteBarrier();
+#endif
+}
+
+// Runs fn(iterations) with a doubling iteration count until one batch takes
+// at least 200ms, then reports the time per iteration.
+template<typename Fn>
+void Bench(const std::string& name, Fn&& fn) {
+    uint64_t iterations = 1;
+    uint64_t elapsed_us = 0;
+    for (;;) {
+        auto start_us = util::MonotonicMicros();
+        fn(iterations);
+        elapsed_us = util::MonotonicMicros() - start_us;
+        if (elapsed_us >= 200000 || iterations >= 1000000000) {
+            break;
+        }
+        iterations *= elapsed_us < 20000 ? 10 : 2;
+    }
+
+    std::cout << std::left << std::setw(48) << name
+        << std::right << std::setw(12) << std::fixed << std::setprecision(1)
+        << elapsed_us * 1000.0 / iterations << " ns"
+        << std::setw(14) << iterations << std::endl;
+}
+
+void PrintLatency(const std::string& name, const util::Histogram& histogram) {
+    auto snapshot = histogram.GetSnapshot();
+    std::cout << std::left << std::setw(48) << name
+        << std::right << " p50 " << snapshot.Percentile(50) << " us"
+        << " p99 " << snapshot.Percentile(99) << " us"
+        << " max " << snapshot.max << " us" << std::endl;
+}
+
+// The repo's own pattern: an Invoker over a resip::Fifo, as StackThread
+// was before its lanes; one fifo for both.
+class FifoThread : public resip::ThreadIf
+                 , public util::Invoker<FifoThread> {
+public:
+    FifoThread() { run(); }
+    ~FifoThread() {
+        shutdown();
+        Post([] {});
+        join();
+    }
+
+    resip::ThreadIf::Id tid() const { return mId; }
+    template<typename Fn>
+    void PostImpl(Fn&& fn, util::Lane) {
+        tasks_.add(new std::function<void()>(std::forward<Fn>(fn)));
+    }
+private:
+    void thread() override {
+        while (!isShutdown()) {
+            std::unique_ptr<std::function<void()>> task(tasks_.getNext(100));
+            if (task) {
+                (*task)();
+            }
+        }
+    }
+
+    resip::Fifo<std::function<void()>> tasks_;
+};
+
+// The obvious alternative: a mutex, a condition variable and a deque of
+// std::function, no allocation per task beyond the function itself.
+class DequeThread {
+public:
+    DequeThread() : thread_([this] { Run(); }) {}
+    ~DequeThread() {
+        Post(nullptr);
+        thread_.join();
+    }
+
+    void Post(std::function<void()> fn) {
+        {
+            std::lock_guard<std::mutex> guard(mu_);
+            tasks_.push_back(std::move(fn));
+        }
+        cond_.notify_one();
+    }
+private:
+    void Run() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mu_);
+                cond_.wait(lock, [this] { return !tasks_.empty(); });
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+
+            if (!task) {
+                return;
+            }
+            task();
+        }
+    }
+
+    std::mutex mu_;
+    std::condition_variable cond_;
+    std::deque<std::function<void()>> tasks_;
+    std::thread thread_;
+};
+
+// Blocks until the posted tasks signal completion, shared by the
+// round trip alternatives.
+class Waiter {
+public:
+    void Signal() {
+        std::lock_guard<std::mutex> guard(mu_);
+        done_ = true;
+        cond_.notify_one();
+    }
+
+    void Wait() {
+        std::unique_lock<std::mutex> lock(mu_);
+        cond_.wait(lock, [this] { return done_; });
+        done_ = false;
+    }
+private:
+    std::mutex mu_;
+    std::condition_variable cond_;
+    bool done_ = false;
+};
+
+const int kLatencySamples = 100000;
+
+void BenchInvoker() {
+    FifoThread fifo_thread;
+    DequeThread deque_thread;
+
+    Bench("Invoker::Invoke round trip (promise)", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            DoNotOptimize(fifo_thread.Invoke([] { return 1; }));
+        }
+    });
+
+    Bench("Invoker::Post + condition variable round trip", [&](uint64_t n) {
+        Waiter waiter;
+        for (uint64_t i = 0; i < n; ++i) {
+            fifo_thread.Post([&] { waiter.Signal(); });
+            waiter.Wait();
+        }
+    });
+
+    Bench("DequeThread::Post + condition variable round trip", [&](uint64_t n) {
+        Waiter waiter;
+        for (uint64_t i = 0; i < n; ++i) {
+            deque_thread.Post([&] { waiter.Signal(); });
+            waiter.Wait();
+        }
+    });
+
+    Bench("Invoker::Dispatch on its own thread", [&](uint64_t n) {
+        fifo_thread.Invoke([&] {
+            int count = 0;
+            for (uint64_t i = 0; i < n; ++i) {
+                fifo_thread.Dispatch([&] { ++count; });
+            }
+            DoNotOptimize(count);
+            return 0;
+        });
+    });
+
+    Bench("Invoker::Post throughput", [&](uint64_t n) {
+        Waiter waiter;
+        for (uint64_t i = 0; i < n; ++i) {
+            fifo_thread.Post([] {});
+        }
+        fifo_thread.Post([&] { waiter.Signal(); });
+        waiter.Wait();
+    });
+
+    Bench("DequeThread::Post throughput", [&](uint64_t n) {
+        Waiter waiter;
+        for (uint64_t i = 0; i < n; ++i) {
+            deque_thread.Post([] {});
+        }
+        deque_thread.Post([&] { waiter.Signal(); });
+        waiter.Wait();
+    });
+
+    // one post at a time so the latency is not queueing delay
+    util::Histogram fifo_latency;
+    util::Histogram deque_latency;
+    for (int i = 0; i < kLatencySamples; ++i) {
+        Waiter waiter;
+        auto start_us = util::MonotonicMicros();
+        fifo_thread.Post([&, start_us] {
+            fifo_latency.Add(util::MonotonicMicros() - start_us);
+            waiter.Signal();
+        });
+        waiter.Wait();
+
+        start_us = util::MonotonicMicros();
+        deque_thread.Post([&, start_us] {
+            deque_latency.Add(util::MonotonicMicros() - start_us);
+            waiter.Signal();
+        });
+        waiter.Wait();
+    }
+    PrintLatency("Invoker::Post cross thread latency", fifo_latency);
+    PrintLatency("DequeThread::Post cross thread latency", deque_latency);
+}
+
+void PrintExecutor(const std::string& name, const util::ExecutorSnapshot& s) {
+    std::cout << std::left << std::setw(48) << name
+        << std::right << " tasks " << s.tasks
+        << " batches " << s.batches
+        << " max_batch " << s.max_batch
+        << " max_depth " << s.max_queue_depth
+        << " latency p99 " << s.latency_us.Percentile(99) << " us" << std::endl;
+}
+
+// What an engine thread pays to hand an event to the application, and what
+// batching saves the application's side.
+void BenchExecutor() {
+    auto thread_executor = util::ThreadExecutor::Create("bench_app");
+
+    Bench("ThreadExecutor::Post throughput", [&](uint64_t n) {
+        Waiter waiter;
+        for (uint64_t i = 0; i < n; ++i) {
+            thread_executor->Post([] {});
+        }
+        thread_executor->Post([&] { waiter.Signal(); });
+        waiter.Wait();
+    });
+    PrintExecutor("ThreadExecutor batches", thread_executor->GetSnapshot());
+
+    // a callback taking 1ms must not slow the poster down; few enough
+    // that the queue drains in a fraction of a second
+    const int kSlowTasks = 200;
+    auto slow_executor = util::ThreadExecutor::Create("bench_slow_app");
+    auto start_us = util::MonotonicMicros();
+    for (int i = 0; i < kSlowTasks; ++i) {
+        slow_executor->Post([] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        });
+    }
+    auto post_us = util::MonotonicMicros() - start_us;
+    std::cout << std::left << std::setw(48) << "ThreadExecutor::Post, 1ms callbacks behind"
+        << std::right << std::setw(12) << std::fixed << std::setprecision(1)
+        << post_us * 1000.0 / kSlowTasks << " ns"
+        << std::setw(14) << kSlowTasks << std::endl;
+    slow_executor.reset();
+
+    // the application's queue, one post per batch instead of one per task
+    DequeThread app_thread;
+    std::atomic<uint64_t> app_posts{ 0 };
+    auto queue_executor = util::QueueExecutor::Create([&](util::Executor::Task task) {
+        app_posts.fetch_add(1, std::memory_order_relaxed);
+        app_thread.Post(std::move(task));
+    });
+
+    Bench("QueueExecutor::Post throughput", [&](uint64_t n) {
+        Waiter waiter;
+        for (uint64_t i = 0; i < n; ++i) {
+            queue_executor->Post([] {});
+        }
+        queue_executor->Post([&] { waiter.Signal(); });
+        waiter.Wait();
+    });
+    PrintExecutor("QueueExecutor batches", queue_executor->GetSnapshot());
+
+    // everything on one thread, as an application polling the fd would
+    auto poll_executor = util::PollableExecutor::Create();
+    Bench("PollableExecutor::Post + Drain, one thread", [&](uint64_t n) {
+        uint64_t count = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            poll_executor->Post([&] { ++count; });
+            if (0 == i % 64) {
+                poll_executor->Drain();
+            }
+        }
+        poll_executor->Drain();
+        DoNotOptimize(count);
+    });
+    PrintExecutor("PollableExecutor batches", poll_executor->GetSnapshot());
+    std::cout << std::left << std::setw(48) << "QueueExecutor posts to the app queue"
+        << std::right << " " << app_posts.load() << std::endl;
+}
+
+class Callback {
+public:
+    virtual ~Callback() = default;
+    virtual void OnEvent(int value) = 0;
+};
+
+class CountingCallback : public Callback {
+public:
+    void OnEvent(int value) override { sum_ += value; }
+    int64_t sum() const { return sum_; }
+private:
+    int64_t sum_ = 0;
+};
+
+void BenchCallbackWrapper() {
+    auto callback = std::make_shared<CountingCallback>();
+    util::CallbackWrapper<Callback> wrapper(callback);
+    std::weak_ptr<Callback> weak = callback;
+    Callback *raw = callback.get();
+
+    Bench("CallbackWrapper dispatch (weak_ptr::lock)", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            wrapper(&Callback::OnEvent, 1);
+        }
+    });
+
+    Bench("raw pointer virtual call", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            DoNotOptimize(raw);
+            raw->OnEvent(1);
+        }
+    });
+
+    Bench("shared_ptr virtual call", [&](uint64_t n) {
+        std::shared_ptr<Callback> strong = callback;
+        for (uint64_t i = 0; i < n; ++i) {
+            DoNotOptimize(strong);
+            strong->OnEvent(1);
+        }
+    });
+
+    Bench("std::function call", [&](uint64_t n) {
+        std::function<void(int)> fn = [raw](int value) { raw->OnEvent(value); };
+        for (uint64_t i = 0; i < n; ++i) {
+            fn(1);
+        }
+    });
+
+    // lock() bumps a shared count, so threads on one callback contend on it
+    const int kThreads = 4;
+    Bench("weak_ptr::lock, 4 threads on one callback", [&](uint64_t n) {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t) {
+            threads.emplace_back([&] {
+                for (uint64_t i = 0; i < n / kThreads; ++i) {
+                    auto sp = weak.lock();
+                    DoNotOptimize(sp);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    });
+
+    DoNotOptimize(callback->sum());
+}
+
+void FreeInt(int *p) {
+    delete p;
+}
+
+void BenchUniquePtr() {
+    std::cout << "sizeof util::UniquePtr<int>                     "
+        << sizeof(util::UniquePtr<int>) << " bytes" << std::endl;
+    std::cout << "sizeof std::unique_ptr<int>                     "
+        << sizeof(std::unique_ptr<int>) << " bytes" << std::endl;
+    std::cout << "sizeof std::unique_ptr<int, void (*)(int *)>    "
+        << sizeof(std::unique_ptr<int, void (*)(int *)>) << " bytes" << std::endl;
+
+    // a deleter capturing a weak_ptr, as ScratchBufferPool's does
+    auto owner = std::make_shared<int>(0);
+    std::weak_ptr<int> wp = owner;
+
+    Bench("util::UniquePtr create + destroy (capturing)", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            util::UniquePtr<int> p(new int(1), [wp](int *p) {
+                auto sp = wp.lock();
+                delete p;
+            });
+            DoNotOptimize(p);
+        }
+    });
+
+    Bench("util::UniquePtr create + destroy (empty lambda)", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            util::UniquePtr<int> p(new int(1), [](int *p) { delete p; });
+            DoNotOptimize(p);
+        }
+    });
+
+    Bench("std::unique_ptr function pointer deleter", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            std::unique_ptr<int, void (*)(int *)> p(new int(1), FreeInt);
+            DoNotOptimize(p);
+        }
+    });
+
+    Bench("std::unique_ptr default deleter", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            std::unique_ptr<int> p(new int(1));
+            DoNotOptimize(p);
+        }
+    });
+}
+
+void BenchOptional() {
+    const std::string value(32, 'x');
+
+    Bench("util::Optional<std::string> emplace + read", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            util::Optional<std::string> opt;
+            opt.emplace(value);
+            DoNotOptimize(opt ? opt->size() : 0);
+        }
+    });
+
+    Bench("std::optional<std::string> emplace + read", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            std::optional<std::string> opt;
+            opt.emplace(value);
+            DoNotOptimize(opt ? opt->size() : 0);
+        }
+    });
+
+    Bench("util::Optional<uint32_t> copy + read", [&](uint64_t n) {
+        const util::Optional<uint32_t> src(7u);
+        for (uint64_t i = 0; i < n; ++i) {
+            DoNotOptimize(src);
+            util::Optional<uint32_t> opt(src);
+            DoNotOptimize(opt ? *opt : 0);
+        }
+    });
+
+    Bench("std::optional<uint32_t> copy + read", [&](uint64_t n) {
+        const std::optional<uint32_t> src(7u);
+        for (uint64_t i = 0; i < n; ++i) {
+            DoNotOptimize(src);
+            std::optional<uint32_t> opt(src);
+            DoNotOptimize(opt ? *opt : 0);
+        }
+    });
+}
+}
+
+// Prints ns per operation for each utility helper next to its
+// alternatives, in the same layout as Google Benchmark's console output.
+int main() {
+    std::cout << std::left << std::setw(48) << "Benchmark"
+        << std::right << std::setw(15) << "Time" << std::setw(14) << "Iterations" << std::endl;
+
+    BenchInvoker();
+    BenchExecutor();
+    BenchCallbackWrapper();
+    BenchUniquePtr();
+    BenchOptional();
+    return 0;
+}